@@ -0,0 +1,220 @@
+/*
+ * LibOpenCIF, a library to read the contents of a CIF (Caltech Intermediate
+ * Form) file. The library also includes a finite state machine to validate
+ * the contents, acording to the specifications found in the technical
+ * report 2686, from february 11, 1980.
+ * 
+ * Copyright (C) 2014, Moises Chavez Martinez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// This file is an example of how to walk the loaded commands without copying them. It counts
+// every heap allocation made by the program, and reports how many were made while traversing
+// the commands, first through references and then through copies.
+
+// To compile, use these commands:
+
+// $ g++ -O2 libopencif.cc -c                    <- This will generate a "libopencif.o" file.
+// $ g++ -O2 alloc-benchmark.cc libopencif.o     <- This will generate a binary file (or an EXE file)
+
+// To use, run: ./a.out [CIF file] [repetitions]
+// By default, the program traverses "adder4_a2m_sin.cif" 100 times.
+
+# include <iostream>
+# include <vector>
+# include <string>
+# include <cstdlib>
+# include <ctime>
+# include <new>
+
+// Import directly the library file.
+# include "libopencif.hh"
+
+using namespace std;
+
+// Every call to "new" goes through here, so the counter sees all the allocations.
+static unsigned long int allocations = 0;
+
+void* operator new ( size_t size )
+{
+   allocations++;
+   
+   void* memory = malloc ( size ? size : 1 );
+   
+   if ( memory == 0 )
+   {
+      throw bad_alloc ();
+   }
+   
+   return ( memory );
+}
+
+void operator delete ( void* memory ) throw ()
+{
+   free ( memory );
+}
+
+# if __cplusplus >= 201402L
+void operator delete ( void* memory , size_t ) throw ()
+{
+   free ( memory );
+}
+# endif
+
+// Walks every command, reading the data each one holds through the const references.
+unsigned long int traverseByReference ( const vector< OpenCIF::Command* >& commands )
+{
+   unsigned long int total = 0;
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      switch ( commands[ i ]->type () )
+      {
+         case OpenCIF::Command::Polygon:
+         case OpenCIF::Command::Wire:
+            {
+               const OpenCIF::PointVector& points = static_cast< OpenCIF::PathBasedCommand* > ( commands[ i ] )->getPoints ();
+               
+               for ( unsigned long int j = 0; j < points.size (); j++ )
+               {
+                  total += points[ j ].getX () + points[ j ].getY ();
+               }
+            }
+            break;
+            
+         case OpenCIF::Command::Layer:
+            total += static_cast< OpenCIF::LayerCommand* > ( commands[ i ] )->getName ().size ();
+            break;
+            
+         case OpenCIF::Command::UserExtension:
+         case OpenCIF::Command::Comment:
+            total += static_cast< OpenCIF::RawContentCommand* > ( commands[ i ] )->getContent ().size ();
+            break;
+            
+         default:
+            break;
+      }
+   }
+   
+   return ( total );
+}
+
+// The same walk, but storing the data in local copies, as the code written for the old getters did.
+unsigned long int traverseByCopy ( const vector< OpenCIF::Command* >& commands )
+{
+   unsigned long int total = 0;
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      switch ( commands[ i ]->type () )
+      {
+         case OpenCIF::Command::Polygon:
+         case OpenCIF::Command::Wire:
+            {
+               vector< OpenCIF::Point > points = static_cast< OpenCIF::PathBasedCommand* > ( commands[ i ] )->getPoints ().toVector ();
+               
+               for ( unsigned long int j = 0; j < points.size (); j++ )
+               {
+                  total += points[ j ].getX () + points[ j ].getY ();
+               }
+            }
+            break;
+            
+         case OpenCIF::Command::Layer:
+            {
+               string name = static_cast< OpenCIF::LayerCommand* > ( commands[ i ] )->getName ();
+               total += name.size ();
+            }
+            break;
+            
+         case OpenCIF::Command::UserExtension:
+         case OpenCIF::Command::Comment:
+            {
+               string content = static_cast< OpenCIF::RawContentCommand* > ( commands[ i ] )->getContent ();
+               total += content.size ();
+            }
+            break;
+            
+         default:
+            break;
+      }
+   }
+   
+   return ( total );
+}
+
+int main ( int argc , char* argv[] )
+{
+   string cif_path = ( argc > 1 ) ? argv[ 1 ] : "adder4_a2m_sin.cif";
+   int repetitions = ( argc > 2 ) ? atoi ( argv[ 2 ] ) : 100;
+   
+   OpenCIF::File file;
+   file.setPath ( cif_path );
+   
+   unsigned long int before = allocations;
+   
+   if ( file.loadFile () != OpenCIF::File::AllOk )
+   {
+      cout << "Can't load " << cif_path << endl;
+      return ( 1 );
+   }
+   
+   const vector< OpenCIF::Command* >& commands = file.getCommands ();
+   cout << "Load:       " << commands.size () << " commands, " << ( allocations - before ) << " allocations" << endl;
+   
+   // Time and count the traversal through references.
+   unsigned long int checksum = 0;
+   before = allocations;
+   clock_t start = clock ();
+   
+   for ( int i = 0; i < repetitions; i++ )
+   {
+      checksum += traverseByReference ( commands );
+   }
+   
+   double reference_seconds = (double)( clock () - start ) / CLOCKS_PER_SEC;
+   unsigned long int reference_allocations = allocations - before;
+   
+   // Time and count the traversal through copies.
+   before = allocations;
+   start = clock ();
+   
+   for ( int i = 0; i < repetitions; i++ )
+   {
+      checksum -= traverseByCopy ( commands );
+   }
+   
+   double copy_seconds = (double)( clock () - start ) / CLOCKS_PER_SEC;
+   unsigned long int copy_allocations = allocations - before;
+   
+   cout << "References: " << ( reference_allocations / repetitions ) << " allocations, "
+        << ( reference_seconds * 1000.0 / repetitions ) << " ms per traversal" << endl;
+   cout << "Copies:     " << ( copy_allocations / repetitions ) << " allocations, "
+        << ( copy_seconds * 1000.0 / repetitions ) << " ms per traversal" << endl;
+   
+# if __cplusplus >= 201103L
+   // Handing the points over to a command moves them, so no allocation is made.
+   OpenCIF::PointVector points ( 4 );
+   OpenCIF::PolygonCommand polygon;
+   
+   before = allocations;
+   polygon.setPoints ( std::move ( points ) );
+   cout << "Moving the points of a polygon: " << ( allocations - before ) << " allocations" << endl;
+# endif
+   
+   // Both walks read the same data, so the checksum must be zero.
+   return ( checksum == 0 ? 0 : 1 );
+}
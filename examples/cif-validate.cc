@@ -0,0 +1,118 @@
+/*
+ * LibOpenCIF, a library to read the contents of a CIF (Caltech Intermediate
+ * Form) file. The library also includes a finite state machine to validate
+ * the contents, acording to the specifications found in the technical
+ * report 2686, from february 11, 1980.
+ * 
+ * Copyright (C) 2014, Moises Chavez Martinez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file is an example of how to validate CIF files without loading them. Only the
+// finite state machine is run over the contents, so it's the fastest way to know if a
+// file is correct (and where is the first error, if any).
+
+// To compile, use these commands:
+
+// $ g++ -O2 libopencif.cc -c                  <- This will generate a "libopencif.o" file.
+// $ g++ -O2 cif-validate.cc libopencif.o      <- This will generate a binary file (or an EXE file)
+
+// To use, run: ./a.out [CIF file] [more CIF files...]
+// The program returns 0 only if every file is valid.
+
+# include <iostream>
+# include <fstream>
+# include <vector>
+# include <string>
+# include <ctime>
+
+// Import directly the library file.
+# include "libopencif.hh"
+
+using namespace std;
+
+int main ( int argc , char* argv[] )
+{
+   int exit_code = 0;
+   
+   if ( argc < 2 )
+   {
+      cout << "Usage: " << argv[ 0 ] << " [CIF file] [more CIF files...]" << endl;
+      return ( 1 );
+   }
+   
+   for ( int i = 1; i < argc; i++ )
+   {
+      OpenCIF::File file;
+      file.setPath ( argv[ i ] );
+      
+      // The size of the file, to report the speed.
+      ifstream input ( argv[ i ] , ios::in | ios::binary | ios::ate );
+      double bytes = input ? (double)input.tellg () : 0.0;
+      input.close ();
+      
+      clock_t start = clock ();
+      OpenCIF::File::LoadStatus status = file.loadFile ( OpenCIF::File::ValidateOnly );
+      double seconds = (double)( clock () - start ) / CLOCKS_PER_SEC;
+      
+      cout << argv[ i ] << ": ";
+      
+      switch ( status )
+      {
+         case OpenCIF::File::AllOk:
+            cout << "valid";
+            break;
+            
+         case OpenCIF::File::CantOpenInputFile:
+            cout << "can't open the file";
+            break;
+            
+         case OpenCIF::File::IncompleteInputFile:
+            cout << "incomplete";
+            break;
+            
+         default:
+            cout << "invalid";
+            break;
+      }
+      
+      // The validation stops at the first error: only the bytes before it were scanned.
+      if ( status == OpenCIF::File::IncorrectInputFile && !file.getErrors ().empty () )
+      {
+         bytes = (double)( file.getErrors ()[ 0 ].offset + 1 );
+      }
+      
+      if ( seconds > 0.0 && status != OpenCIF::File::CantOpenInputFile )
+      {
+         cout << " (" << ( bytes / seconds / 1.0e9 ) << " GB/s)";
+      }
+      
+      cout << endl;
+      
+      if ( status != OpenCIF::File::AllOk )
+      {
+         const vector< string >& messages = file.getMessages ();
+         
+         for ( unsigned long int j = 0; j < messages.size (); j++ )
+         {
+            cout << "   " << messages[ j ] << endl;
+         }
+         
+         exit_code = 1;
+      }
+   }
+   
+   return ( exit_code );
+}
@@ -0,0 +1,218 @@
+/*
+ * LibOpenCIF, a library to read the contents of a CIF (Caltech Intermediate
+ * Form) file. The library also includes a finite state machine to validate
+ * the contents, acording to the specifications found in the technical
+ * report 2686, from february 11, 1980.
+ * 
+ * Copyright (C) 2014, Moises Chavez Martinez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+// This file is an example of how to flatten a layout (expand its calls into primitives in the
+// coordinates of the top level), and it checks the result with the abutment boxes ("4A", that
+// Alliance writes as comments): every symbol gets its abutment box drawn as a box on the layer
+// "4A", and, once flattened, the boxes of the cells must fill the abutment box of the symbol
+// called at the top level (scaled by its A/B), without going out of it. The geometry itself can
+// go out a bit (wells and power rails overlap the neighbours).
+
+// To compile, use these commands (the extents are computed with the variants, so it needs C++17):
+
+// $ g++ -std=c++17 -O2 libopencif.cc -c                   <- This will generate a "libopencif.o" file.
+// $ g++ -std=c++17 -O2 flatten-check.cc libopencif.o      <- This will generate a binary file (or an EXE file)
+
+// To use, run: ./a.out [CIF file]
+// By default, the program checks "adder4_a2m_sin.cif". It returns 0 if the check passes.
+
+# include <iostream>
+# include <vector>
+# include <string>
+
+// Import directly the library file.
+# include "libopencif.hh"
+
+using namespace std;
+
+// Reads "4A lower_x lower_y upper_x upper_y" from a user extension, or from a comment
+// (Alliance writes them so).
+bool readAbutmentBox ( const OpenCIF::ExtensionRegistry& registry , OpenCIF::Command* command , long int box[ 4 ] )
+{
+   OpenCIF::ExtensionRecord record;
+   
+   if ( !registry.decode ( command , record ) || record.type != OpenCIF::ExtensionRecord::AbutmentBox )
+   {
+      return ( false );
+   }
+   
+   box[ 0 ] = record.position.getX ();
+   box[ 1 ] = record.position.getY ();
+   box[ 2 ] = record.upper.getX ();
+   box[ 3 ] = record.upper.getY ();
+   
+   return ( true );
+}
+
+int main ( int argc , char* argv[] )
+{
+   string cif_path = ( argc > 1 ) ? argv[ 1 ] : "adder4_a2m_sin.cif";
+   
+   OpenCIF::File file;
+   file.setPath ( cif_path );
+   
+   if ( file.loadFile () != OpenCIF::File::AllOk )
+   {
+      cout << "Can't load " << cif_path << endl;
+      return ( 1 );
+   }
+   
+   const vector< OpenCIF::Command* >& commands = file.getCommands ();
+   
+   // Find the symbol called at the top level.
+   unsigned long int top_symbol = 0;
+   bool inside = false;
+   
+   for ( unsigned long int i = 0; i < commands.size () && top_symbol == 0; i++ )
+   {
+      if ( commands[ i ]->type () == OpenCIF::Command::DefinitionStart )
+      {
+         inside = true;
+      }
+      else if ( commands[ i ]->type () == OpenCIF::Command::DefinitionEnd )
+      {
+         inside = false;
+      }
+      else if ( commands[ i ]->type () == OpenCIF::Command::Call && !inside )
+      {
+         top_symbol = static_cast< OpenCIF::CallCommand* > ( commands[ i ] )->getID ();
+      }
+   }
+   
+   // Copy the commands, drawing the abutment boxes of the cells. The abutment box of the top
+   // symbol is kept apart, scaled.
+   vector< OpenCIF::Command* > drawn;
+   vector< OpenCIF::Command* > added;
+   unsigned long int symbol = 0;
+   string layer;
+   OpenCIF::Scale scale;
+   OpenCIF::Point top_lower;
+   OpenCIF::Point top_upper;
+   bool top_found = false;
+   long int box[ 4 ];
+   OpenCIF::ExtensionRegistry registry;
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      drawn.push_back ( commands[ i ] );
+      
+      if ( commands[ i ]->type () == OpenCIF::Command::DefinitionStart )
+      {
+         symbol = static_cast< OpenCIF::DefinitionStartCommand* > ( commands[ i ] )->getID ();
+         scale = OpenCIF::Scale ( static_cast< OpenCIF::DefinitionStartCommand* > ( commands[ i ] )->getAB () );
+         layer.clear ();
+      }
+      else if ( commands[ i ]->type () == OpenCIF::Command::Layer )
+      {
+         layer = static_cast< OpenCIF::LayerCommand* > ( commands[ i ] )->getName ();
+      }
+      else if ( readAbutmentBox ( registry , commands[ i ] , box ) )
+      {
+         if ( symbol == top_symbol )
+         {
+            top_lower = OpenCIF::Point ( box[ 0 ] , box[ 1 ] );
+            top_upper = OpenCIF::Point ( box[ 2 ] , box[ 3 ] );
+            scale.apply ( top_lower );
+            scale.apply ( top_upper );
+            top_found = true;
+            continue;
+         }
+         
+         OpenCIF::LayerCommand* abutment_layer = new OpenCIF::LayerCommand ();
+         OpenCIF::BoxCommand* abutment_box = new OpenCIF::BoxCommand ();
+         
+         abutment_layer->setName ( "4A" );
+         abutment_box->setPosition ( OpenCIF::Point ( ( box[ 0 ] + box[ 2 ] ) / 2 , ( box[ 1 ] + box[ 3 ] ) / 2 ) );
+         abutment_box->setSize ( OpenCIF::Size ( box[ 2 ] - box[ 0 ] , box[ 3 ] - box[ 1 ] ) );
+         added.push_back ( abutment_layer );
+         added.push_back ( abutment_box );
+         drawn.push_back ( abutment_layer );
+         drawn.push_back ( abutment_box );
+         
+         // Keep the layer of the commands that follow.
+         if ( !layer.empty () )
+         {
+            OpenCIF::LayerCommand* restored = new OpenCIF::LayerCommand ();
+            
+            restored->setName ( layer );
+            added.push_back ( restored );
+            drawn.push_back ( restored );
+         }
+      }
+   }
+   
+   if ( !top_found )
+   {
+      cout << cif_path << ": no abutment box for the symbol called at the top level" << endl;
+      return ( 1 );
+   }
+   
+   // Flatten, and split the abutment boxes from the geometry.
+   OpenCIF::Flattener flattener;
+   vector< OpenCIF::Command* > primitives;
+   vector< OpenCIF::Command* > geometry;
+   vector< OpenCIF::Command* > abutment_boxes;
+   bool flattened = flattener.flatten ( drawn , primitives );
+   
+   for ( unsigned long int i = 0; i < primitives.size (); i++ )
+   {
+      if ( primitives[ i ]->type () == OpenCIF::Command::Layer )
+      {
+         layer = static_cast< OpenCIF::LayerCommand* > ( primitives[ i ] )->getName ();
+      }
+      else
+      {
+         ( ( layer == "4A" ) ? abutment_boxes : geometry ).push_back ( primitives[ i ] );
+      }
+   }
+   
+   OpenCIF::Extent cells = OpenCIF::computeExtent ( OpenCIF::toVariants ( abutment_boxes ) );
+   OpenCIF::Extent extent = OpenCIF::computeExtent ( OpenCIF::toVariants ( geometry ) );
+   
+   for ( unsigned long int i = 0; i < flattener.getMessages ().size (); i++ )
+   {
+      cout << flattener.getMessages ()[ i ] << endl;
+   }
+   
+   bool fits = flattened && !cells.empty &&
+               cells.min_x == top_lower.getX () && cells.min_y == top_lower.getY () &&
+               cells.max_x == top_upper.getX () && cells.max_y == top_upper.getY ();
+   
+   cout << cif_path << ": " << geometry.size () << " primitives flattened, extent "
+        << extent.min_x << " " << extent.min_y << " " << extent.max_x << " " << extent.max_y << endl;
+   cout << abutment_boxes.size () << " cells placed in " << cells.min_x << " " << cells.min_y << " " << cells.max_x << " " << cells.max_y
+        << ", abutment box " << top_lower << " " << top_upper << ( ( fits ) ? ": OK" : ": FAIL" ) << endl;
+   
+   for ( unsigned long int i = 0; i < primitives.size (); i++ )
+   {
+      delete primitives[ i ];
+   }
+   
+   for ( unsigned long int i = 0; i < added.size (); i++ )
+   {
+      delete added[ i ];
+   }
+   
+   return ( ( fits ) ? 0 : 1 );
+}
@@ -0,0 +1,121 @@
+/*
+ * LibOpenCIF, a library to read the contents of a CIF (Caltech Intermediate
+ * Form) file. The library also includes a finite state machine to validate
+ * the contents, acording to the specifications found in the technical
+ * report 2686, from february 11, 1980.
+ * 
+ * Copyright (C) 2014, Moises Chavez Martinez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// This file is an example of how to export and import GDSII streams, and it also compares
+// the time needed to load the same layout from a CIF file and from a GDSII file.
+
+// To compile, use these commands:
+
+// $ g++ -O2 libopencif.cc -c                  <- This will generate a "libopencif.o" file.
+// $ g++ -O2 gds-benchmark.cc libopencif.o     <- This will generate a binary file (or an EXE file)
+
+// To use, run: ./a.out [CIF file] [repetitions]
+// By default, the program loads "adder4_a2m_sin.cif" 100 times.
+
+# include <iostream>
+# include <vector>
+# include <string>
+# include <map>
+# include <cstdlib>
+# include <ctime>
+
+// Import directly the library file.
+# include "libopencif.hh"
+
+using namespace std;
+
+int main ( int argc , char* argv[] )
+{
+   string cif_path = ( argc > 1 ) ? argv[ 1 ] : "adder4_a2m_sin.cif";
+   string gds_path = cif_path + ".gds";
+   int repetitions = ( argc > 2 ) ? atoi ( argv[ 2 ] ) : 100;
+   
+   // Load the CIF file once, to generate the GDSII version.
+   OpenCIF::File file;
+   file.setPath ( cif_path );
+   
+   if ( file.loadFile () != OpenCIF::File::AllOk )
+   {
+      cout << "Can't load " << cif_path << endl;
+      return ( 1 );
+   }
+   
+   // Every layer found gets its own GDSII layer number. The inverse table is used to read it back.
+   const vector< OpenCIF::Command* >& commands = file.getCommands ();
+   map< string , int > layer_numbers;
+   map< int , string > layer_names;
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      if ( commands[ i ]->type () == OpenCIF::Command::Layer )
+      {
+         string name = static_cast< OpenCIF::LayerCommand* > ( commands[ i ] )->getName ();
+         
+         if ( layer_numbers.find ( name ) == layer_numbers.end () )
+         {
+            int number = layer_numbers.size () + 1;
+            layer_numbers[ name ] = number;
+            layer_names[ number ] = name;
+         }
+      }
+   }
+   
+   ofstream gds_output ( gds_path.c_str () , ios::out | ios::binary );
+   OpenCIF::GDSWriter writer ( gds_output );
+   writer.setLayerMap ( layer_numbers );
+   writer.write ( commands );
+   gds_output.close ();
+   
+   // Time the CIF path.
+   clock_t start = clock ();
+   unsigned long int cif_commands = 0;
+   
+   for ( int i = 0; i < repetitions; i++ )
+   {
+      OpenCIF::File cif_file;
+      cif_file.setPath ( cif_path );
+      cif_file.loadFile ();
+      cif_commands = cif_file.getCommands ().size ();
+   }
+   
+   double cif_seconds = (double)( clock () - start ) / CLOCKS_PER_SEC;
+   
+   // Time the GDSII path.
+   start = clock ();
+   unsigned long int gds_commands = 0;
+   
+   for ( int i = 0; i < repetitions; i++ )
+   {
+      OpenCIF::GDSReader reader;
+      reader.setPath ( gds_path );
+      reader.setLayerMap ( layer_names );
+      reader.read ();
+      gds_commands = reader.getCommands ().size ();
+   }
+   
+   double gds_seconds = (double)( clock () - start ) / CLOCKS_PER_SEC;
+   
+   cout << "CIF:   " << cif_commands << " commands, " << ( cif_seconds * 1000.0 / repetitions ) << " ms per load" << endl;
+   cout << "GDSII: " << gds_commands << " commands, " << ( gds_seconds * 1000.0 / repetitions ) << " ms per load" << endl;
+   
+   return ( 0 );
+}
@@ -23,6 +23,18 @@
 // If you need to change the include path, modify the next line according to your needs.
 # include "libopencif.hh" 
 
+# include <cmath>
+# include <ctime>
+# include <cstring>
+
+# if defined ( __unix__ ) || defined ( __APPLE__ )
+# include <dirent.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# endif
+
 // To search over the contents of individual files, search for the word "FILE:"
 
 // FILE: command.cc
@@ -123,140 +135,83 @@ OpenCIF::PrimitiveCommand::~PrimitiveCommand ( void )
 {
 }
 
-// FILE: point.cc
-
-
-/*
- * Default constructor. Initialices the point with a 0,0 value.
- */
-OpenCIF::Point::Point ( void )
-{
-   set ( 0 , 0 );
-}
-
-/*
- * Specialized constructor. Initialices a point with the values specified.
- */
-OpenCIF::Point::Point ( const long int& new_x , const long int& new_y )
-{
-   set ( new_x , new_y );
-}
+// FILE: pathbasedcommand.cc
 
-/*
- * Nothing to do.
- */
-OpenCIF::Point::~Point ( void )
-{
-}
 
 /*
- * Returns the X position value of the actual point.
+ * Default constructor. Nothing to do.
  */
-long int OpenCIF::Point::getX ( void ) const
+OpenCIF::PathBasedCommand::PathBasedCommand ( void )
+   : PrimitiveCommand ()
 {
-   return ( point_x );
+   command_type = PathBased;
 }
 
 /*
- * Returns the Y position value of the actual point.
+ * Destructor. Nothing to do.
  */
-long int OpenCIF::Point::getY ( void ) const
+OpenCIF::PathBasedCommand::~PathBasedCommand ( void )
 {
-   return ( point_y );
 }
 
 /*
- * This member function let the user to set a point in a single call.
- * The first argument is the X position value, the second is the Y position value.
- * Internally are called the member functions to set X and Y, indpendently. This
- * behavior is intended in case of adding some kind of checking for the values.
+ * This member function returns the points stored in the command.
  */
-void OpenCIF::Point::set ( const long int& new_x , const long int& new_y )
+const OpenCIF::PointVector& OpenCIF::PathBasedCommand::getPoints ( void ) const
 {
-   setX ( new_x );
-   setY ( new_y );
-   
-   return;
+   return ( command_points );
 }
 
 /*
- * This member functions receives the X position value and sets it to
- * the attribute "point_x".
+ * This member function help to set the points for this command.
  */
-void OpenCIF::Point::setX ( const long int& new_x )
+void OpenCIF::PathBasedCommand::setPoints ( const std::vector< OpenCIF::Point >& new_points )
 {
-   point_x = new_x;
+   command_points.assign ( new_points.empty () ? 0 : &new_points[ 0 ] , new_points.empty () ? 0 : &new_points[ 0 ] + new_points.size () );
    
    return;
 }
 
 /*
- * This member functions receives the Y position value and sets it to
- * the attribute "point_y".
+ * Same as above, from a vector of the type stored in the command.
  */
-void OpenCIF::Point::setY ( const long int& new_y )
+void OpenCIF::PathBasedCommand::setPoints ( const OpenCIF::PointVector& new_points )
 {
-   point_y = new_y;
+   command_points = new_points;
    
    return;
 }
 
+# if __cplusplus >= 201103L
 /*
- * This function helps to load a point from an input stream.
+ * Same as the first one, for a temporary std::vector. Its points are moved into the inline
+ * storage (or a heap buffer if they don't fit), and its storage is released at once.
  */
-std::istream& operator >> ( std::istream& input_stream , OpenCIF::Point& point )
+void OpenCIF::PathBasedCommand::setPoints ( std::vector< OpenCIF::Point >&& new_points )
 {
-   long int x , y;
+   command_points.clear ();
+   command_points.reserve ( new_points.size () );
    
-   input_stream >> x >> y;
-   point.set ( x , y );
+   for ( unsigned long int i = 0; i < new_points.size (); i++ )
+   {
+      command_points.push_back ( std::move ( new_points[ i ] ) );
+   }
    
-   return ( input_stream );
-}
-
-std::ostream& operator << ( std::ostream& output_stream , const OpenCIF::Point& point )
-{
-   output_stream << point.getX () << " " << point.getY ();
+   std::vector< OpenCIF::Point > ().swap ( new_points );
    
-   return ( output_stream );
-}
-
-// FILE: pathbasedcommand.cc
-
-
-/*
- * Default constructor. Nothing to do.
- */
-OpenCIF::PathBasedCommand::PathBasedCommand ( void )
-   : PrimitiveCommand ()
-{
-   command_type = PathBased;
-}
-
-/*
- * Destructor. Nothing to do.
- */
-OpenCIF::PathBasedCommand::~PathBasedCommand ( void )
-{
-}
-
-/*
- * This member function returns the points stored in the command.
- */
-std::vector< OpenCIF::Point > OpenCIF::PathBasedCommand::getPoints ( void ) const
-{
-   return ( command_points );
+   return;
 }
 
 /*
- * This member function help to set the points for this command.
+ * Same as the second one, but takes over the storage of a temporary vector instead of copying it.
  */
-void OpenCIF::PathBasedCommand::setPoints ( const std::vector< OpenCIF::Point >& new_points )
+void OpenCIF::PathBasedCommand::setPoints ( OpenCIF::PointVector&& new_points )
 {
-   command_points = new_points;
+   command_points = std::move ( new_points );
    
    return;
 }
+# endif
 
 // FILE: polygoncommand.cc
 
@@ -334,9 +289,9 @@ void OpenCIF::PolygonCommand::print ( std::ostream& output_stream )
 {
    output_stream << "P ";
    
-   for ( unsigned long int i = 0; i < getPoints ().size (); i++ )
+   for ( unsigned long int i = 0; i < command_points.size (); i++ )
    {
-      output_stream << getPoints ()[ i ] << " ";
+      output_stream << command_points[ i ] << " ";
    }
    
    output_stream << ";";
@@ -547,98 +502,6 @@ void OpenCIF::PositionBasedCommand::setPosition ( const OpenCIF::Point& new_posi
    return;
 }
 
-// FILE: size.cc
-
-
-/*
- * Default constructor. Initialize the values of the size to a non-zero value.
- */
-OpenCIF::Size::Size ( void )
-{
-   size_height = 1;
-   size_width = 1;
-}
-
-/*
- * Non-Default constructor. Initialize the values of the size.
- */
-OpenCIF::Size::Size ( const unsigned long int& new_width , const unsigned long int& new_height )
-{
-   set ( new_width , new_height );
-}
-
-/*
- * Destructor. Nothing to do.
- */
-OpenCIF::Size::~Size ( void )
-{
-}
-
-/*
- * Member function to return the height of the size.
- */
-long unsigned int OpenCIF::Size::getHeight ( void ) const
-{
-   return ( size_height );
-}
-
-/*
- * Member function to return the width of the size.
- */
-long unsigned int OpenCIF::Size::getWidth ( void ) const
-{
-   return ( size_width );
-}
-
-/*
- * Member function to set both dimensions of the size at the same time.
- */
-void OpenCIF::Size::set ( const long unsigned int& new_width , const long unsigned int& new_height )
-{
-   setWidth ( new_width );
-   setHeight ( new_height );
-   
-   return;
-}
-
-/*
- * Member function to set the height of the size.
- */
-void OpenCIF::Size::setHeight ( const long unsigned int& new_height )
-{
-   size_height = new_height;
-   
-   return;
-}
-
-/*
- * Member function to set the width of the size.
- */
-void OpenCIF::Size::setWidth ( const long unsigned int& new_width )
-{
-   size_width = new_width;
-   
-   return;
-}
-
-std::istream& operator>> ( std::istream& input_stream , OpenCIF::Size& command )
-{
-   unsigned long int x , y;
-   
-   input_stream >> x >> y;
-   command.size_height = y;
-   command.size_width = x;
-   
-   return ( input_stream );
-}
-
-std::ostream& operator<< ( std::ostream& output_stream , const OpenCIF::Size& command )
-{
-   output_stream << command.getWidth () << " " << command.getHeight ();
-   
-   return ( output_stream );
-}
-
 // FILE: boxcommand.cc
 
 
@@ -1352,6 +1215,7 @@ OpenCIF::CallCommand::CallCommand ( void )
    : ControlCommand ()
 {
    command_type = Call;
+   call_placement_stale = false;
 }
 
 /*
@@ -1374,6 +1238,7 @@ OpenCIF::CallCommand::CallCommand ( const std::string& str_command )
    : ControlCommand ()
 {
    command_type = Call;
+   call_placement_stale = false;
    
    std::istringstream input_stream ( str_command );
    read ( input_stream );
@@ -1387,13 +1252,45 @@ OpenCIF::CallCommand::~CallCommand ( void )
 }
 
 /*
- * This member function returns a copy of the vector with the transformations.
+ * This member function returns the vector with the transformations, so they can be modified.
+ * As the changes can't be seen, the placement is rebuilt every time it is asked for, until
+ * the transformations are set again. Read-only code must use the const overload.
  */
 std::vector< OpenCIF::Transformation >& OpenCIF::CallCommand::getTransformations ( void )
+{
+   call_placement_stale = true;
+   
+   return ( call_transformations );
+}
+
+/*
+ * Same as above, for read-only access.
+ */
+const std::vector< OpenCIF::Transformation >& OpenCIF::CallCommand::getTransformations ( void ) const
 {
    return ( call_transformations );
 }
 
+/*
+ * This member function returns the transformations reduced to a single placement. It is
+ * kept up to date while the transformations are added or set, so a loaded call has it ready.
+ * If the transformations were given out to be modified, a new placement is built instead;
+ * the call is never modified here, so many threads can ask for it at once.
+ */
+OpenCIF::Placement OpenCIF::CallCommand::getPlacement ( void ) const
+{
+   if ( call_placement_stale )
+   {
+      OpenCIF::Placement placement;
+      
+      placement.set ( call_transformations );
+      
+      return ( placement );
+   }
+   
+   return ( call_placement );
+}
+
 /*
  * This member function adds a single transformation to the transformation vector.
  */
@@ -1401,6 +1298,11 @@ void OpenCIF::CallCommand::addTransformation ( const OpenCIF::Transformation& ne
 {
    call_transformations.push_back ( new_transformation );
    
+   if ( !call_placement_stale )
+   {
+      call_placement.add ( new_transformation );
+   }
+   
    return;
 }
 
@@ -1411,9 +1313,25 @@ void OpenCIF::CallCommand::setTransformations ( const std::vector< OpenCIF::Tran
 {
    call_transformations.clear ();
    call_transformations = new_transformations;
+   call_placement.set ( call_transformations );
+   call_placement_stale = false;
+   
+   return;
+}
+
+# if __cplusplus >= 201103L
+/*
+ * Same as above, but moves the transformations instead of copying them.
+ */
+void OpenCIF::CallCommand::setTransformations ( std::vector< OpenCIF::Transformation >&& new_transformations )
+{
+   call_transformations = std::move ( new_transformations );
+   call_placement.set ( call_transformations );
+   call_placement_stale = false;
    
    return;
 }
+# endif
 
 /*
  * This overloaded operator helps to write a call command to a output stream.
@@ -1680,6 +1598,8 @@ OpenCIF::RawContentCommand::RawContentCommand ( void )
    : Command ()
 {
    command_type = RawContent;
+   command_span_begin = 0;
+   command_span_end = 0;
 }
 
 /*
@@ -1692,7 +1612,7 @@ OpenCIF::RawContentCommand::~RawContentCommand ( void  )
 /*
  * This member function returns the contents of the command.
  */
-std::string OpenCIF::RawContentCommand::getContent ( void ) const
+const std::string& OpenCIF::RawContentCommand::getContent ( void ) const
 {
    return ( command_content );
 }
@@ -1707,6 +1627,54 @@ void OpenCIF::RawContentCommand::setContent ( const std::string& new_contents )
    return;
 }
 
+# if __cplusplus >= 201103L
+/*
+ * Same as above, but moves the contents instead of copying them.
+ */
+void OpenCIF::RawContentCommand::setContent ( std::string&& new_contents )
+{
+   command_content = std::move ( new_contents );
+   
+   return;
+}
+# endif
+
+/*
+ * This member function sets the bytes of the source file where the command is, from its
+ * first char to its semicolon. It is used when the file is loaded with SpanAnnotations.
+ */
+void OpenCIF::RawContentCommand::setSpan ( const unsigned long int& begin , const unsigned long int& end )
+{
+   command_span_begin = begin;
+   command_span_end = end;
+   
+   return;
+}
+
+/*
+ * Member function to get the first byte of the span.
+ */
+unsigned long int OpenCIF::RawContentCommand::getSpanBegin ( void ) const
+{
+   return ( command_span_begin );
+}
+
+/*
+ * Member function to get the byte after the span.
+ */
+unsigned long int OpenCIF::RawContentCommand::getSpanEnd ( void ) const
+{
+   return ( command_span_end );
+}
+
+/*
+ * Member function to tell if the command has a span instead of its content.
+ */
+bool OpenCIF::RawContentCommand::hasSpan ( void ) const
+{
+   return ( command_span_end > command_span_begin );
+}
+
 // FILE: userextensioncommand.cc
 
 
@@ -1724,9 +1692,16 @@ OpenCIF::UserExtensionCommand::UserExtensionCommand ( const std::string& str_com
 {
    command_type = UserExtension;
    
-   std::istringstream input_stream ( str_command );
+   // The same as "read", straight from the string, without building a stream.
+   std::string::size_type begin = str_command.find_first_not_of ( ' ' );
    
-   read ( input_stream );
+   if ( begin != std::string::npos )
+   {
+      std::string::size_type end = str_command.find ( ';' , begin );
+      
+      command_content.assign ( str_command , begin , ( end == std::string::npos ) ? std::string::npos : end - begin );
+      command_content.erase ( command_content.find_last_not_of ( ' ' ) + 1 );
+   }
 }
 
 /*
@@ -1773,32 +1748,18 @@ void OpenCIF::UserExtensionCommand::print ( std::ostream& output_stream )
 
 void OpenCIF::UserExtensionCommand::read ( std::istream& input_stream )
 {
-   char character = ' ';
    std::string contents;
    
-   while ( character == ' ' )
-   {
-      character = input_stream.get ();
-   }
-   
-   contents = character;
-   
-   while ( character != ';' )
+   // Skip the blanks before the contents, and take everything up to the semicolon at once.
+   while ( input_stream.peek () == ' ' )
    {
-      character = input_stream.get ();
-      
-      if ( character != ';' )
-      {
-         contents += character;
-      }
+      input_stream.get ();
    }
    
-   while ( contents[ contents.size () - 1 ] == ' ' )
-   {
-      contents.erase ( contents.size () - 1 , 1 );
-   }
+   std::getline ( input_stream , contents , ';' );
+   contents.erase ( contents.find_last_not_of ( ' ' ) + 1 );
    
-   setContent ( contents );
+   command_content.swap ( contents );
    
    return;
 }
@@ -1820,9 +1781,28 @@ OpenCIF::CommentCommand::CommentCommand ( const std::string& str_command )
 {
    command_type = Comment;
    
-   std::istringstream input_stream ( str_command );
+   // The same as "read", straight from the string, without building a stream.
+   std::string::size_type begin = str_command.find ( '(' );
    
-   read ( input_stream );
+   if ( begin != std::string::npos )
+   {
+      std::string::size_type end = begin;
+      unsigned long int parentheses = 0;
+      
+      for ( ; end < str_command.size (); end++ )
+      {
+         if ( str_command[ end ] == '(' )
+         {
+            parentheses++;
+         }
+         else if ( str_command[ end ] == ')' && --parentheses == 0 )
+         {
+            break;
+         }
+      }
+      
+      command_content.assign ( str_command , begin , end - begin + 1 );
+   }
 }
 
 /*
@@ -1869,36 +1849,47 @@ void OpenCIF::CommentCommand::print ( std::ostream& output_stream )
 
 void OpenCIF::CommentCommand::read ( std::istream& input_stream )
 {
-   // Read chars until the parentheses end and I read the semicolon.
+   // Read chars until the parentheses end and I read the semicolon. The chars are taken
+   // straight from the stream buffer, without the checks of "get".
    
-   char character = '_';
+   std::streambuf* buffer = input_stream.rdbuf ();
+   const int end_of_file = std::char_traits< char >::eof ();
+   int character = 0;
    std::string content;
    
-   while ( character != '(' )
+   while ( character != '(' && character != end_of_file )
    {
-      character = input_stream.get ();
+      character = buffer->sbumpc ();
    }
    
    content = "(";
    
    unsigned long int parentheses = 1;
    
-   while ( parentheses != 0 )
+   while ( parentheses != 0 && character != end_of_file )
    {
-      character = input_stream.get ();
-      content += character;
+      character = buffer->sbumpc ();
       
-      parentheses += ( character == '(' ) ? 1 : ( character == ')' ) ? -1 : 0;
+      if ( character != end_of_file )
+      {
+         content += static_cast< char > ( character );
+         parentheses += ( character == '(' ) ? 1 : ( character == ')' ) ? -1 : 0;
+      }
    }
    
    // Ok, I have the last parentheses. Read and omit unti the semicolon
    
-   while ( character != ';' )
+   while ( character != ';' && character != end_of_file )
+   {
+      character = buffer->sbumpc ();
+   }
+   
+   if ( character == end_of_file )
    {
-      character = input_stream.get ();
+      input_stream.setstate ( std::ios::eofbit );
    }
    
-   setContent ( content );
+   command_content.swap ( content );
    
    return;
 }
@@ -1935,7 +1926,7 @@ OpenCIF::LayerCommand::~LayerCommand ( void )
 /*
  * Member function that returns the name of the layer.
  */
-std::string OpenCIF::LayerCommand::getName ( void ) const
+const std::string& OpenCIF::LayerCommand::getName ( void ) const
 {
    return ( layer_name );
 }
@@ -1950,6 +1941,18 @@ void OpenCIF::LayerCommand::setName ( const std::string& new_name )
    return;
 }
 
+# if __cplusplus >= 201103L
+/*
+ * Same as above, but moves the name instead of copying it.
+ */
+void OpenCIF::LayerCommand::setName ( std::string&& new_name )
+{
+   layer_name = std::move ( new_name );
+   
+   return;
+}
+# endif
+
 std::istream& operator>> ( std::istream& input_stream , OpenCIF::LayerCommand& command )
 {
    command.read ( input_stream );
@@ -2035,7 +2038,7 @@ void OpenCIF::State::addOptions ( const std::string& new_options , const int& ex
 {
    for ( unsigned int i = 0; i < new_options.size (); i++ )
    {
-      state_options[ (int)(new_options[ i ]) ] = exit_state;
+      state_options[ (unsigned char)(new_options[ i ]) ] = exit_state;
    }
    
    return;
@@ -2046,7 +2049,7 @@ void OpenCIF::State::addOptions ( const std::string& new_options , const int& ex
  */
 int OpenCIF::State::operator[] ( const char& input_char )
 {
-   return ( state_options[ (int)input_char ] );
+   return ( state_options[ (unsigned char)input_char ] );
 }
 
 // FILE: finitestatemachine.cc
@@ -2703,39 +2706,149 @@ int OpenCIF::CIFFSM::operator[] ( const char& input_char )
    return ( new_state );
 }
 
-void OpenCIF::CIFFSM::add ( const int& input_state, const std::string& input_chars, const int& output_state )
-{
-   FiniteStateMachine::add ( input_state , input_chars , output_state );
-   
-   return;
-}
-
-// FILE: file.cc
-
-
-/*
- * Default constructor. Nothing to do.
- */
-OpenCIF::File::File ( void )
-{
-}
-
 /*
- * Destructor. Delete the commands stored (if any).
+ * Member function to feed a block of chars to the FSM at once. Returns the amount of
+ * chars accepted: if it is less than the length of the block, the char at such
+ * position is invalid, and the FSM is left at the last valid state (so it can be
+ * reported).
+ * 
+ * This is the same as using the operator[] with every char, but the transitions are
+ * looked up directly in the loop, and the contents of the comments are skipped while
+ * searching for the parentheses.
  */
-OpenCIF::File::~File ( void )
+unsigned long int OpenCIF::CIFFSM::feed ( const char* input_chars , const unsigned long int& length )
 {
-   for ( unsigned int i = 0; i < file_commands.size (); i++ )
+   int state = fsm_current_state;
+   int new_state = -1;
+   
+   for ( unsigned long int i = 0; i < length; i++ )
    {
-      delete file_commands[ i ];
-      file_commands[ i ] = 0;
-   }
-}
-
-/*
- * Member function to return the commands vector.
- */
-std::vector< OpenCIF::Command* > OpenCIF::File::getCommands ( void ) const
+      if ( state == 89 )
+      {
+         // Inside a comment, every char but the parentheses is accepted.
+         while ( i < length && input_chars[ i ] != '(' && input_chars[ i ] != ')' )
+         {
+            i++;
+         }
+         
+         if ( i == length )
+         {
+            break;
+         }
+      }
+      
+      if ( state == 89 || ( state == 1 && input_chars[ i ] == '(' ) )
+      {
+         fsm_current_state = state;
+         new_state = operator[] ( input_chars[ i ] );
+      }
+      else
+      {
+         new_state = fsm_states[ state ][ input_chars[ i ] ];
+      }
+      
+      if ( new_state == -1 )
+      {
+         fsm_current_state = state;
+         
+         return ( i );
+      }
+      
+      state = new_state;
+   }
+   
+   fsm_current_state = state;
+   
+   return ( length );
+}
+
+/*
+ * Member function to reset the FSM, including the parentheses counter.
+ */
+void OpenCIF::CIFFSM::reset ( void )
+{
+   FiniteStateMachine::reset ();
+   parentheses = 0;
+   
+   return;
+}
+
+void OpenCIF::CIFFSM::add ( const int& input_state, const std::string& input_chars, const int& output_state )
+{
+   FiniteStateMachine::add ( input_state , input_chars , output_state );
+   
+   return;
+}
+
+// FILE: file.cc
+
+
+namespace
+{
+   /*
+    * These functions store a value of up to 48 bits (a byte of the file, or a length) in 6
+    * chars, and read it back. They pack the spans of the annotations into raw commands.
+    */
+   inline void packSpanValue ( char* bytes , unsigned long int value )
+   {
+      for ( int i = 0; i < 6; i++ )
+      {
+         bytes[ i ] = static_cast< char > ( value & 0xFF );
+         value >>= 8;
+      }
+      
+      return;
+   }
+   
+   inline unsigned long int unpackSpanValue ( const char* bytes )
+   {
+      unsigned long int value = 0;
+      
+      for ( int i = 5; i >= 0; i-- )
+      {
+         value = ( value << 8 ) | static_cast< unsigned char > ( bytes[ i ] );
+      }
+      
+      return ( value );
+   }
+}
+
+/*
+ * Default constructor. Nothing to do.
+ */
+OpenCIF::File::File ( void )
+{
+   file_line_index_built = false;
+   file_error_limit = 1000;
+   file_annotation_mode = KeepAnnotations;
+   file_extension_registry = 0;
+   file_progress_callback = 0;
+   file_progress_user_data = 0;
+   file_cancellation_token = 0;
+   file_bytes_read = 0;
+   file_raw_flushed = 0;
+   
+# if __cplusplus >= 201103L
+   file_raw_batches = 0;
+# endif
+}
+
+/*
+ * Destructor. Delete the commands stored (if any).
+ */
+OpenCIF::File::~File ( void )
+{
+   for ( unsigned int i = 0; i < file_commands.size (); i++ )
+   {
+      delete file_commands[ i ];
+      file_commands[ i ] = 0;
+   }
+}
+
+/*
+ * Member function to return the commands vector.
+ */
+const std::vector< OpenCIF::Command* >& OpenCIF::File::getCommands ( void ) const
 {
    return ( file_commands );
 }
@@ -2758,6 +2871,19 @@ void OpenCIF::File::setCommands ( const std::vector< OpenCIF::Command* >& new_co
    return;
 }
 
+# if __cplusplus >= 201103L
+/*
+ * Member function to take over a vector of commands without copying it. The pointers are
+ * owned by the file from now on, as with the copying version.
+ */
+void OpenCIF::File::setCommands ( std::vector< OpenCIF::Command* >&& new_commands )
+{
+   file_commands = std::move ( new_commands );
+   
+   return;
+}
+# endif
+
 /*
  * Member function to release the vector of commands.
  */
@@ -2782,7 +2908,7 @@ void OpenCIF::File::setPath ( const std::string& new_path )
 /*
  * Member function to return the messages generated during the load of the file.
  */
-std::vector< std::string > OpenCIF::File::getMessages ( void )
+const std::vector< std::string >& OpenCIF::File::getMessages ( void ) const
 {
    return ( file_messages );
 }
@@ -2805,8 +2931,24 @@ OpenCIF::File::LoadStatus OpenCIF::File::loadFile ( const LoadMethod& load_metho
    }
    
    end_status = validateSyntax ( load_method );
+   
+   if ( load_method == ValidateOnly )
+   {
+      return ( end_status );
+   }
+   
+   if ( end_status == LoadCancelled )
+   {
+      return ( end_status );
+   }
+   
    cleanCommands ();
    
+   if ( isCancelled () )
+   {
+      return ( cancelLoad () );
+   }
+   
    if ( end_status != AllOk && load_method != ContinueOnError )
    {
       return ( end_status );
@@ -2814,659 +2956,8293 @@ OpenCIF::File::LoadStatus OpenCIF::File::loadFile ( const LoadMethod& load_metho
    
    convertCommands ();
    
+   if ( isCancelled () )
+   {
+      return ( cancelLoad () );
+   }
+   
    return ( end_status );
 }
 
 /*
- * This member function try to open the input file.
+ * This member function frees the commands (raw and converted) of a cancelled load,
+ * and returns the status to report.
  */
-OpenCIF::File::LoadStatus OpenCIF::File::openFile ( void )
+OpenCIF::File::LoadStatus OpenCIF::File::cancelLoad ( void )
 {
-   if ( file_input.is_open () )
+   for ( unsigned int i = 0; i < file_commands.size (); i++ )
    {
-      file_messages.push_back ( std::string ( "File:openFile:Warning: Input file already opened. Closing." ) );
-      file_input.close ();
+      delete file_commands[ i ];
    }
    
-   file_input.open ( file_path.c_str () );
-   
-   if ( !file_input.is_open () )
-   {
-      file_messages.push_back ( std::string ( "File:openFile:Error: Can't open input file." ) );
-      
-      return ( CantOpenInputFile );
-   }
+   std::vector< OpenCIF::Command* > ().swap ( file_commands );
+   std::vector< std::string > ().swap ( file_raw_commands );
+   file_messages.push_back ( std::string ( "File:loadFile:Warning: The load was cancelled." ) );
    
-   return ( AllOk );
+   return ( LoadCancelled );
 }
 
+# if __cplusplus >= 201103L
 /*
- * This member function validates the contents of the input file using
- * a finite state machine.
+ * Member function to load the input file in another thread. The result of the load
+ * can be obtained from the future returned. The progress callback (if any) is called
+ * from such thread. The instance must not be used until the load is finished.
  */
-OpenCIF::File::LoadStatus OpenCIF::File::validateSyntax ( const LoadMethod& load_method )
+std::future< OpenCIF::File::LoadStatus > OpenCIF::File::loadFileAsync ( const LoadMethod& load_method )
 {
-   /*
-    * The process of validation isn't that complex.
-    * 
-    * I need to create a CIFFSM class instance. Such instance will help me to validate
-    * the file contents. The file is already opened. So, I'll read char by char and feed
-    * them to the CIFFSM instance. The CIFFSM instance will start, by default, in state 1.
-    * 
-    * I'll feed the instance characters until I reach the end of file or the instance reports
-    * an error (jump state equal to -1). After feeding the characters, if I finish feeding the
-    * file and none error was reported, I will check the current state of the instance.
-    * 
-    * The instance should end in state 91 or 92. If the FSM is in such states, the file is 
-    * correct and the format is supported.
-    * 
-    * If the FSM ends in any other state, the file is not neccessarally incorrect, but incomplete.
-    * 
-    * If there is a jump to a negative state, the file is invalid.
-    */
+   return ( std::async ( std::launch::async , &OpenCIF::File::loadFile , this , load_method ) );
+}
+# endif
+
+/*
+ * Member function to load the input file as a pipeline: a thread reads the file in
+ * blocks, another one validates the blocks, another one cleans and converts the raw
+ * commands (in batches), and the calling thread collects the converted batches. Every
+ * batch can be passed to a function (for example, to index the geometry) as soon as
+ * it is converted.
+ * 
+ * The stages are connected by bounded queues. A full queue makes its producer sleep,
+ * so the memory used doesn't depend on the size of the file. The result is the same
+ * one of loadFile, but the raw commands are not kept.
+ * 
+ * With StopOnError, an error deletes every command, so the batches are held until the
+ * validation ends without errors (then the held ones are passed, and the rest as they
+ * come); if there is an error, the function is never called. With ContinueOnError the
+ * batches are passed as soon as they are converted.
+ * 
+ * Without C++11 support there are no threads: the file is loaded with loadFile and
+ * the commands are passed to the function as a single batch.
+ */
+OpenCIF::File::LoadStatus OpenCIF::File::loadFilePipelined ( const LoadMethod& load_method , BatchCallback batch_callback , void* user_data )
+{
+   LoadStatus end_status;
    
-   OpenCIF::CIFFSM* fsm;
-   std::string command_buffer;
-   int jump_state = 1; // By default, start in 1
-   int previous_state; // Previous state.
-   char input_char;
-   char previous_char;
-   bool errors_omited = false;
+# if __cplusplus >= 201103L
+   if ( load_method == ValidateOnly )
+   {
+      return ( loadFile ( load_method ) );
+   }
    
-   fsm = new OpenCIF::CIFFSM ();
+   file_messages.clear ();
    
-   file_raw_commands.clear ();
+   end_status = openFile ();
    
-   // Iterate over the contents of the file, until the file end is
-   // reached or the FSM reports a problem.
+   if ( end_status != AllOk )
+   {
+      return ( end_status );
+   }
    
-   while ( !file_input.eof () && jump_state != -1 )
+   for ( unsigned int i = 0; i < file_commands.size (); i++ )
    {
-      previous_char = input_char;
-      input_char = file_input.get ();
+      delete file_commands[ i ];
+   }
+   
+   file_commands.clear ();
+   
+   OpenCIF::SPSCQueue< std::string* > blocks ( 8 );                           // 8 blocks of 1 MiB.
+   OpenCIF::SPSCQueue< std::vector< std::string >* > raw_batches ( 16 );      // 16 batches of 4096 commands.
+   OpenCIF::SPSCQueue< std::vector< OpenCIF::Command* >* > command_batches ( 16 );
+   std::atomic< bool > validation_passed ( false );
    
-      if ( !file_input.eof () )
+   file_raw_batches = &raw_batches;
+   
+   // Reader. An empty block marks the end of the file.
+   std::thread reader ( [ & ] ( void )
+   {
+      bool finished = false;
+      
+      while ( !finished )
       {
-         previous_state = jump_state;
-         jump_state = fsm->operator[] ( input_char );
+         std::string* block = new std::string ( 1 << 20 , '\0' );
          
-         if ( jump_state == 1 && previous_state != 1 ) // If I'm returning to the first state, the command
-                                                       // is loaded. Just check the previous state. If the
-                                                       // previous state is the state 1, then, do nothing,
-                                                       // since those are characteres to skip.
-         {
-            std::string tmp;
-            tmp = input_char;
-            command_buffer += tmp;
-            
-            // I call the CleanCommand member function to remove unnecesary characters.
-            file_raw_commands.push_back ( command_buffer );
-            command_buffer = "";
-         }
-         else if ( jump_state != 1 && jump_state != -1 )
+         file_input.read ( &( *block )[ 0 ] , block->size () );
+         block->resize ( file_input.gcount () );
+         finished = block->empty ();
+         
+         // If the validation stopped, nobody is going to read the block.
+         if ( !blocks.push ( block ) )
          {
-            std::string tmp;
-            tmp = input_char;
-            command_buffer += tmp;
+            delete block;
+            return;
          }
+      }
+   } );
+   
+   // Validator. The stream reads the blocks from the queue. A null batch marks the end.
+   std::thread validator ( [ & ] ( void )
+   {
+      OpenCIF::BlockQueueBuffer buffer ( blocks );
+      std::istream input ( &buffer );
+      
+      end_status = validateStream ( input , load_method );
+      
+      if ( end_status == AllOk || ( end_status == IncorrectInputFile && load_method == ContinueOnError ) )
+      {
+         flushRawCommands ();
+      }
+      
+      blocks.close ();
+      validation_passed = ( end_status == AllOk );
+      raw_batches.push ( 0 );
+   } );
+   
+   // Converter. The batches are cleaned and converted. A null batch marks the end.
+   std::thread converter ( [ & ] ( void )
+   {
+      std::vector< std::string >* raw_batch = 0;
+      
+      do
+      {
+         raw_batches.pop ( raw_batch );
          
-         // Check if the current jump state is to an error. 
-         // If so, and the load method indicates "ContinueOnError", reset the FSM
-         // to state 1, reset the current jumps to 1, clean the command buffer and skip chars until a semicolon
+         std::vector< OpenCIF::Command* >* command_batch = 0;
          
-         if ( jump_state == -1 && load_method == ContinueOnError )
+         if ( raw_batch != 0 )
          {
-            fsm->reset ();
-            jump_state = 1;
-            errors_omited = true;
-            command_buffer = "";
+            command_batch = new std::vector< OpenCIF::Command* > ();
+            command_batch->reserve ( raw_batch->size () );
             
-            file_input.putback ( input_char );
-            file_raw_commands.push_back ( "(LibOpenCIF: Incorrect command here) ;" );
+            for ( unsigned long int i = 0; i < raw_batch->size () && !isCancelled (); i++ )
+            {
+               OpenCIF::Command* command = convertCommand ( cleanCommand ( ( *raw_batch )[ i ] ) );
+               
+               if ( command != 0 )
+               {
+                  command_batch->push_back ( command );
+               }
+            }
+            
+            delete raw_batch;
          }
+         
+         command_batches.push ( command_batch );
       }
-   }
+      while ( raw_batch != 0 );
+   } );
    
-   // File validated. What is the result?
-   std::ostringstream oss;
+   // Collector (this thread). With StopOnError the batches are held until the validation passes.
+   std::vector< OpenCIF::Command* >* command_batch = 0;
+   std::vector< std::vector< OpenCIF::Command* >* > held_batches;
+   bool pass_batches = ( load_method == ContinueOnError );
    
-   if ( jump_state == -1 )
+   do
    {
-      std::string tmp;
+      command_batches.pop ( command_batch );
       
-      // There is an invalid input.
-      file_messages.push_back ( std::string ( "File:validateSintax:Error: Error detected when validating contents of input file." ) );
-      
-      oss << previous_state;
-      
-      file_messages.push_back ( std::string ( "                           State: " ) + oss.str () );
-      
-      oss.str ( std::string ( "" ) );
-      oss << (char)previous_char;
-      
-      tmp = tmp;
-      
-      file_messages.push_back ( std::string ( "                           Input char: \"" ) +
-                                tmp +
-                                std::string ( "\" (ASCII=" ) +
-                                (
-                                   ( oss.str ( std::string ( "" ) ) , oss << (int)previous_char ) ,
-                                   oss.str ()
-                                ) +
-                                std::string ( ")" )
-                              );
-      
-      file_messages.push_back ( std::string ( "                           Current command buffer: \"" ) + command_buffer + std::string ( "\"" ) );
-      file_messages.push_back ( std::string ( "                           The loaded raw commands can be accessed to analize the error and locate the error." ) );
+      if ( !pass_batches && validation_passed )
+      {
+         for ( unsigned long int i = 0; i < held_batches.size (); i++ )
+         {
+            if ( batch_callback != 0 && !isCancelled () )
+            {
+               batch_callback ( *held_batches[ i ] , user_data );
+            }
+            
+            delete held_batches[ i ];
+         }
+         
+         held_batches.clear ();
+         pass_batches = true;
+      }
       
-      return ( IncorrectInputFile );
+      if ( command_batch != 0 )
+      {
+         file_commands.insert ( file_commands.end () , command_batch->begin () , command_batch->end () );
+         
+         if ( !pass_batches )
+         {
+            held_batches.push_back ( command_batch );
+            continue;
+         }
+         
+         if ( batch_callback != 0 && !isCancelled () )
+         {
+            batch_callback ( *command_batch , user_data );
+         }
+         
+         delete command_batch;
+      }
    }
+   while ( command_batch != 0 );
    
-   if ( jump_state != 91 && jump_state != 92 )
+   // Only left when the validation failed: the commands are deleted below, without being passed.
+   for ( unsigned long int i = 0; i < held_batches.size (); i++ )
    {
-      file_messages.push_back ( std::string ( "File:validateSintax:Error: The file contents are incomplete (maybe a missing END command)." ) );
-      
-      return ( IncompleteInputFile );
+      delete held_batches[ i ];
    }
    
-   // Everything Ok. Add last command (the END command)
-   file_raw_commands.push_back ( cleanCommand ( command_buffer ) );
+   reader.join ();
+   validator.join ();
+   converter.join ();
    
-   return ( ( errors_omited) ? IncorrectInputFile : AllOk );
-}
-
-void OpenCIF::File::cleanCommands ( void )
-{
-   for ( unsigned long int i = 0; i < file_raw_commands.size (); i++ )
+   file_raw_batches = 0;
+   
+   // The blocks not read by the validator.
+   std::string* block;
+   
+   while ( blocks.tryPop ( block ) )
    {
-      file_raw_commands[ i ] = cleanCommand ( file_raw_commands[ i ] );
+      delete block;
    }
    
-   return;
+   if ( isCancelled () )
+   {
+      return ( cancelLoad () );
+   }
+   
+   // Like loadFile, with "StopOnError" nothing is converted if there is an error.
+   if ( end_status != AllOk && load_method != ContinueOnError )
+   {
+      for ( unsigned int i = 0; i < file_commands.size (); i++ )
+      {
+         delete file_commands[ i ];
+      }
+      
+      file_commands.clear ();
+   }
+   
+   decodeExtensions ();
+# else
+   end_status = loadFile ( load_method );
+   
+   if ( batch_callback != 0 && ( end_status == AllOk || load_method == ContinueOnError ) )
+   {
+      batch_callback ( file_commands , user_data );
+   }
+# endif
+   
+   return ( end_status );
 }
 
 /*
- * This member function loads the contents of the input file and converts them
- * into Command instances.
+ * Member function to set the function called to report the progress of the loads.
+ * The user data is passed to the function as it is.
  */
-void OpenCIF::File::convertCommands ( void )
+void OpenCIF::File::setProgressCallback ( ProgressCallback new_callback , void* new_user_data )
 {
-   /*
-    * The raw commands are ready and validated. So, there is only left the process of
-    * turning those strings into commands.
-    */
+   file_progress_callback = new_callback;
+   file_progress_user_data = new_user_data;
    
-   // First, delete and clear the current commands vector
-   for ( unsigned int i = 0; i < file_commands.size (); i++ )
+   return;
+}
+
+/*
+ * Member function to set the token checked to know if the load must stop. The token
+ * isn't owned by the instance, and it must live while the instance is loading.
+ */
+void OpenCIF::File::setCancellationToken ( OpenCIF::CancellationToken* new_token )
+{
+   file_cancellation_token = new_token;
+   
+   return;
+}
+
+/*
+ * This member function reports the progress (if there is a callback) and returns
+ * false if the load was cancelled.
+ */
+bool OpenCIF::File::keepLoading ( const unsigned long int& bytes , const unsigned long int& commands )
+{
+   if ( file_progress_callback != 0 )
    {
-      delete file_commands[ i ];
-      file_commands[ i ] = 0;
+      file_progress_callback ( bytes , commands , file_progress_user_data );
    }
    
-   file_commands.clear ();
+   return ( !isCancelled () );
+}
+
+/*
+ * Member function to know if the current load was cancelled.
+ */
+bool OpenCIF::File::isCancelled ( void ) const
+{
+   return ( file_cancellation_token != 0 && file_cancellation_token->isCancelled () );
+}
+
+/*
+ * Member function to load a single symbol definition, and every symbol called by it
+ * (directly or not), using an index of the file.
+ */
+OpenCIF::File::LoadStatus OpenCIF::File::loadSymbol ( const unsigned long int& id , const OpenCIF::SymbolIndex& index )
+{
+   return ( loadSymbols ( std::vector< unsigned long int > ( 1 , id ) , index ) );
+}
+
+/*
+ * Member function to load some symbol definitions, and every symbol called by them
+ * (directly or not), without an index. The whole file is validated (storing nothing),
+ * then indexed, and only the bytes of the retained definitions are read again: the
+ * rest of the commands are never stored. The result is the same of loading them with
+ * an index of the file.
+ */
+OpenCIF::File::LoadStatus OpenCIF::File::loadSymbols ( const std::vector< unsigned long int >& ids )
+{
+   LoadStatus end_status;
+   OpenCIF::SymbolIndex index;
+   std::set< unsigned long int > closure;
    
-   // Iterate over the raw commands. Check the first char of all. The first char will tell me exactly
-   // wich command type is every one.
+   file_messages.clear ();
    
-   for ( unsigned long int i = 0; i < file_raw_commands.size (); i++ )
+   if ( ids.empty () )
    {
-      std::string str_command;
-      OpenCIF::Command* command;
+      file_messages.push_back ( std::string ( "File:loadSymbols:Error: No symbol was requested." ) );
       
-      str_command = file_raw_commands[ i ];
+      return ( IncorrectInputFile );
+   }
+   
+   end_status = openFile ();
+   
+   if ( end_status != AllOk )
+   {
+      return ( end_status );
+   }
+   
+   end_status = validateSyntax ( ValidateOnly );
+   file_input.close ();
+   
+   if ( end_status != AllOk )
+   {
+      return ( end_status );
+   }
+   
+   if ( !index.build ( file_path ) )
+   {
+      file_messages.insert ( file_messages.end () , index.getMessages ().begin () , index.getMessages ().end () );
       
-      switch ( str_command[ 0 ] )
+      return ( CantOpenInputFile );
+   }
+   
+   for ( unsigned long int i = 0; i < ids.size (); i++ )
+   {
+      if ( !index.hasSymbol ( ids[ i ] ) )
       {
-         case 'B':
-            command = new OpenCIF::BoxCommand ( str_command );
-            file_commands.push_back ( command );
-            break;
-            
-         case 'P':
-            command = new OpenCIF::PolygonCommand ( str_command );
-            file_commands.push_back ( command );
-            break;
-            
-         case 'W':
-            command = new OpenCIF::WireCommand ( str_command );
-            file_commands.push_back ( command );
-            break;
-            
-         case 'R':
-            command = new OpenCIF::RoundFlashCommand ( str_command );
-            file_commands.push_back ( command );
-            break;
-            
-         case '(':
-            command = new OpenCIF::CommentCommand ( str_command );
-            file_commands.push_back ( command );
-            break;
-            
-         case 'C':
-            command = new OpenCIF::CallCommand ( str_command );
-            file_commands.push_back ( command );
-            break;
-            
-         case 'D':
-            switch ( str_command[ 2 ] )
-            {
-               case 'D':
-                  command = new OpenCIF::DefinitionDeleteCommand ( str_command );
-                  file_commands.push_back ( command );
-                  break;
-                  
-               case 'F':
-                  command = new OpenCIF::DefinitionEndCommand ( str_command );
-                  file_commands.push_back ( command );
-                  break;
-                  
-               case 'S':
-                  command = new OpenCIF::DefinitionStartCommand ( str_command );
-                  file_commands.push_back ( command );
-                  break;
-            }
-            break;
-            
-         case 'L':
-            command = new OpenCIF::LayerCommand ( str_command );
-            file_commands.push_back ( command );
-            break;
-            
-         case 'E':
-            command = new OpenCIF::EndCommand ();
-            file_commands.push_back ( command );
-            break;
-            
-         default:
-            command = new OpenCIF::UserExtensionCommand ( str_command );
-            file_commands.push_back ( command );
-            break;
+         std::ostringstream oss;
+         oss << "File:loadSymbols:Warning: The symbol " << ids[ i ] << " isn't defined in the input file.";
+         file_messages.push_back ( oss.str () );
       }
    }
    
-   return;
+   closure = index.getClosure ( ids );
+   
+   if ( closure.empty () )
+   {
+      file_messages.push_back ( std::string ( "File:loadSymbols:Error: None of the symbols is defined in the input file." ) );
+      
+      return ( IncorrectInputFile );
+   }
+   
+   return ( loadRanges ( closure , index ) );
 }
 
 /*
- * This member function returns the vector of the raw (string) commands of the file.
+ * Member function to load some symbol definitions, and every symbol called by them
+ * (directly or not), using an index of the file. Only the bytes of such definitions
+ * are read, and an END command is added after them. The commands are validated and
+ * converted as usual (layer filter included).
  */
-std::vector< std::string > OpenCIF::File::getRawCommands ( void ) const
+OpenCIF::File::LoadStatus OpenCIF::File::loadSymbols ( const std::vector< unsigned long int >& ids , const OpenCIF::SymbolIndex& index )
 {
-   return ( file_raw_commands );
+   std::set< unsigned long int > closure;
+   
+   file_messages.clear ();
+   
+   if ( ids.empty () )
+   {
+      file_messages.push_back ( std::string ( "File:loadSymbols:Error: No symbol was requested." ) );
+      
+      return ( IncorrectInputFile );
+   }
+   
+   for ( unsigned long int i = 0; i < ids.size (); i++ )
+   {
+      if ( !index.hasSymbol ( ids[ i ] ) )
+      {
+         std::ostringstream oss;
+         oss << "File:loadSymbols:Warning: The symbol " << ids[ i ] << " isn't in the index.";
+         file_messages.push_back ( oss.str () );
+      }
+   }
+   
+   closure = index.getClosure ( ids );
+   
+   if ( closure.empty () )
+   {
+      file_messages.push_back ( std::string ( "File:loadSymbols:Error: None of the symbols is in the index." ) );
+      
+      return ( IncorrectInputFile );
+   }
+   
+   return ( loadRanges ( closure , index ) );
 }
 
 /*
- * This member function takes as argument a command in string form. The command is "not clear". That means
- * that is in the same way it was readed from the file.
- * 
- * The process of cleaning is to delete anything that is not intented to exist and leave only that things that can make
- * the command easy to parse.
- * 
- * For example, from this: "P-100,10000thisisvalid-10000cuac,cuac,cuac,imaduck-20000yolo;"
- * To this:                "P -100 10000 -10000 -20000 ;"
- * 
- * So, such kind of string can be used as an input stream to read easily.
- * 
- * There are some commands that I can't clean, like the comment or user expansion commands. Those commands are just returned.
- * 
- * At least, I can know what kind of command I'm working with by it's first char.
+ * Private member function to load the definitions of some symbols, reading only their
+ * bytes (given by the index). An END command is added after them.
  */
-std::string OpenCIF::File::cleanCommand ( std::string command )
+OpenCIF::File::LoadStatus OpenCIF::File::loadRanges ( const std::set< unsigned long int >& symbols , const OpenCIF::SymbolIndex& index )
 {
-   std::string final_command;
+   LoadStatus end_status = openFile ();
    
-   switch ( command[ 0 ] )
+   if ( end_status != AllOk )
    {
-      // All of these commands can be processed as the same, since they only need values.
-      case 'P':
-      case 'B':
-      case 'W':
-      case 'R':
-         final_command = clearNumericCommand ( command );
-         break;
-         
-      case 'L': // Layer command
-         final_command = cleanLayerCommand ( command );
-         break;
-         
-      case 'C': // Call command
-         final_command = cleanCallCommand ( command );
-         break;
-         
-      case 'D': // Definition {Start|End|Delete} command.
-         final_command = cleanDefinitionCommand ( command );
-         break;
-         
-      case 'E': // End command.
-         final_command = "E ;";
-         break;
-         
-      default:
-         final_command = command.substr ( 0 , command.size () - 1 ) + " ;";
-         break;
+      return ( end_status );
    }
    
-   return ( final_command );
+   // An index of another version of the file has ranges that mean nothing.
+   file_input.seekg ( 0 , std::ios::end );
+   
+   if ( (unsigned long int)file_input.tellg () != index.getFileSize () )
+   {
+      file_messages.push_back ( std::string ( "File:loadSymbols:Error: The index doesn't belong to the input file (the size is different)." ) );
+      file_input.close ();
+      
+      return ( IncorrectInputFile );
+   }
+   
+   // The definitions are loaded in the same order they have in the file.
+   for ( std::set< unsigned long int >::const_iterator i = symbols.begin (); i != symbols.end (); i++ )
+   {
+      OpenCIF::SymbolIndex::Symbol symbol = index.getSymbol ( *i );
+      
+      file_load_ranges.push_back ( std::make_pair ( symbol.begin , symbol.end ) );
+   }
+   
+   std::sort ( file_load_ranges.begin () , file_load_ranges.end () );
+   
+   file_input.clear ();
+   end_status = validateSyntax ( StopOnError );
+   file_load_ranges.clear ();
+   
+   if ( end_status != AllOk )
+   {
+      return ( end_status );
+   }
+   
+   cleanCommands ();
+   convertCommands ();
+   
+   if ( isCancelled () )
+   {
+      return ( cancelLoad () );
+   }
+   
+   return ( end_status );
 }
 
 /*
- * This member function takes as argument a string that, maybe, is a CIF command.
- * 
- * The operation done is similar to the one performed when loading a CIF file, but
- * applied directly to a string. The idea is to validate a single string as a service
- * for the user.
+ * This member function try to open the input file.
  */
-bool OpenCIF::File::isCommandValid ( std::string command )
+OpenCIF::File::LoadStatus OpenCIF::File::openFile ( void )
+{
+   if ( file_input.is_open () )
+   {
+      file_messages.push_back ( std::string ( "File:openFile:Warning: Input file already opened. Closing." ) );
+      file_input.close ();
+   }
+   
+   // The index of lines belongs to the previous contents.
+   file_line_starts.clear ();
+   file_line_index_built = false;
+   
+   // Binary mode, so the byte offsets reported are the same in every system.
+   file_input.open ( file_path.c_str () , std::ios::in | std::ios::binary );
+   
+   if ( !file_input.is_open () )
+   {
+      file_messages.push_back ( std::string ( "File:openFile:Error: Can't open input file." ) );
+      
+      return ( CantOpenInputFile );
+   }
+   
+   return ( AllOk );
+}
+
+/*
+ * This member function validates the contents of the input file using
+ * a finite state machine.
+ */
+OpenCIF::File::LoadStatus OpenCIF::File::validateSyntax ( const LoadMethod& load_method )
 {
    /*
     * The process of validation isn't that complex.
     * 
     * I need to create a CIFFSM class instance. Such instance will help me to validate
-    * the command contents. I'll read char by char and feed them to the CIFFSM instance.
-    * The CIFFSM instance will start, by default, in state 1.
+    * the file contents. The file is already opened. So, I'll read char by char and feed
+    * them to the CIFFSM instance. The CIFFSM instance will start, by default, in state 1.
     * 
-    * I'll feed the instance characters until I reach the end of the command or the instance reports
+    * I'll feed the instance characters until I reach the end of file or the instance reports
     * an error (jump state equal to -1). After feeding the characters, if I finish feeding the
-    * command and none error was reported, I will check the current state of the instance.
+    * file and none error was reported, I will check the current state of the instance.
     * 
-    * The instance should end in state 91 or 92. If the FSM is in such states, the command is 
+    * The instance should end in state 91 or 92. If the FSM is in such states, the file is 
     * correct and the format is supported.
     * 
-    * If there is a jump to a negative state, the command is invalid.
-    * 
-    * Also, I'm considering an invalid a string like this one:
-    * 
-    * this.is.an.invalid.string
-    * 
-    * Such string, according to the FSM used, is valid, since all of those characters are considered
-    * "Black characters", they are chars used to add spaces between commands.
+    * If the FSM ends in any other state, the file is not neccessarally incorrect, but incomplete.
     * 
-    * So, what I'm considering a valid command? A string that *has* a valid command. If none valid
-    * command is found, then, even if the FSM says no invalid char is found, I'm going to return
-    * false, since a technically empty string doesn't count as a command.
+    * If there is a jump to a negative state, the file is invalid.
     */
    
-   OpenCIF::CIFFSM* fsm;
+   if ( load_method == ValidateOnly )
+   {
+      return ( scanSyntax () );
+   }
    
-   int jump_state = 1; // By default, start in 1
-   char input_char;
-   bool cif_command_found = false; // Flag to prevent validating strings that are, technically speaking, empty.
+   return ( validateStream ( file_input , load_method ) );
+}
+
+/*
+ * This member function performs the validation described in validateSyntax, reading
+ * the chars from any input stream (the input file, or the blocks read by another
+ * thread when loading with a pipeline). The raw commands found are stored with
+ * storeRawCommand.
+ */
+OpenCIF::File::LoadStatus OpenCIF::File::validateStream ( std::istream& input , const LoadMethod& load_method )
+{
+   // Building the FSM is expensive, so every thread builds a prototype once (if possible).
+   // Every scan works on its own copy: a progress callback can load another file.
+# if __cplusplus >= 201103L
+   static thread_local const OpenCIF::CIFFSM prototype;
+   OpenCIF::CIFFSM fsm ( prototype );
+# else
+   OpenCIF::CIFFSM fsm;
+# endif
+   std::string command_buffer;
+   int jump_state = 1; // By default, start in 1
+   int previous_state; // Previous state.
+   char input_char;
+   unsigned long int input_offset = 0; // Position in the file of the input char.
+   unsigned long int next_offset = 0;
+   bool errors_omited = false;
    
-   fsm = new OpenCIF::CIFFSM ();
+   // Layer filtering. The FSM still sees every character, but the primitives drawn on
+   // layers not selected are never stored, so they are never cleaned or converted.
+   bool filter_layers = !file_layer_filter.empty ();
+   bool skip_command = false;
+   std::string current_layer;
    
-   // Iterate over the contents of the string, until the string end is
+   // Annotations (comments and user extensions) are skipped the same way, unless they are kept.
+   // Their first char ('(' or a digit) is remembered, with the byte where they begin.
+   char annotation_kind = 0;
+   unsigned long int annotation_begin = 0;
+   
+   // Ranges of bytes to validate. Without ranges, the whole file is validated.
+   unsigned long int range = 0;
+   unsigned long int range_end = (unsigned long int)-1;
+   
+   file_raw_commands.clear ();
+   file_raw_flushed = 0;
+   file_errors.clear ();
+   
+   if ( !file_load_ranges.empty () )
+   {
+      input.seekg ( file_load_ranges[ 0 ].first );
+      next_offset = file_load_ranges[ 0 ].first;
+      range_end = file_load_ranges[ 0 ].second;
+   }
+   
+   // Iterate over the contents of the file, until the file end is
    // reached or the FSM reports a problem.
    
-   for ( unsigned int i = 0; i < command.size () && jump_state != -1; i++ )
+   while ( !input.eof () && jump_state != -1 )
+   {
+      if ( next_offset == range_end )
+      {
+         // Jump to the next range (if any).
+         if ( ++range == file_load_ranges.size () )
+         {
+            break;
+         }
+         
+         input.seekg ( file_load_ranges[ range ].first );
+         next_offset = file_load_ranges[ range ].first;
+         range_end = file_load_ranges[ range ].second;
+      }
+      
+      input_char = input.get ();
+      input_offset = next_offset++;
+      
+      if ( ( input_offset & 0xFFFF ) == 0 && !keepLoading ( input_offset , file_raw_flushed + file_raw_commands.size () ) )
+      {
+         std::vector< std::string > ().swap ( file_raw_commands );
+         file_messages.push_back ( std::string ( "File:validateSintax:Warning: The load was cancelled." ) );
+         
+         return ( LoadCancelled );
+      }
+   
+      if ( !input.eof () )
+      {
+         previous_state = jump_state;
+         jump_state = fsm[ input_char ];
+         
+         if ( jump_state == 1 && previous_state != 1 ) // If I'm returning to the first state, the command
+                                                       // is loaded. Just check the previous state. If the
+                                                       // previous state is the state 1, then, do nothing,
+                                                       // since those are characteres to skip.
+         {
+            if ( skip_command )
+            {
+               skip_command = false;
+               
+               if ( annotation_kind != 0 && file_annotation_mode == SpanAnnotations )
+               {
+                  // A raw command that can't be found in a CIF file: '#', 'C' or 'U', and the first
+                  // byte and the length of the span, 6 bytes each. The string is short enough to be
+                  // kept inside the string object, so no memory is allocated for it.
+                  char span[ 14 ];
+                  
+                  span[ 0 ] = '#';
+                  span[ 1 ] = ( annotation_kind == '(' ) ? 'C' : 'U';
+                  packSpanValue ( span + 2 , annotation_begin );
+                  packSpanValue ( span + 8 , input_offset + 1 - annotation_begin );
+                  storeRawCommand ( std::string ( span , sizeof ( span ) ) );
+               }
+               
+               annotation_kind = 0;
+            }
+            else
+            {
+               std::string tmp;
+               tmp = input_char;
+               command_buffer += tmp;
+               
+               if ( filter_layers && command_buffer[ 0 ] == 'L' )
+               {
+                  // Remember the active layer. The clean version is "L NAME ;"
+                  std::string layer_command = cleanLayerCommand ( command_buffer );
+                  current_layer = layer_command.substr ( 2 , layer_command.find ( ' ' , 2 ) - 2 );
+               }
+               
+               // I call the CleanCommand member function to remove unnecesary characters.
+               storeRawCommand ( command_buffer );
+            }
+            
+            command_buffer = "";
+         }
+         else if ( jump_state != 1 && jump_state != -1 && !skip_command )
+         {
+            // The first char of a command tells if it is an annotation or a primitive. If it
+            // is an annotation not kept, or a primitive drawn on a layer not selected, stop
+            // buffering it until its end.
+            if ( file_annotation_mode != KeepAnnotations &&
+                 command_buffer.empty () &&
+                 ( input_char == '(' || ( input_char >= '0' && input_char <= '9' ) ) )
+            {
+               skip_command = true;
+               annotation_kind = input_char;
+               annotation_begin = input_offset;
+            }
+            else if ( filter_layers &&
+                 command_buffer.empty () &&
+                 ( input_char == 'P' || input_char == 'B' || input_char == 'W' || input_char == 'R' ) &&
+                 file_layer_filter.find ( current_layer ) == file_layer_filter.end () )
+            {
+               skip_command = true;
+            }
+            else
+            {
+               std::string tmp;
+               tmp = input_char;
+               command_buffer += tmp;
+            }
+         }
+         
+         // Check if the current jump state is to an error. 
+         // If so, and the load method indicates "ContinueOnError", record the error, skip
+         // chars until the semicolon that ends the broken command (the ones inside comments
+         // don't count), reset the FSM to state 1 and clean the command buffer.
+         
+         if ( jump_state == -1 && load_method == ContinueOnError )
+         {
+            addError ( input_offset , previous_state , input_char );
+            errors_omited = true;
+            
+            // The rejected char can be the semicolon itself.
+            int comment_level = 0;
+            
+            while ( !input.eof () && next_offset != range_end && !( input_char == ';' && comment_level == 0 ) )
+            {
+               if ( input_char == '(' )
+               {
+                  comment_level++;
+               }
+               else if ( input_char == ')' && comment_level > 0 )
+               {
+                  comment_level--;
+               }
+               
+               input_char = input.get ();
+               input_offset = next_offset++;
+            }
+            
+            file_errors.back ().resume_offset = next_offset;
+            
+            fsm.reset ();
+            jump_state = 1;
+            skip_command = false;
+            annotation_kind = 0;
+            command_buffer = "";
+            
+            storeRawCommand ( "(LibOpenCIF: Incorrect command here) ;" );
+            
+            if ( file_error_limit > 0 && file_errors.size () >= file_error_limit )
+            {
+               break;
+            }
+         }
+      }
+   }
+   
+   file_bytes_read = ( input.eof () ) ? input_offset : next_offset; // At the end, the last "get" read nothing.
+   
+   if ( errors_omited )
+   {
+      std::ostringstream oss;
+      
+      oss << "File:validateSintax:Error: " << file_errors.size () << " incorrect command(s) skipped. The first one at "
+          << describePosition ( file_errors.front ().offset ) << ".";
+      file_messages.push_back ( oss.str () );
+      
+      if ( file_error_limit > 0 && file_errors.size () >= file_error_limit )
+      {
+         file_messages.push_back ( std::string ( "File:validateSintax:Error: Too many errors, the validation was stopped." ) );
+         
+         return ( IncorrectInputFile );
+      }
+   }
+   
+   // File validated. What is the result?
+   std::ostringstream oss;
+   
+   if ( jump_state == -1 )
+   {
+      // There is an invalid input.
+      addError ( input_offset , previous_state , input_char );
+      file_messages.push_back ( std::string ( "File:validateSintax:Error: Error detected when validating contents of input file, at " ) +
+                                describePosition ( input_offset ) +
+                                std::string ( "." ) );
+      
+      oss << previous_state;
+      
+      file_messages.push_back ( std::string ( "                           State: " ) + oss.str () );
+      
+      oss.str ( std::string ( "" ) );
+      oss << (int)(unsigned char)input_char;
+      
+      file_messages.push_back ( std::string ( "                           Input char: \"" ) +
+                                std::string ( 1 , input_char ) +
+                                std::string ( "\" (ASCII=" ) +
+                                oss.str () +
+                                std::string ( ")" )
+                              );
+      
+      file_messages.push_back ( std::string ( "                           Current command buffer: \"" ) + command_buffer + std::string ( "\"" ) );
+      file_messages.push_back ( std::string ( "                           The loaded raw commands can be accessed to analize the error and locate the error." ) );
+      
+      return ( IncorrectInputFile );
+   }
+   
+   if ( !file_load_ranges.empty () && jump_state == 1 )
+   {
+      // The END command isn't part of the ranges.
+      storeRawCommand ( std::string ( "E" ) );
+      
+      return ( ( errors_omited) ? IncorrectInputFile : AllOk );
+   }
+   
+   if ( jump_state != 91 && jump_state != 92 )
+   {
+      file_messages.push_back ( std::string ( "File:validateSintax:Error: The file contents are incomplete (maybe a missing END command). The file ends at " ) +
+                                describePosition ( input_offset > 0 ? input_offset - 1 : 0 ) +
+                                std::string ( "." ) );
+      
+      return ( IncompleteInputFile );
+   }
+   
+   // Everything Ok. Add last command (the END command)
+   storeRawCommand ( cleanCommand ( command_buffer ) );
+   
+   return ( ( errors_omited) ? IncorrectInputFile : AllOk );
+}
+
+/*
+ * This member function stores a raw command found by the validation. When loading
+ * with a pipeline, the raw commands are sent to the next stage in batches.
+ */
+void OpenCIF::File::storeRawCommand ( const std::string& command )
+{
+   file_raw_commands.push_back ( command );
+   
+# if __cplusplus >= 201103L
+   if ( file_raw_batches != 0 && file_raw_commands.size () >= 4096 )
+   {
+      flushRawCommands ();
+   }
+# endif
+   
+   return;
+}
+
+# if __cplusplus >= 201103L
+/*
+ * This member function sends the raw commands stored to the next stage of the
+ * pipeline. If the queue is full, it sleeps (this is the back-pressure that limits
+ * the memory used).
+ */
+void OpenCIF::File::flushRawCommands ( void )
+{
+   std::vector< std::string >* batch = new std::vector< std::string > ();
+   
+   batch->swap ( file_raw_commands );
+   file_raw_flushed += batch->size ();
+   file_raw_batches->push ( batch );
+   
+   return;
+}
+# endif
+
+/*
+ * This member function validates the contents of the input file, without storing
+ * any command. The file is read in big blocks, and every block is fed to the FSM
+ * at once. If there is an error, its position in the file is reported.
+ */
+OpenCIF::File::LoadStatus OpenCIF::File::scanSyntax ( void )
+{
+   // Building the FSM is expensive, so every thread builds a prototype once (if possible).
+   // Every scan works on its own copy: a progress callback can load another file.
+# if __cplusplus >= 201103L
+   static thread_local const OpenCIF::CIFFSM prototype;
+   OpenCIF::CIFFSM fsm ( prototype );
+# else
+   OpenCIF::CIFFSM fsm;
+# endif
+   std::vector< char > block ( 1 << 22 );
+   unsigned long int offset = 0;
+   
+   file_raw_commands.clear ();
+   file_errors.clear ();
+   
+   while ( file_input )
+   {
+      if ( !keepLoading ( offset , 0 ) )
+      {
+         file_messages.push_back ( std::string ( "File:validateSintax:Warning: The load was cancelled." ) );
+         
+         return ( LoadCancelled );
+      }
+      
+      file_input.read ( &block[ 0 ] , block.size () );
+      
+      unsigned long int length = file_input.gcount ();
+      unsigned long int accepted = fsm.feed ( &block[ 0 ] , length );
+      
+      if ( accepted != length )
+      {
+         std::ostringstream oss;
+         
+         offset += accepted;
+         addError ( offset , fsm.currentState () , block[ accepted ] );
+         
+         oss << "File:validateSintax:Error: Error detected when validating contents of input file, at "
+             << describePosition ( offset ) << "." ;
+         file_messages.push_back ( oss.str () );
+         
+         oss.str ( std::string ( "" ) );
+         oss << "                           State: " << fsm.currentState ();
+         file_messages.push_back ( oss.str () );
+         
+         oss.str ( std::string ( "" ) );
+         oss << "                           Input char: \"" << block[ accepted ] << "\" (ASCII=" << (int)(unsigned char)block[ accepted ] << ")";
+         file_messages.push_back ( oss.str () );
+         
+         return ( IncorrectInputFile );
+      }
+      
+      offset += length;
+   }
+   
+   if ( fsm.currentState () != 91 && fsm.currentState () != 92 )
+   {
+      file_messages.push_back ( std::string ( "File:validateSintax:Error: The file contents are incomplete (maybe a missing END command). The file ends at " ) +
+                                describePosition ( offset > 0 ? offset - 1 : 0 ) +
+                                std::string ( "." ) );
+      
+      return ( IncompleteInputFile );
+   }
+   
+   return ( AllOk );
+}
+
+/*
+ * This member function stores an error found while validating the file. The position
+ * where the validation continued (if it did) is updated by the caller.
+ */
+void OpenCIF::File::addError ( const unsigned long int& offset , const int& state , const char& input_char )
+{
+   Error error;
+   
+   error.offset = offset;
+   error.resume_offset = offset;
+   error.state = state;
+   error.input_char = input_char;
+   
+   locate ( offset , error.line , error.column );
+   
+   file_errors.push_back ( error );
+   
+   return;
+}
+
+/*
+ * Member function to get the errors found during the last validation. With the
+ * "StopOnError" method there is only one, with "ContinueOnError" there is one per
+ * incorrect command skipped (up to the error limit).
+ */
+const std::vector< OpenCIF::File::Error >& OpenCIF::File::getErrors ( void ) const
+{
+   return ( file_errors );
+}
+
+/*
+ * Member function to set the maximum amount of errors that the "ContinueOnError"
+ * method collects before stopping. Zero means no limit.
+ */
+void OpenCIF::File::setErrorLimit ( const unsigned long int& new_limit )
+{
+   file_error_limit = new_limit;
+   
+   return;
+}
+
+/*
+ * Member function to get the maximum amount of errors collected.
+ */
+unsigned long int OpenCIF::File::getErrorLimit ( void ) const
+{
+   return ( file_error_limit );
+}
+
+/*
+ * This member function builds the index of the lines of the input file: the offset
+ * where every line starts. It's only built when a diagnostic needs it, so loading a
+ * correct file never pays for it. The new lines are searched with memchr, that is
+ * vectorised in most of the C libraries.
+ */
+void OpenCIF::File::buildLineIndex ( void )
+{
+   std::ifstream input ( file_path.c_str () , std::ios::in | std::ios::binary );
+   std::vector< char > block ( 1 << 22 );
+   unsigned long int position = 0;
+   
+   file_line_starts.clear ();
+   file_line_starts.push_back ( 0 );
+   
+   while ( input )
+   {
+      input.read ( &block[ 0 ] , block.size () );
+      
+      const char* begin = &block[ 0 ];
+      const char* end = begin + input.gcount ();
+      const char* new_line;
+      
+      while ( begin < end && ( new_line = static_cast< const char* > ( std::memchr ( begin , '\n' , end - begin ) ) ) != NULL )
+      {
+         file_line_starts.push_back ( position + ( new_line - &block[ 0 ] ) + 1 );
+         begin = new_line + 1;
+      }
+      
+      position += input.gcount ();
+   }
+   
+   file_line_index_built = true;
+   
+   return;
+}
+
+/*
+ * This member function finds the line and column (both starting at 1) of a byte offset
+ * of the input file, using the index of the lines (built the first time it's needed).
+ */
+void OpenCIF::File::locate ( const unsigned long int& offset , unsigned long int& line , unsigned long int& column )
+{
+   if ( !file_line_index_built )
+   {
+      buildLineIndex ();
+   }
+   
+   // The first line starting after the offset. The previous one contains the offset.
+   std::vector< unsigned long int >::const_iterator next_line = std::upper_bound ( file_line_starts.begin () ,
+                                                                                   file_line_starts.end () ,
+                                                                                   offset );
+   
+   line = next_line - file_line_starts.begin ();
+   column = offset - *( next_line - 1 ) + 1;
+   
+   return;
+}
+
+/*
+ * This member function returns a text with the position of a byte offset of the
+ * input file, to be added to the messages: "byte N (line L, column C)".
+ */
+std::string OpenCIF::File::describePosition ( const unsigned long int& offset )
+{
+   std::ostringstream oss;
+   unsigned long int line , column;
+   
+   locate ( offset , line , column );
+   
+   oss << "byte " << offset << " (line " << line << ", column " << column << ")";
+   
+   return ( oss.str () );
+}
+
+void OpenCIF::File::cleanCommands ( void )
+{
+   for ( unsigned long int i = 0; i < file_raw_commands.size (); i++ )
+   {
+      if ( ( i & 0xFFF ) == 0 && isCancelled () )
+      {
+         break;
+      }
+      
+      file_raw_commands[ i ] = cleanCommand ( file_raw_commands[ i ] );
+   }
+   
+   return;
+}
+
+/*
+ * This member function loads the contents of the input file and converts them
+ * into Command instances.
+ */
+void OpenCIF::File::convertCommands ( void )
+{
+   /*
+    * The raw commands are ready and validated. So, there is only left the process of
+    * turning those strings into commands.
+    */
+   
+   // First, delete and clear the current commands vector
+   for ( unsigned int i = 0; i < file_commands.size (); i++ )
+   {
+      delete file_commands[ i ];
+      file_commands[ i ] = 0;
+   }
+   
+   file_commands.clear ();
+   
+   // Iterate over the raw commands. Check the first char of all. The first char will tell me exactly
+   // wich command type is every one.
+   
+   for ( unsigned long int i = 0; i < file_raw_commands.size (); i++ )
+   {
+      OpenCIF::Command* command;
+      
+      // The commands converted so far are freed by the caller, if the load was cancelled.
+      if ( ( i & 0xFFF ) == 0 && !keepLoading ( file_bytes_read , file_commands.size () ) )
+      {
+         break;
+      }
+      
+      command = convertCommand ( file_raw_commands[ i ] );
+      
+      if ( command != 0 )
+      {
+         file_commands.push_back ( command );
+      }
+   }
+   
+   decodeExtensions ();
+   
+   return;
+}
+
+/*
+ * This member function converts a clean raw command into a Command instance. The first
+ * char of the command tells exactly which command type it is. If the command can't be
+ * converted, there is returned a null pointer.
+ */
+OpenCIF::Command* OpenCIF::File::convertCommand ( const std::string& str_command )
+{
+   OpenCIF::Command* command = 0;
+   
+   switch ( str_command[ 0 ] )
+   {
+      case 'B':
+         command = new OpenCIF::BoxCommand ( str_command );
+         break;
+         
+      case 'P':
+         command = new OpenCIF::PolygonCommand ( str_command );
+         break;
+         
+      case 'W':
+         command = new OpenCIF::WireCommand ( str_command );
+         break;
+         
+      case 'R':
+         command = new OpenCIF::RoundFlashCommand ( str_command );
+         break;
+         
+      case '(':
+         command = new OpenCIF::CommentCommand ( str_command );
+         break;
+         
+      case 'C':
+         command = new OpenCIF::CallCommand ( str_command );
+         break;
+         
+      case 'D':
+         switch ( str_command[ 2 ] )
+         {
+            case 'D':
+               command = new OpenCIF::DefinitionDeleteCommand ( str_command );
+               break;
+               
+            case 'F':
+               command = new OpenCIF::DefinitionEndCommand ( str_command );
+               break;
+               
+            case 'S':
+               command = new OpenCIF::DefinitionStartCommand ( str_command );
+               break;
+         }
+         break;
+         
+      case 'L':
+         command = new OpenCIF::LayerCommand ( str_command );
+         break;
+         
+      case 'E':
+         command = new OpenCIF::EndCommand ();
+         break;
+         
+      case '#':
+         {
+            // An annotation loaded with SpanAnnotations (see validateSintax).
+            unsigned long int begin = unpackSpanValue ( str_command.data () + 2 );
+            unsigned long int end = begin + unpackSpanValue ( str_command.data () + 8 );
+            OpenCIF::RawContentCommand* annotation;
+            
+            if ( str_command[ 1 ] == 'C' )
+            {
+               annotation = new OpenCIF::CommentCommand ();
+            }
+            else
+            {
+               annotation = new OpenCIF::UserExtensionCommand ();
+            }
+            
+            annotation->setSpan ( begin , end );
+            command = annotation;
+         }
+         break;
+         
+      default:
+         command = new OpenCIF::UserExtensionCommand ( str_command );
+         break;
+   }
+   
+   return ( command );
+}
+
+/*
+ * This member function returns the vector of the raw (string) commands of the file.
+ */
+const std::vector< std::string >& OpenCIF::File::getRawCommands ( void ) const
+{
+   return ( file_raw_commands );
+}
+
+/*
+ * Member function to set the layers to load. When the filter is not empty, the primitives
+ * (polygons, boxes, wires and round flashes) drawn on any other layer are still validated,
+ * but they are never stored as raw commands, so they are never cleaned nor converted.
+ */
+void OpenCIF::File::setLayerFilter ( const std::set< std::string >& new_layers )
+{
+   file_layer_filter = new_layers;
+   
+   return;
+}
+
+/*
+ * Member function to return the layers to load. An empty set means that every layer is loaded.
+ */
+const std::set< std::string >& OpenCIF::File::getLayerFilter ( void ) const
+{
+   return ( file_layer_filter );
+}
+
+/*
+ * Member function to remove the layer filter, so every layer is loaded again.
+ */
+void OpenCIF::File::clearLayerFilter ( void )
+{
+   file_layer_filter.clear ();
+   
+   return;
+}
+
+/*
+ * Member function to choose what to do with the comments and the user extensions. Files
+ * generated by tools carry big comments and an extension for every cell; discarding them,
+ * or keeping only their spans, avoids allocating their contents. They are validated anyway.
+ * Note that the symbol names of the Library come from the "9" extensions.
+ */
+void OpenCIF::File::setAnnotationMode ( const AnnotationMode& new_mode )
+{
+   file_annotation_mode = new_mode;
+   
+   return;
+}
+
+/*
+ * Member function to set the registry used to decode the user extensions when a file is loaded.
+ * The registry isn't copied, so it must live while it is in use. With a null registry (the
+ * default) nothing is decoded.
+ */
+void OpenCIF::File::setExtensionRegistry ( const OpenCIF::ExtensionRegistry* new_registry )
+{
+   file_extension_registry = new_registry;
+   
+   return;
+}
+
+/*
+ * Member function to get the registry used to decode the user extensions.
+ */
+const OpenCIF::ExtensionRegistry* OpenCIF::File::getExtensionRegistry ( void ) const
+{
+   return ( file_extension_registry );
+}
+
+/*
+ * Member function to get the user extensions decoded by the last load, in file order.
+ */
+const std::vector< OpenCIF::ExtensionRecord >& OpenCIF::File::getExtensions ( void ) const
+{
+   return ( file_extensions );
+}
+
+/*
+ * Member function to get the names given to the symbols by "9" extensions, with their IDs.
+ */
+const OpenCIF::SymbolNameIndex& OpenCIF::File::getSymbolNames ( void ) const
+{
+   return ( file_symbol_names );
+}
+
+/*
+ * Member function to find the ID of a symbol by its name. It needs a registry that decodes
+ * "9" extensions into symbol names (like the default one).
+ */
+bool OpenCIF::File::findSymbol ( const std::string& name , unsigned long int& id ) const
+{
+   OpenCIF::SymbolNameIndex::const_iterator found = file_symbol_names.find ( name );
+   
+   if ( found == file_symbol_names.end () )
+   {
+      return ( false );
+   }
+   
+   id = found->second;
+   
+   return ( true );
+}
+
+/*
+ * Private member function to decode the user extensions (and the comments that hold one)
+ * of the converted commands with the registry, and to index the symbol names. The first
+ * name given to a symbol, and the first symbol given a name, win. The annotations loaded
+ * with SpanAnnotations are decoded from their bytes, read again from the file.
+ */
+void OpenCIF::File::decodeExtensions ( void )
+{
+   file_extensions.clear ();
+   file_symbol_names.clear ();
+   
+   if ( file_extension_registry == 0 )
+   {
+      return;
+   }
+   
+   OpenCIF::ExtensionRecord record;
+   std::ifstream span_input;
+   unsigned long int current_symbol = 0;
+   bool named = false;
+   
+   for ( unsigned long int i = 0; i < file_commands.size (); i++ )
+   {
+      switch ( file_commands[ i ]->type () )
+      {
+         case OpenCIF::Command::DefinitionStart:
+            current_symbol = static_cast< OpenCIF::DefinitionStartCommand* > ( file_commands[ i ] )->getID ();
+            named = false;
+            break;
+            
+         case OpenCIF::Command::DefinitionEnd:
+            current_symbol = 0;
+            break;
+            
+         case OpenCIF::Command::UserExtension:
+         case OpenCIF::Command::Comment:
+            record = OpenCIF::ExtensionRecord ();
+            
+            if ( decodeAnnotation ( file_commands[ i ] , span_input , record ) )
+            {
+               record.symbol = current_symbol;
+               record.command = i;
+               
+               if ( record.type == OpenCIF::ExtensionRecord::SymbolName && current_symbol != 0 && !named )
+               {
+                  file_symbol_names.insert ( std::make_pair ( record.name , current_symbol ) );
+                  named = true;
+               }
+               
+               file_extensions.push_back ( record );
+            }
+            break;
+            
+         default:
+            break;
+      }
+   }
+   
+   return;
+}
+
+/*
+ * Private member function to decode a user extension or a comment with the registry. If it
+ * was loaded with SpanAnnotations, its bytes are read with "span_input" (opened the first
+ * time) and decoded as a command of the same type.
+ */
+bool OpenCIF::File::decodeAnnotation ( OpenCIF::Command* command , std::ifstream& span_input , OpenCIF::ExtensionRecord& record ) const
+{
+   OpenCIF::RawContentCommand* annotation = static_cast< OpenCIF::RawContentCommand* > ( command );
+   
+   if ( !annotation->hasSpan () )
+   {
+      return ( file_extension_registry->decode ( command , record ) );
+   }
+   
+   if ( !span_input.is_open () )
+   {
+      span_input.open ( file_path.c_str () , std::ios::in | std::ios::binary );
+   }
+   
+   std::string bytes ( annotation->getSpanEnd () - annotation->getSpanBegin () , '\0' );
+   
+   span_input.clear ();
+   span_input.seekg ( annotation->getSpanBegin () );
+   span_input.read ( &bytes[ 0 ] , bytes.size () );
+   bytes.resize ( span_input.gcount () );
+   
+   if ( command->type () == OpenCIF::Command::Comment )
+   {
+      OpenCIF::CommentCommand comment ( bytes );
+      
+      return ( file_extension_registry->decode ( &comment , record ) );
+   }
+   
+   OpenCIF::UserExtensionCommand extension ( bytes );
+   
+   return ( file_extension_registry->decode ( &extension , record ) );
+}
+
+/*
+ * Member function to get the current annotation mode.
+ */
+OpenCIF::File::AnnotationMode OpenCIF::File::getAnnotationMode ( void ) const
+{
+   return ( file_annotation_mode );
+}
+
+/*
+ * Member function to read the bytes of a command loaded with SpanAnnotations (from its first
+ * char to its semicolon) from the file. It returns an empty string if the command has no span
+ * or the file can't be read.
+ */
+std::string OpenCIF::File::readSpan ( const OpenCIF::RawContentCommand& command )
+{
+   if ( !command.hasSpan () )
+   {
+      return ( std::string () );
+   }
+   
+   std::ifstream input ( file_path.c_str () , std::ios::in | std::ios::binary );
+   std::string bytes ( command.getSpanEnd () - command.getSpanBegin () , '\0' );
+   
+   input.seekg ( command.getSpanBegin () );
+   input.read ( &bytes[ 0 ] , bytes.size () );
+   bytes.resize ( input.gcount () );
+   
+   return ( bytes );
+}
+
+/*
+ * This member function takes as argument a command in string form. The command is "not clear". That means
+ * that is in the same way it was readed from the file.
+ * 
+ * The process of cleaning is to delete anything that is not intented to exist and leave only that things that can make
+ * the command easy to parse.
+ * 
+ * For example, from this: "P-100,10000thisisvalid-10000cuac,cuac,cuac,imaduck-20000yolo;"
+ * To this:                "P -100 10000 -10000 -20000 ;"
+ * 
+ * So, such kind of string can be used as an input stream to read easily.
+ * 
+ * There are some commands that I can't clean, like the comment or user expansion commands. Those commands are just returned.
+ * 
+ * At least, I can know what kind of command I'm working with by it's first char.
+ */
+std::string OpenCIF::File::cleanCommand ( std::string command )
+{
+   std::string final_command;
+   
+   switch ( command[ 0 ] )
+   {
+      // All of these commands can be processed as the same, since they only need values.
+      case 'P':
+      case 'B':
+      case 'W':
+      case 'R':
+         final_command = clearNumericCommand ( command );
+         break;
+         
+      case 'L': // Layer command
+         final_command = cleanLayerCommand ( command );
+         break;
+         
+      case 'C': // Call command
+         final_command = cleanCallCommand ( command );
+         break;
+         
+      case 'D': // Definition {Start|End|Delete} command.
+         final_command = cleanDefinitionCommand ( command );
+         break;
+         
+      case 'E': // End command.
+         final_command = "E ;";
+         break;
+         
+      case '#': // Span of an annotation, already packed.
+         final_command = command;
+         break;
+         
+      default:
+         final_command = command.substr ( 0 , command.size () - 1 ) + " ;";
+         break;
+   }
+   
+   return ( final_command );
+}
+
+/*
+ * This member function takes as argument a string that, maybe, is a CIF command.
+ * 
+ * The operation done is similar to the one performed when loading a CIF file, but
+ * applied directly to a string. The idea is to validate a single string as a service
+ * for the user.
+ */
+bool OpenCIF::File::isCommandValid ( std::string command )
+{
+   /*
+    * The validation is done by a Validator instance. Building the FSM of a validator
+    * is expensive, so the same instance is reused by every call (one per thread).
+    * Without C++11 support, there is no thread local storage, so a new validator is needed.
+    */
+   
+# if __cplusplus >= 201103L
+   static thread_local OpenCIF::Validator validator;
+# else
+   OpenCIF::Validator validator;
+# endif
+   
+   return ( validator.isCommandValid ( command ) );
+}
+
+/*
+ * This member function takes as argument a Definition command and returns it cleaned.
+ * 
+ * A definition command can be something like this:
+ * 
+ *      "DxxxxxSlol100im,totally,legal;"
+ * 
+ * So, the task of this member function is to turn it into like this:
+ * 
+ *      "D S 100 ;"
+ * 
+ * The process begins with the deletion of any non-digit and non-uppercase characters.
+ * Such operation, if good, can leave a command like this:
+ * 
+ *      "DS100;"
+ * 
+ * To simplify the process of converting commands into instances, the commands must have
+ * whitespaces to separate components (to use the strings as, for example, input streams).
+ * 
+ * So, the next process is to separate the components to turn the command into this:
+ * 
+ *      "D S 100 ;"
+ */
+std::string OpenCIF::File::cleanDefinitionCommand ( std::string command )
+{
+   std::string final_command;
+   std::string tmp = " ";
+            
+   // There are only uppercase chars and digits
+   final_command = command[ 0 ];
+   final_command += tmp;
+   
+   // Remove not-necessary characters
+   command[ 0 ] = ' ';
+   for ( unsigned int i = 0; i < command.size (); i++ )
+   {
+      // If the current char is not a 'D', not a digit, not an 'S' and not an 'F'
+      if ( !std::isdigit ( command[ i ] ) && !std::isupper ( command[ i ] ) )
+      {
+         command[ i ] = ' ';
+      }
+   }
+   
+   for ( unsigned int i = 1; i < command.size (); i++ )
+   {
+      if ( std::isdigit ( command[ i ] ) )
+      {
+         final_command += command[ i ];
+      }
+      else if ( command[ i ] != ' ' )
+      {
+         final_command += command[ i ];
+         final_command += " ";
+      }
+      else if ( command[ i ] == ' ' && final_command[ final_command.size () - 1 ] != ' ' )
+      {
+         final_command += " ";
+      }
+   }
+   
+   ( final_command[ final_command.size () - 1 ] == ' ' )
+      ? final_command += ";"
+      : final_command += " ;";
+   
+   return ( final_command );
+}
+
+/*
+ * This member function takes as argument a call command and returns it cleaned.
+ * 
+ * A call command can be something like this:
+ * 
+ *      "C1T20000 -20000R1000000 -59999MXlololololololololMY MXMXMXMYMXR100 100R100 100;"
+ * 
+ * So, the task of this member function is to turn it into like this:
+ * 
+ *      "C 1 T 20000 -20000 R 1000000 -59999 M X M Y M X M X M X M Y M X R 100 100 R 100 100;"
+ * 
+ * The process begins with the deletion of any non-digit, non-dash ('-') and non-uppercase characters.
+ * Such operation, if good, can leave a command like this:
+ * 
+ *      "C 1 T 20000 -20000 R 1000000 -59999 MX MY MXMXMXMYMXR100 100R100 100;"
+ * 
+ * To simplify the process of converting commands into instances, the commands must have
+ * whitespaces to separate components (to use the strings as, for example, input streams).
+ * 
+ * So, the next process is to separate the components to turn the command into this:
+ * 
+ *      "C 1 T 20000 -20000 R 1000000 -59999 M X M Y M X M X M X M Y M X R 100 100 R 100 100;"
+ */
+std::string OpenCIF::File::cleanCallCommand ( std::string command )
+{
+   std::string final_command;
+   std::string tmp = " ";
+            
+   // There are only uppercase chars
+   final_command = command[ 0 ];
+   final_command += tmp;
+   
+   // Remove not-necessary characters
+   command[ 0 ] = ' ';
+   for ( unsigned int i = 0; i < command.size (); i++ )
+   {
+      if ( !std::isdigit ( command[ i ] ) && !std::isupper( command[ i ] ) && command[ i ] != '-' )
+      {
+         command[ i ] = ' ';
+      }
+   }
+   
+   for ( unsigned int i = 1; i < command.size (); i++ )
+   {
+      tmp = command[ i ];
+      
+      if ( std::isdigit ( command[ i ] ) )
+      {
+         final_command += tmp;
+      }
+      else if ( command[ i ] != ' ' )
+      {
+         if ( final_command[ final_command.size () - 1 ] != ' ' )
+         {
+            final_command += " ";
+         }
+         
+         final_command += tmp;
+         
+         if ( std::isupper ( command[ i ] ) )
+         {
+            final_command += " ";
+         }
+      }
+      else if ( final_command[ final_command.size () - 1 ] != ' ' )
+      {
+         final_command += " ";
+      }
+   }
+   
+   ( final_command[ final_command.size () - 1 ] == ' ' )
+      ? final_command += ";"
+      : final_command += " ;";
+   
+   return ( final_command );
+}
+
+/*
+ * This member function takes as argument a Layer camand and removes any unnecesary character.
+ */
+std::string OpenCIF::File::cleanLayerCommand ( std::string command )
+{
+   std::string tmp = " ";
+   std::string final_command;
+            
+   final_command = command[ 0 ];
+   final_command += tmp;
+   
+   // Remove not-necessary characters
+   command[ 0 ] = ' ';
+   for ( unsigned int i = 0; i < command.size (); i++ )
+   {
+      if ( !std::isupper ( command[ i ] ) && command[ i ] != '_' && ! std::isdigit ( command[ i ] ) )
+      {
+         command[ i ] = ' ';
+      }
+   }
+   
+   std::istringstream iss ( command );
+   
+   while ( !iss.eof () )
+   {
+      iss >> tmp;
+      
+      if ( !iss.eof () )
+      {
+         final_command += tmp;
+         tmp = " ";
+         final_command += tmp;
+      }
+   }
+   
+   final_command += ";";
+            
+   return ( final_command );
+}
+
+/*
+ * This member function takes as argument a numeric command (like a Polygon or Box command)
+ * and cleans it.
+ * 
+ * A numeric command can be something like this:
+ * 
+ *      "W1000,muajajajajaja20000,,,this,is,valid20000twerking,so,hard,,,,,,xoxoxoxoxox-10000,-10000,-500 juar juar juarX-4000;"
+ * 
+ * So, the task of this member function is to turn it into like this:
+ * 
+ *      "W 1000 20000 20000 -10000 -10000 -500 -4000 ;"
+ * 
+ * The process begins with the deletion of any non-digit and non-dash ('-') characters.
+ * Such operation, if good, can leave a command like this:
+ * 
+ *      "W1000              20000                20000                                 -10000 -10000 -500                -4000;"
+ * 
+ * To simplify the process of converting commands into instances, the commands must have
+ * whitespaces to separate components (to use the strings as, for example, input streams).
+ * 
+ * So, the next process is to separate the components to turn the command into this:
+ * 
+ *      "W 1000 20000 20000 -10000 -10000 -500 -4000 ;"
+ */
+std::string OpenCIF::File::clearNumericCommand ( std::string command )
+{
+   std::string tmp = " ";
+   std::string final_command;
+            
+   // There are only numbers and guides ("-")
+   final_command = command[ 0 ];
+   final_command += tmp;
+   
+   // Remove not-necessary characters
+   for ( unsigned int i = 0; i < command.size (); i++ )
+   {
+      if ( !std::isdigit ( command[ i ] ) && command[ i ] != '-' )
+      {
+         command[ i ] = ' ';
+      }
+   }
+   
+   std::istringstream iss ( command );
+   
+   while ( !iss.eof () )
+   {
+      iss >> tmp;
+      
+      if ( !iss.eof () )
+      {
+         final_command += tmp;
+         tmp = " ";
+         final_command += tmp;
+      }
+   }
+   
+   final_command += ";";
+   
+   return ( final_command );
+}
+
+// FILE: writer.cc
+
+
+/*
+ * Constructor. The writer sends its contents to the output stream specified.
+ * By default, the buffer is flushed every 1 MiB.
+ */
+OpenCIF::Writer::Writer ( std::ostream& output_stream , const WriteMode& write_mode )
+   : writer_output ( output_stream ) ,
+     writer_mode ( write_mode ) ,
+     writer_buffer_size ( 1 << 20 )
+{
+   writer_buffer.reserve ( writer_buffer_size );
+}
+
+/*
+ * Destructor. Send to the output stream anything left in the buffer.
+ */
+OpenCIF::Writer::~Writer ( void )
+{
+   flush ();
+}
+
+/*
+ * Member function to set the format used to write the commands.
+ */
+void OpenCIF::Writer::setMode ( const WriteMode& new_mode )
+{
+   writer_mode = new_mode;
+   
+   return;
+}
+
+/*
+ * Member function to return the format used to write the commands.
+ */
+OpenCIF::Writer::WriteMode OpenCIF::Writer::getMode ( void ) const
+{
+   return ( writer_mode );
+}
+
+/*
+ * Member function to set the amount of bytes to accumulate before writing to the output stream.
+ */
+void OpenCIF::Writer::setBufferSize ( const unsigned long int& new_size )
+{
+   writer_buffer_size = new_size;
+   writer_buffer.reserve ( writer_buffer_size );
+   
+   return;
+}
+
+/*
+ * Member function to return the amount of bytes accumulated before writing to the output stream.
+ */
+unsigned long int OpenCIF::Writer::getBufferSize ( void ) const
+{
+   return ( writer_buffer_size );
+}
+
+/*
+ * Member function to set the file that the spans of the annotations loaded with
+ * SpanAnnotations refer to (the path given to the File). Their text is copied from it.
+ */
+void OpenCIF::Writer::setSpanSource ( const std::string& new_path )
+{
+   writer_span_path = new_path;
+   
+   if ( writer_span_input.is_open () )
+   {
+      writer_span_input.close ();
+   }
+   
+   return;
+}
+
+/*
+ * Member function to return the file the spans are copied from.
+ */
+std::string OpenCIF::Writer::getSpanSource ( void ) const
+{
+   return ( writer_span_path );
+}
+
+/*
+ * Member function to write a single command. It returns false (writing nothing) if the
+ * command is an annotation loaded with SpanAnnotations and there is no span source.
+ */
+bool OpenCIF::Writer::write ( OpenCIF::Command* command )
+{
+   if ( writer_span_path.empty () && hasSpan ( command ) )
+   {
+      return ( refuseSpans () );
+   }
+   
+   writeOne ( command );
+   
+   return ( true );
+}
+
+/*
+ * Member function to write a list of commands, in order. Like above, nothing is written if
+ * there are spans and no span source.
+ */
+bool OpenCIF::Writer::write ( const std::vector< OpenCIF::Command* >& commands )
+{
+   if ( !checkSpans ( commands ) )
+   {
+      return ( false );
+   }
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      writeOne ( commands[ i ] );
+   }
+   
+   return ( true );
+}
+
+/*
+ * Private member function to write a single command, already checked.
+ */
+void OpenCIF::Writer::writeOne ( OpenCIF::Command* command )
+{
+   if ( !writer_span_path.empty () && !writer_span_input.is_open () )
+   {
+      writer_span_input.open ( writer_span_path.c_str () , std::ios::in | std::ios::binary );
+   }
+   
+   format ( writer_buffer , command , writer_mode , &writer_span_input );
+   
+   if ( writer_buffer.size () >= writer_buffer_size )
+   {
+      flush ();
+   }
+   
+   return;
+}
+
+/*
+ * Member function to write a list of commands, formatting them with several threads.
+ * 
+ * The list is split into blocks: every definition (from "DS" to "DF") is a block, and
+ * every run of commands between definitions is another one. A pool of threads, created
+ * once, formats the blocks concurrently into a bounded ring of buffers (4 per thread),
+ * and this thread writes them in their original order as they are ready, so the output
+ * is exactly the same generated by "write".
+ * 
+ * Without C++11 support (no threads), or with a single thread, this is the same as "write",
+ * and it returns false in the same cases.
+ */
+bool OpenCIF::Writer::writeParallel ( const std::vector< OpenCIF::Command* >& commands , const unsigned int& thread_amount )
+{
+# if __cplusplus >= 201103L
+   if ( thread_amount <= 1 )
+   {
+      return ( write ( commands ) );
+   }
+   
+   if ( !checkSpans ( commands ) )
+   {
+      return ( false );
+   }
+   
+   // Find the blocks. Every block is stored as the index of its first command and the index after the last one.
+   std::vector< std::pair< unsigned long int , unsigned long int > > blocks;
+   unsigned long int block_start = 0;
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      OpenCIF::Command::CommandType type = commands[ i ]->type ();
+      
+      if ( type == OpenCIF::Command::DefinitionStart && i != block_start )
+      {
+         blocks.push_back ( std::make_pair ( block_start , i ) );
+         block_start = i;
+      }
+      else if ( type == OpenCIF::Command::DefinitionEnd )
+      {
+         blocks.push_back ( std::make_pair ( block_start , i + 1 ) );
+         block_start = i + 1;
+      }
+   }
+   
+   if ( block_start != commands.size () )
+   {
+      blocks.push_back ( std::make_pair ( block_start , (unsigned long int)commands.size () ) );
+   }
+   
+   // Anything already buffered goes first.
+   flush ();
+   
+   // The blocks are formatted by a fixed pool of threads into a ring of buffers, and this
+   // thread writes them in order. A worker only takes a block when its buffer in the ring
+   // was written, so a large block only holds back the ones a full ring after it.
+   unsigned long int ring_size = thread_amount * 4;
+   std::vector< std::string > block_buffers ( ring_size );
+   std::vector< char > block_ready ( ring_size , 0 );
+   unsigned long int next_block = 0;    // Next block to format.
+   unsigned long int written_block = 0; // Next block to write.
+   bool stopped = false;
+   std::mutex pool_mutex;
+   std::condition_variable pool_condition;
+   std::vector< std::thread > workers;
+   WriteMode write_mode = writer_mode;
+   
+   auto worker = [ & ] ( void )
+   {
+      std::ifstream span_input; // Every worker reads the spans with its own stream.
+      
+      if ( !writer_span_path.empty () )
+      {
+         span_input.open ( writer_span_path.c_str () , std::ios::in | std::ios::binary );
+      }
+      
+      std::unique_lock< std::mutex > lock ( pool_mutex );
+      
+      while ( true )
+      {
+         while ( !stopped && next_block < blocks.size () && next_block >= written_block + ring_size )
+         {
+            pool_condition.wait ( lock );
+         }
+         
+         if ( stopped || next_block >= blocks.size () )
+         {
+            return;
+         }
+         
+         unsigned long int block = next_block++;
+         std::string& buffer = block_buffers[ block % ring_size ];
+         
+         lock.unlock ();
+         buffer.clear ();
+         
+         for ( unsigned long int i = blocks[ block ].first; i < blocks[ block ].second; i++ )
+         {
+            format ( buffer , commands[ i ] , write_mode , &span_input );
+         }
+         
+         lock.lock ();
+         block_ready[ block % ring_size ] = 1;
+         pool_condition.notify_all ();
+      }
+   };
+   
+   try
+   {
+      for ( unsigned int t = 0; t < thread_amount; t++ )
+      {
+         workers.push_back ( std::thread ( worker ) );
+      }
+      
+      for ( ; written_block < blocks.size (); )
+      {
+         std::unique_lock< std::mutex > lock ( pool_mutex );
+         unsigned long int slot = written_block % ring_size;
+         
+         while ( !block_ready[ slot ] )
+         {
+            pool_condition.wait ( lock );
+         }
+         
+         lock.unlock ();
+         writer_output.write ( block_buffers[ slot ].data () , block_buffers[ slot ].size () );
+         lock.lock ();
+         
+         block_ready[ slot ] = 0;
+         written_block++;
+         pool_condition.notify_all ();
+      }
+   }
+   catch ( ... )
+   {
+      // A thread that can't be created (or an output stream with exceptions): stop the workers started.
+      {
+         std::lock_guard< std::mutex > lock ( pool_mutex );
+         stopped = true;
+      }
+      
+      pool_condition.notify_all ();
+      
+      for ( unsigned int t = 0; t < workers.size (); t++ )
+      {
+         workers[ t ].join ();
+      }
+      
+      throw;
+   }
+   
+   for ( unsigned int t = 0; t < workers.size (); t++ )
+   {
+      workers[ t ].join ();
+   }
+   
+   writer_output.flush ();
+# else
+   // There are no threads. Dummy use to prevent a warning about thread_amount not being used.
+   ( void ) thread_amount;
+   
+   return ( write ( commands ) );
+# endif
+   
+   return ( true );
+}
+
+/*
+ * Member function to return the messages of the writes (the ones refused).
+ */
+const std::vector< std::string >& OpenCIF::Writer::getMessages ( void ) const
+{
+   return ( writer_messages );
+}
+
+/*
+ * Private member function to check that the annotations loaded with SpanAnnotations can be
+ * written: there must be a span source. Otherwise, it reports the problem and returns false.
+ */
+bool OpenCIF::Writer::checkSpans ( const std::vector< OpenCIF::Command* >& commands )
+{
+   if ( !writer_span_path.empty () )
+   {
+      return ( true );
+   }
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      if ( hasSpan ( commands[ i ] ) )
+      {
+         return ( refuseSpans () );
+      }
+   }
+   
+   return ( true );
+}
+
+/*
+ * Private member function to report that some commands can't be written. Returns false.
+ */
+bool OpenCIF::Writer::refuseSpans ( void )
+{
+   writer_messages.push_back ( std::string ( "Writer:write:Error: There are annotations loaded with SpanAnnotations, and no span source to copy them from. Nothing was written." ) );
+   
+   return ( false );
+}
+
+/*
+ * Private member function to know if a command is an annotation loaded with SpanAnnotations.
+ */
+bool OpenCIF::Writer::hasSpan ( OpenCIF::Command* command )
+{
+   return ( ( command->type () == OpenCIF::Command::Comment || command->type () == OpenCIF::Command::UserExtension ) &&
+            static_cast< OpenCIF::RawContentCommand* > ( command )->hasSpan () );
+}
+
+/*
+ * Member function to send the buffer contents to the output stream.
+ */
+void OpenCIF::Writer::flush ( void )
+{
+   if ( !writer_buffer.empty () )
+   {
+      writer_output.write ( writer_buffer.data () , writer_buffer.size () );
+      writer_buffer.clear ();
+   }
+   
+   writer_output.flush ();
+   
+   return;
+}
+
+/*
+ * This member function appends the text of a command to the end of a buffer.
+ * 
+ * In canonical mode, the text is the same generated by the stream operators of
+ * every command, followed by a new line:
+ * 
+ *      "B 1020 600 450 780 1 0 ;"
+ * 
+ * In compact mode, only the separators required by the FSM are written, the
+ * default values are omitted and there is no separation between commands:
+ * 
+ *      "B1020 600 450 780;"
+ * 
+ * The annotations loaded with SpanAnnotations are copied verbatim from "span_source"
+ * (nothing is appended without it).
+ */
+void OpenCIF::Writer::format ( std::string& buffer , OpenCIF::Command* command , const WriteMode& write_mode , std::istream* span_source )
+{
+   bool compact = ( write_mode == Compact );
+   
+   switch ( command->type () )
+   {
+      case OpenCIF::Command::Polygon:
+      case OpenCIF::Command::Wire:
+         {
+            OpenCIF::PathBasedCommand* path = static_cast< OpenCIF::PathBasedCommand* > ( command );
+            const OpenCIF::PointVector& points = path->getPoints ();
+            
+            if ( command->type () == OpenCIF::Command::Polygon )
+            {
+               buffer += ( compact ) ? "P" : "P ";
+            }
+            else
+            {
+               buffer += ( compact ) ? "W" : "W ";
+               appendUnsigned ( buffer , static_cast< OpenCIF::WireCommand* > ( command )->getWidth () );
+               buffer += ' ';
+            }
+            
+            for ( unsigned long int i = 0; i < points.size (); i++ )
+            {
+               if ( compact && i != 0 )
+               {
+                  buffer += ' ';
+               }
+               
+               appendPoint ( buffer , points[ i ] );
+               
+               if ( !compact )
+               {
+                  buffer += ' ';
+               }
+            }
+         }
+         break;
+         
+      case OpenCIF::Command::Box:
+         {
+            OpenCIF::BoxCommand* box = static_cast< OpenCIF::BoxCommand* > ( command );
+            OpenCIF::Size size = box->getSize ();
+            OpenCIF::Point rotation = box->getRotation ();
+            
+            buffer += ( compact ) ? "B" : "B ";
+            appendUnsigned ( buffer , size.getWidth () );
+            buffer += ' ';
+            appendUnsigned ( buffer , size.getHeight () );
+            buffer += ' ';
+            appendPoint ( buffer , box->getPosition () );
+            
+            if ( !compact || rotation.getX () != 1 || rotation.getY () != 0 )
+            {
+               buffer += ' ';
+               appendPoint ( buffer , rotation );
+            }
+            
+            if ( !compact )
+            {
+               buffer += ' ';
+            }
+         }
+         break;
+         
+      case OpenCIF::Command::RoundFlash:
+         {
+            OpenCIF::RoundFlashCommand* round_flash = static_cast< OpenCIF::RoundFlashCommand* > ( command );
+            
+            buffer += ( compact ) ? "R" : "R ";
+            appendUnsigned ( buffer , round_flash->getDiameter () );
+            buffer += ' ';
+            appendPoint ( buffer , round_flash->getPosition () );
+            
+            if ( !compact )
+            {
+               buffer += ' ';
+            }
+         }
+         break;
+         
+      case OpenCIF::Command::Layer:
+         buffer += ( compact ) ? "L" : "L ";
+         buffer += static_cast< OpenCIF::LayerCommand* > ( command )->getName ();
+         
+         if ( !compact )
+         {
+            buffer += ' ';
+         }
+         break;
+         
+      case OpenCIF::Command::DefinitionStart:
+         {
+            OpenCIF::DefinitionStartCommand* definition = static_cast< OpenCIF::DefinitionStartCommand* > ( command );
+            OpenCIF::Fraction ab = definition->getAB ();
+            
+            buffer += ( compact ) ? "DS" : "D S ";
+            appendUnsigned ( buffer , definition->getID () );
+            
+            if ( !compact || ab.getNumerator () != 1 || ab.getDenominator () != 1 )
+            {
+               buffer += ' ';
+               appendUnsigned ( buffer , ab.getNumerator () );
+               buffer += ' ';
+               appendUnsigned ( buffer , ab.getDenominator () );
+            }
+            
+            if ( !compact )
+            {
+               buffer += ' ';
+            }
+         }
+         break;
+         
+      case OpenCIF::Command::DefinitionDelete:
+         buffer += ( compact ) ? "DD" : "D D ";
+         appendUnsigned ( buffer , static_cast< OpenCIF::DefinitionDeleteCommand* > ( command )->getID () );
+         
+         if ( !compact )
+         {
+            buffer += ' ';
+         }
+         break;
+         
+      case OpenCIF::Command::DefinitionEnd:
+         buffer += ( compact ) ? "DF" : "D F ";
+         break;
+         
+      case OpenCIF::Command::Call:
+         {
+            const OpenCIF::CallCommand* call = static_cast< const OpenCIF::CallCommand* > ( command );
+            const std::vector< OpenCIF::Transformation >& transformations = call->getTransformations ();
+            
+            buffer += ( compact ) ? "C" : "C ";
+            appendUnsigned ( buffer , call->getID () );
+            
+            if ( !compact )
+            {
+               buffer += ' ';
+            }
+            
+            for ( unsigned long int i = 0; i < transformations.size (); i++ )
+            {
+               switch ( transformations[ i ].getType () )
+               {
+                  case OpenCIF::Transformation::Displacement:
+                     buffer += ( compact ) ? "T" : "T ";
+                     appendPoint ( buffer , transformations[ i ].getDisplacement () );
+                     break;
+                     
+                  case OpenCIF::Transformation::Rotation:
+                     buffer += ( compact ) ? "R" : "R ";
+                     appendPoint ( buffer , transformations[ i ].getRotation () );
+                     break;
+                     
+                  case OpenCIF::Transformation::VerticalMirroring:
+                     buffer += ( compact ) ? "MY" : "M Y";
+                     break;
+                     
+                  case OpenCIF::Transformation::HorizontalMirroring:
+                     buffer += ( compact ) ? "MX" : "M X";
+                     break;
+               }
+               
+               if ( !compact )
+               {
+                  buffer += ' ';
+               }
+            }
+         }
+         break;
+         
+      case OpenCIF::Command::Comment:
+      case OpenCIF::Command::UserExtension:
+         if ( static_cast< OpenCIF::RawContentCommand* > ( command )->hasSpan () )
+         {
+            // Loaded with SpanAnnotations: the text (with its semicolon) is copied from the source.
+            OpenCIF::RawContentCommand* annotation = static_cast< OpenCIF::RawContentCommand* > ( command );
+            unsigned long int start = buffer.size ();
+            
+            if ( span_source == 0 )
+            {
+               return;
+            }
+            
+            buffer.resize ( start + annotation->getSpanEnd () - annotation->getSpanBegin () );
+            span_source->clear ();
+            span_source->seekg ( annotation->getSpanBegin () );
+            span_source->read ( &buffer[ start ] , buffer.size () - start );
+            buffer.resize ( start + span_source->gcount () );
+            
+            if ( !compact )
+            {
+               buffer += '\n';
+            }
+            return;
+         }
+         
+         buffer += static_cast< OpenCIF::RawContentCommand* > ( command )->getContent ();
+         
+         if ( !compact )
+         {
+            buffer += ' ';
+         }
+         break;
+         
+      case OpenCIF::Command::End:
+         buffer += ( compact ) ? "E" : "E ";
+         break;
+         
+      default:
+         // Not a leaf class. Use the generic output (it reports the logical error).
+         {
+            std::ostringstream oss;
+            oss << command;
+            buffer += oss.str ();
+         }
+         
+         if ( !compact )
+         {
+            buffer += '\n';
+         }
+         return;
+   }
+   
+   buffer += ( compact ) ? ";" : ";\n";
+   
+   return;
+}
+
+/*
+ * This member function appends the decimal representation of an unsigned value.
+ * The digits are generated backwards into a small local array, avoiding the
+ * stream machinery.
+ */
+void OpenCIF::Writer::appendUnsigned ( std::string& buffer , unsigned long int value )
+{
+   char digits[ 24 ];
+   int position = 24;
+   
+   do
+   {
+      digits[ --position ] = (char)( '0' + ( value % 10 ) );
+      value /= 10;
+   }
+   while ( value != 0 );
+   
+   buffer.append ( digits + position , 24 - position );
+   
+   return;
+}
+
+/*
+ * This member function appends the decimal representation of a signed value.
+ */
+void OpenCIF::Writer::appendSigned ( std::string& buffer , const long int& value )
+{
+   if ( value < 0 )
+   {
+      buffer += '-';
+      
+      // Negate as unsigned to support the most negative value.
+      appendUnsigned ( buffer , 0UL - (unsigned long int)value );
+   }
+   else
+   {
+      appendUnsigned ( buffer , (unsigned long int)value );
+   }
+   
+   return;
+}
+
+/*
+ * This member function appends a point as "X Y".
+ */
+void OpenCIF::Writer::appendPoint ( std::string& buffer , const OpenCIF::Point& point )
+{
+   appendSigned ( buffer , point.getX () );
+   buffer += ' ';
+   appendSigned ( buffer , point.getY () );
+   
+   return;
+}
+
+// FILE: gdswriter.cc
+
+
+namespace
+{
+   // GDSII record types used by the exporter.
+   enum GDSRecord
+   {
+      GDSHeader = 0x00 ,
+      GDSBeginLibrary = 0x01 ,
+      GDSLibraryName = 0x02 ,
+      GDSUnits = 0x03 ,
+      GDSEndLibrary = 0x04 ,
+      GDSBeginStructure = 0x05 ,
+      GDSStructureName = 0x06 ,
+      GDSEndStructure = 0x07 ,
+      GDSBoundary = 0x08 ,
+      GDSPath = 0x09 ,
+      GDSStructureReference = 0x0A ,
+      GDSEndElement = 0x11 ,
+      GDSLayer = 0x0D ,
+      GDSDataType = 0x0E ,
+      GDSWidth = 0x0F ,
+      GDSXY = 0x10 ,
+      GDSReferenceName = 0x12 ,
+      GDSTransformation = 0x1A ,
+      GDSAngle = 0x1C ,
+      GDSPathType = 0x21
+   };
+   
+   // GDSII data types.
+   enum GDSDataType
+   {
+      GDSNoData = 0x00 ,
+      GDSBitArray = 0x01 ,
+      GDSInt16 = 0x02 ,
+      GDSInt32 = 0x03 ,
+      GDSReal8 = 0x05 ,
+      GDSString = 0x06
+   };
+   
+   // The XY record can't be longer than 65535 bytes.
+   const unsigned long int GDSMaximumPoints = 8191;
+   
+   const double GDSPi = 3.14159265358979323846;
+}
+
+/*
+ * Constructor. The stream is written in the output stream specified, that must be
+ * opened in binary mode.
+ */
+OpenCIF::GDSWriter::GDSWriter ( std::ostream& output_stream )
+   : gds_output ( output_stream ) ,
+     gds_library_name ( "LIBOPENCIF" ) ,
+     gds_top_name ( "TOP" ) ,
+     gds_circle_segments ( 32 ) ,
+     gds_layer ( -1 ) ,
+     gds_scale ( 1.0 ) ,
+     gds_overflows ( 0 )
+{
+   gds_buffer.reserve ( 1 << 20 );
+}
+
+/*
+ * Destructor. Nothing to do.
+ */
+OpenCIF::GDSWriter::~GDSWriter ( void )
+{
+}
+
+/*
+ * Member function to set the table that converts layer names into GDSII layer numbers.
+ */
+void OpenCIF::GDSWriter::setLayerMap ( const std::map< std::string , int >& new_layer_map )
+{
+   gds_layer_map = new_layer_map;
+   
+   return;
+}
+
+/*
+ * Member function to return the table that converts layer names into GDSII layer numbers.
+ */
+std::map< std::string , int > OpenCIF::GDSWriter::getLayerMap ( void ) const
+{
+   return ( gds_layer_map );
+}
+
+/*
+ * Member function to set the name of the GDSII library.
+ */
+void OpenCIF::GDSWriter::setLibraryName ( const std::string& new_name )
+{
+   gds_library_name = new_name;
+   
+   return;
+}
+
+/*
+ * Member function to return the name of the GDSII library.
+ */
+std::string OpenCIF::GDSWriter::getLibraryName ( void ) const
+{
+   return ( gds_library_name );
+}
+
+/*
+ * Member function to set the name of the structure that contains the commands outside of definitions.
+ */
+void OpenCIF::GDSWriter::setTopName ( const std::string& new_name )
+{
+   gds_top_name = new_name;
+   
+   return;
+}
+
+/*
+ * Member function to return the name of the structure that contains the commands outside of definitions.
+ */
+std::string OpenCIF::GDSWriter::getTopName ( void ) const
+{
+   return ( gds_top_name );
+}
+
+/*
+ * Member function to set the amount of vertices used to approximate a round flash.
+ */
+void OpenCIF::GDSWriter::setCircleSegments ( const unsigned int& new_segments )
+{
+   gds_circle_segments = ( new_segments < 4 ) ? 4 : new_segments;
+   
+   return;
+}
+
+/*
+ * Member function to return the amount of vertices used to approximate a round flash.
+ */
+unsigned int OpenCIF::GDSWriter::getCircleSegments ( void ) const
+{
+   return ( gds_circle_segments );
+}
+
+/*
+ * Member function to return the messages generated during the export.
+ */
+const std::vector< std::string >& OpenCIF::GDSWriter::getMessages ( void ) const
+{
+   return ( gds_messages );
+}
+
+/*
+ * Member function to export a list of commands. The CIF units are hundredths of
+ * micron, so the database unit of the library is 0.01 micron.
+ * 
+ * The first pass writes the definitions, and the second one the top structure with
+ * the commands outside of them. Both follow every layer command, since the layer set
+ * in a definition stays selected after it.
+ * 
+ * Returns false if the output stream reported an error, or if a coordinate didn't fit
+ * the GDSII range (it is clamped, so the file is complete but not right).
+ */
+bool OpenCIF::GDSWriter::write ( const std::vector< OpenCIF::Command* >& commands )
+{
+   gds_messages.clear ();
+   gds_unmapped_layers.clear ();
+   gds_buffer.clear ();
+   gds_layer = -1;
+   gds_scale = 1.0;
+   gds_overflows = 0;
+   
+   appendRecord ( GDSHeader , GDSInt16 , 600 );
+   writeDate ( GDSBeginLibrary );
+   appendRecord ( GDSLibraryName , gds_library_name );
+   beginRecord ( GDSUnits , GDSReal8 , 16 );
+   appendReal8 ( 0.01 ); // User units (microns) per database unit.
+   appendReal8 ( 1e-8 ); // Meters per database unit.
+   
+   bool inside = false;
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      OpenCIF::Command::CommandType type = commands[ i ]->type ();
+      
+      inside = inside || type == OpenCIF::Command::DefinitionStart;
+      
+      if ( inside || type == OpenCIF::Command::Layer )
+      {
+         writeCommand ( commands[ i ] );
+      }
+      
+      inside = inside && type != OpenCIF::Command::DefinitionEnd;
+      
+      if ( gds_buffer.size () >= ( 1 << 20 ) )
+      {
+         gds_output.write ( gds_buffer.data () , gds_buffer.size () );
+         gds_buffer.clear ();
+      }
+   }
+   
+   // The commands outside of definitions go into their own structure, started with its first element.
+   bool top_started = false;
+   
+   gds_layer = -1;
+   gds_scale = 1.0;
+   inside = false;
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      OpenCIF::Command::CommandType type = commands[ i ]->type ();
+      
+      if ( type == OpenCIF::Command::DefinitionStart || type == OpenCIF::Command::DefinitionEnd )
+      {
+         inside = ( type == OpenCIF::Command::DefinitionStart );
+      }
+      else if ( type == OpenCIF::Command::Layer )
+      {
+         writeCommand ( commands[ i ] );
+      }
+      else if ( !inside )
+      {
+         unsigned long int structure_start = gds_buffer.size ();
+         
+         if ( !top_started )
+         {
+            writeDate ( GDSBeginStructure );
+            appendRecord ( GDSStructureName , gds_top_name );
+         }
+         
+         unsigned long int element_start = gds_buffer.size ();
+         
+         writeCommand ( commands[ i ] );
+         
+         if ( !top_started && gds_buffer.size () == element_start )
+         {
+            gds_buffer.resize ( structure_start );
+         }
+         else
+         {
+            top_started = true;
+         }
+      }
+      
+      if ( gds_buffer.size () >= ( 1 << 20 ) )
+      {
+         gds_output.write ( gds_buffer.data () , gds_buffer.size () );
+         gds_buffer.clear ();
+      }
+   }
+   
+   if ( top_started )
+   {
+      beginRecord ( GDSEndStructure , GDSNoData , 0 );
+   }
+   
+   beginRecord ( GDSEndLibrary , GDSNoData , 0 );
+   
+   gds_output.write ( gds_buffer.data () , gds_buffer.size () );
+   gds_output.flush ();
+   gds_buffer.clear ();
+   
+   if ( gds_overflows != 0 )
+   {
+      std::ostringstream oss;
+      oss << "GDSWriter:write:Error: " << gds_overflows << " coordinates out of the GDSII range (32 bits). They were clamped.";
+      gds_messages.push_back ( oss.str () );
+   }
+   
+   return ( gds_output.good () && gds_overflows == 0 );
+}
+
+/*
+ * This member function generates the records of a single command.
+ */
+void OpenCIF::GDSWriter::writeCommand ( OpenCIF::Command* command )
+{
+   switch ( command->type () )
+   {
+      case OpenCIF::Command::DefinitionStart:
+         {
+            OpenCIF::DefinitionStartCommand* definition = static_cast< OpenCIF::DefinitionStartCommand* > ( command );
+            OpenCIF::Fraction ab = definition->getAB ();
+            std::ostringstream oss;
+            
+            oss << "S" << definition->getID ();
+            
+            writeDate ( GDSBeginStructure );
+            appendRecord ( GDSStructureName , oss.str () );
+            
+            // Every coordinate inside the definition is scaled by A/B.
+            gds_scale = ( ab.getDenominator () != 0 ) ? (double)ab.getNumerator () / (double)ab.getDenominator () : 1.0;
+         }
+         break;
+         
+      case OpenCIF::Command::DefinitionEnd:
+         beginRecord ( GDSEndStructure , GDSNoData , 0 );
+         gds_scale = 1.0;
+         break;
+         
+      case OpenCIF::Command::Layer:
+         {
+            const std::string& name = static_cast< OpenCIF::LayerCommand* > ( command )->getName ();
+            std::map< std::string , int >::const_iterator layer = gds_layer_map.find ( name );
+            
+            if ( layer != gds_layer_map.end () )
+            {
+               gds_layer = layer->second;
+            }
+            else
+            {
+               gds_layer = -1;
+               
+               if ( gds_unmapped_layers.insert ( name ).second )
+               {
+                  gds_messages.push_back ( std::string ( "GDSWriter:write:Warning: Layer \"" ) + name + std::string ( "\" is not in the layer map. Its primitives are skipped." ) );
+               }
+            }
+         }
+         break;
+         
+      case OpenCIF::Command::Box:
+         if ( gds_layer >= 0 )
+         {
+            OpenCIF::BoxCommand* box = static_cast< OpenCIF::BoxCommand* > ( command );
+            OpenCIF::Point position = box->getPosition ();
+            OpenCIF::Point rotation = box->getRotation ();
+            OpenCIF::Size size = box->getSize ();
+            double length = std::sqrt ( (double)rotation.getX () * rotation.getX () + (double)rotation.getY () * rotation.getY () );
+            double cosine = ( length != 0.0 ) ? rotation.getX () / length : 1.0;
+            double sine = ( length != 0.0 ) ? rotation.getY () / length : 0.0;
+            double half_width = size.getWidth () / 2.0;
+            double half_height = size.getHeight () / 2.0;
+            double corners[ 4 ][ 2 ] = { { -half_width , -half_height } ,
+                                         {  half_width , -half_height } ,
+                                         {  half_width ,  half_height } ,
+                                         { -half_width ,  half_height } };
+            std::vector< double > coordinates;
+            
+            for ( int i = 0; i < 4; i++ )
+            {
+               coordinates.push_back ( position.getX () + corners[ i ][ 0 ] * cosine - corners[ i ][ 1 ] * sine );
+               coordinates.push_back ( position.getY () + corners[ i ][ 0 ] * sine + corners[ i ][ 1 ] * cosine );
+            }
+            
+            writeBoundary ( coordinates );
+         }
+         break;
+         
+      case OpenCIF::Command::Polygon:
+         if ( gds_layer >= 0 )
+         {
+            const OpenCIF::PointVector& points = static_cast< OpenCIF::PolygonCommand* > ( command )->getPoints ();
+            std::vector< double > coordinates;
+            
+            for ( unsigned long int i = 0; i < points.size (); i++ )
+            {
+               coordinates.push_back ( points[ i ].getX () );
+               coordinates.push_back ( points[ i ].getY () );
+            }
+            
+            writeBoundary ( coordinates );
+         }
+         break;
+         
+      case OpenCIF::Command::RoundFlash:
+         if ( gds_layer >= 0 )
+         {
+            OpenCIF::RoundFlashCommand* round_flash = static_cast< OpenCIF::RoundFlashCommand* > ( command );
+            OpenCIF::Point position = round_flash->getPosition ();
+            double radius = round_flash->getDiameter () / 2.0;
+            std::vector< double > coordinates;
+            
+            for ( unsigned int i = 0; i < gds_circle_segments; i++ )
+            {
+               double angle = 2.0 * GDSPi * i / gds_circle_segments;
+               
+               coordinates.push_back ( position.getX () + radius * std::cos ( angle ) );
+               coordinates.push_back ( position.getY () + radius * std::sin ( angle ) );
+            }
+            
+            writeBoundary ( coordinates );
+         }
+         break;
+         
+      case OpenCIF::Command::Wire:
+         if ( gds_layer >= 0 )
+         {
+            writePath ( static_cast< OpenCIF::WireCommand* > ( command ) );
+         }
+         break;
+         
+      case OpenCIF::Command::Call:
+         writeReference ( static_cast< OpenCIF::CallCommand* > ( command ) );
+         break;
+         
+      case OpenCIF::Command::DefinitionDelete:
+         gds_messages.push_back ( std::string ( "GDSWriter:write:Warning: Definition delete commands have no GDSII equivalent. Skipped." ) );
+         break;
+         
+      default:
+         // Comments, user extensions and the end command have no GDSII equivalent.
+         break;
+   }
+   
+   return;
+}
+
+/*
+ * This member function generates a boundary element. The coordinates are pairs of X and Y
+ * values, in the units of the current definition. The closing point is added here.
+ */
+void OpenCIF::GDSWriter::writeBoundary ( const std::vector< double >& coordinates )
+{
+   unsigned long int point_amount = coordinates.size () / 2;
+   
+   if ( point_amount + 1 > GDSMaximumPoints )
+   {
+      gds_messages.push_back ( std::string ( "GDSWriter:write:Warning: Polygon with too many vertices for a GDSII boundary. Skipped." ) );
+      
+      return;
+   }
+   
+   appendRecord ( GDSBoundary , GDSNoData , 0 );
+   appendRecord ( GDSLayer , GDSInt16 , gds_layer );
+   appendRecord ( GDSDataType , GDSInt16 , 0 );
+   beginRecord ( GDSXY , GDSInt32 , ( point_amount + 1 ) * 8 );
+   
+   for ( unsigned long int i = 0; i <= point_amount; i++ )
+   {
+      appendInt32 ( scale ( coordinates[ ( i % point_amount ) * 2 ] ) );
+      appendInt32 ( scale ( coordinates[ ( i % point_amount ) * 2 + 1 ] ) );
+   }
+   
+   appendRecord ( GDSEndElement , GDSNoData , 0 );
+   
+   return;
+}
+
+/*
+ * This member function generates a path element. The CIF wires have round ends, so
+ * the path type is 1.
+ */
+void OpenCIF::GDSWriter::writePath ( OpenCIF::WireCommand* wire )
+{
+   const OpenCIF::PointVector& points = wire->getPoints ();
+   
+   if ( points.size () > GDSMaximumPoints )
+   {
+      gds_messages.push_back ( std::string ( "GDSWriter:write:Warning: Wire with too many vertices for a GDSII path. Skipped." ) );
+      
+      return;
+   }
+   
+   appendRecord ( GDSPath , GDSNoData , 0 );
+   appendRecord ( GDSLayer , GDSInt16 , gds_layer );
+   appendRecord ( GDSDataType , GDSInt16 , 0 );
+   appendRecord ( GDSPathType , GDSInt16 , 1 );
+   beginRecord ( GDSWidth , GDSInt32 , 4 );
+   appendInt32 ( scale ( wire->getWidth () ) );
+   beginRecord ( GDSXY , GDSInt32 , points.size () * 8 );
+   
+   for ( unsigned long int i = 0; i < points.size (); i++ )
+   {
+      appendInt32 ( scale ( points[ i ].getX () ) );
+      appendInt32 ( scale ( points[ i ].getY () ) );
+   }
+   
+   appendRecord ( GDSEndElement , GDSNoData , 0 );
+   
+   return;
+}
+
+/*
+ * This member function generates a structure reference.
+ * 
+ * The transformations of the call are reduced to a single placement. GDSII applies
+ * first a reflection over the X axis, then a rotation and then the displacement. A
+ * Manhattan placement maps to them directly: "M X" is that reflection turned by 180
+ * degrees. A general placement is split from its matrix: if its determinant is
+ * negative there is a reflection, and the first column gives the rotation angle.
+ */
+void OpenCIF::GDSWriter::writeReference ( OpenCIF::CallCommand* call )
+{
+   OpenCIF::Placement placement = call->getPlacement ();
+   double matrix[ 2 ][ 2 ];
+   double displacement[ 2 ];
+   bool reflection;
+   double angle;
+   
+   placement.getMatrix ( matrix , displacement );
+   
+   if ( placement.isManhattan () )
+   {
+      int orientation = placement.getOrientation ();
+      
+      reflection = ( orientation >= OpenCIF::Placement::MirroredR0 );
+      angle = 90.0 * ( ( orientation + ( ( reflection ) ? 2 : 0 ) ) % 4 );
+   }
+   else
+   {
+      reflection = ( matrix[ 0 ][ 0 ] * matrix[ 1 ][ 1 ] - matrix[ 0 ][ 1 ] * matrix[ 1 ][ 0 ] ) < 0.0;
+      angle = std::atan2 ( matrix[ 1 ][ 0 ] , matrix[ 0 ][ 0 ] ) * 180.0 / GDSPi;
+      
+      // Keep the angles close to integers exact.
+      if ( std::fabs ( angle - std::floor ( angle + 0.5 ) ) < 1e-9 )
+      {
+         angle = std::floor ( angle + 0.5 );
+      }
+      
+      if ( angle < 0.0 )
+      {
+         angle += 360.0;
+      }
+   }
+   
+   std::ostringstream oss;
+   oss << "S" << call->getID ();
+   
+   appendRecord ( GDSStructureReference , GDSNoData , 0 );
+   appendRecord ( GDSReferenceName , oss.str () );
+   
+   if ( reflection || angle != 0.0 )
+   {
+      beginRecord ( GDSTransformation , GDSBitArray , 2 );
+      appendInt16 ( ( reflection ) ? 0x8000 : 0x0000 );
+      
+      if ( angle != 0.0 )
+      {
+         beginRecord ( GDSAngle , GDSReal8 , 8 );
+         appendReal8 ( angle );
+      }
+   }
+   
+   beginRecord ( GDSXY , GDSInt32 , 8 );
+   appendInt32 ( scale ( displacement[ 0 ] ) );
+   appendInt32 ( scale ( displacement[ 1 ] ) );
+   appendRecord ( GDSEndElement , GDSNoData , 0 );
+   
+   return;
+}
+
+/*
+ * This member function generates a record with the modification and access dates
+ * (used by the library and structure start records).
+ */
+void OpenCIF::GDSWriter::writeDate ( const int& record_type )
+{
+   std::time_t now = std::time ( 0 );
+   std::tm* date = std::localtime ( &now );
+   int values[ 6 ] = { date->tm_year , date->tm_mon + 1 , date->tm_mday , date->tm_hour , date->tm_min , date->tm_sec };
+   
+   beginRecord ( record_type , GDSInt16 , 24 );
+   
+   for ( int i = 0; i < 12; i++ )
+   {
+      appendInt16 ( values[ i % 6 ] );
+   }
+   
+   return;
+}
+
+/*
+ * This member function writes a record header. The length of the record includes the header.
+ */
+void OpenCIF::GDSWriter::beginRecord ( const int& record_type , const int& data_type , const unsigned long int& data_length )
+{
+   appendInt16 ( (int)( data_length + 4 ) );
+   gds_buffer += (char)record_type;
+   gds_buffer += (char)data_type;
+   
+   return;
+}
+
+/*
+ * This member function writes a 2 bytes integer (big endian).
+ */
+void OpenCIF::GDSWriter::appendInt16 ( const int& value )
+{
+   gds_buffer += (char)( ( value >> 8 ) & 0xFF );
+   gds_buffer += (char)( value & 0xFF );
+   
+   return;
+}
+
+/*
+ * This member function writes a 4 bytes integer (big endian).
+ */
+void OpenCIF::GDSWriter::appendInt32 ( const long int& value )
+{
+   unsigned long int bits = (unsigned long int)value;
+   
+   gds_buffer += (char)( ( bits >> 24 ) & 0xFF );
+   gds_buffer += (char)( ( bits >> 16 ) & 0xFF );
+   gds_buffer += (char)( ( bits >> 8 ) & 0xFF );
+   gds_buffer += (char)( bits & 0xFF );
+   
+   return;
+}
+
+/*
+ * This member function writes an 8 bytes real, in the GDSII format: a sign bit, a
+ * base 16 exponent with an excess of 64 and a 56 bits mantissa.
+ */
+void OpenCIF::GDSWriter::appendReal8 ( double value )
+{
+   unsigned char bytes[ 8 ] = { 0 , 0 , 0 , 0 , 0 , 0 , 0 , 0 };
+   
+   if ( value != 0.0 )
+   {
+      int exponent = 64;
+      
+      if ( value < 0.0 )
+      {
+         bytes[ 0 ] = 0x80;
+         value = -value;
+      }
+      
+      while ( value >= 1.0 )
+      {
+         value /= 16.0;
+         exponent++;
+      }
+      
+      while ( value < 1.0 / 16.0 )
+      {
+         value *= 16.0;
+         exponent--;
+      }
+      
+      bytes[ 0 ] |= (unsigned char)( exponent & 0x7F );
+      
+      // Extract the mantissa a byte at a time.
+      for ( int i = 1; i < 8; i++ )
+      {
+         value *= 256.0;
+         bytes[ i ] = (unsigned char)value;
+         value -= bytes[ i ];
+      }
+   }
+   
+   gds_buffer.append ( reinterpret_cast< char* > ( bytes ) , 8 );
+   
+   return;
+}
+
+/*
+ * This member function writes a string, padded with a null char to an even length.
+ */
+void OpenCIF::GDSWriter::appendString ( const std::string& value )
+{
+   gds_buffer += value;
+   
+   if ( value.size () % 2 != 0 )
+   {
+      gds_buffer += '\0';
+   }
+   
+   return;
+}
+
+/*
+ * This member function writes a complete record with a single 2 bytes value (or no value at all).
+ */
+void OpenCIF::GDSWriter::appendRecord ( const int& record_type , const int& data_type , const int& value )
+{
+   if ( data_type == GDSNoData )
+   {
+      beginRecord ( record_type , data_type , 0 );
+   }
+   else
+   {
+      beginRecord ( record_type , data_type , 2 );
+      appendInt16 ( value );
+   }
+   
+   return;
+}
+
+/*
+ * This member function writes a complete record with a string value.
+ */
+void OpenCIF::GDSWriter::appendRecord ( const int& record_type , const std::string& value )
+{
+   beginRecord ( record_type , GDSString , value.size () + ( value.size () % 2 ) );
+   appendString ( value );
+   
+   return;
+}
+
+/*
+ * This member function scales a coordinate of the current definition, and rounds it to
+ * the nearest integer. The values out of the GDSII range are clamped, and counted to be
+ * reported once at the end of the export.
+ */
+long int OpenCIF::GDSWriter::scale ( const double& value )
+{
+   double scaled = std::floor ( value * gds_scale + 0.5 );
+   
+   if ( scaled > 2147483647.0 || scaled < -2147483648.0 )
+   {
+      gds_overflows++;
+      
+      return ( ( scaled > 0 ) ? 2147483647L : -2147483647L - 1 );
+   }
+   
+   return ( (long int)scaled );
+}
+
+// FILE: gdsreader.cc
+
+
+namespace
+{
+   // GDSII record types used by the reader (the ones shared with the writer are repeated here).
+   enum GDSInputRecord
+   {
+      GDSInputUnits = 0x03 ,
+      GDSInputEndLibrary = 0x04 ,
+      GDSInputBeginStructure = 0x05 ,
+      GDSInputStructureName = 0x06 ,
+      GDSInputEndStructure = 0x07 ,
+      GDSInputBoundary = 0x08 ,
+      GDSInputPath = 0x09 ,
+      GDSInputStructureReference = 0x0A ,
+      GDSInputArrayReference = 0x0B ,
+      GDSInputText = 0x0C ,
+      GDSInputLayer = 0x0D ,
+      GDSInputWidth = 0x0F ,
+      GDSInputXY = 0x10 ,
+      GDSInputEndElement = 0x11 ,
+      GDSInputReferenceName = 0x12 ,
+      GDSInputColumnRow = 0x13 ,
+      GDSInputString = 0x19 ,
+      GDSInputTransformation = 0x1A ,
+      GDSInputMagnification = 0x1B ,
+      GDSInputAngle = 0x1C ,
+      GDSInputPathType = 0x21
+   };
+   
+   // Size of the blocks read from the file. Must be bigger than the biggest record (65535 bytes).
+   const unsigned long int GDSInputBlockSize = 1 << 20;
+   
+   const double GDSInputPi = 3.14159265358979323846;
+}
+
+/*
+ * Default constructor.
+ */
+OpenCIF::GDSReader::GDSReader ( void )
+   : reader_start ( 0 ) ,
+     reader_end ( 0 ) ,
+     record_type ( 0 ) ,
+     record_data_type ( 0 ) ,
+     record_data ( 0 ) ,
+     record_length ( 0 ) ,
+     record_short ( false ) ,
+     element_type ( 0 ) ,
+     current_layer ( -1 )
+{
+}
+
+/*
+ * Destructor. Delete the commands stored (if any).
+ */
+OpenCIF::GDSReader::~GDSReader ( void )
+{
+   for ( unsigned long int i = 0; i < reader_commands.size (); i++ )
+   {
+      delete reader_commands[ i ];
+      reader_commands[ i ] = 0;
+   }
+}
+
+/*
+ * Member function to set the path to the GDSII file.
+ */
+void OpenCIF::GDSReader::setPath ( const std::string& new_path )
+{
+   reader_path = new_path;
+   
+   return;
+}
+
+/*
+ * Member function to return the path to the GDSII file.
+ */
+std::string OpenCIF::GDSReader::getPath ( void ) const
+{
+   return ( reader_path );
+}
+
+/*
+ * Member function to set the table that converts GDSII layer numbers into layer names.
+ */
+void OpenCIF::GDSReader::setLayerMap ( const std::map< int , std::string >& new_layer_map )
+{
+   reader_layer_map = new_layer_map;
+   
+   return;
+}
+
+/*
+ * Member function to return the table that converts GDSII layer numbers into layer names.
+ */
+std::map< int , std::string > OpenCIF::GDSReader::getLayerMap ( void ) const
+{
+   return ( reader_layer_map );
+}
+
+/*
+ * Member function to return the commands generated.
+ */
+const std::vector< OpenCIF::Command* >& OpenCIF::GDSReader::getCommands ( void ) const
+{
+   return ( reader_commands );
+}
+
+/*
+ * Member function to forget the commands generated, without deleting them.
+ */
+void OpenCIF::GDSReader::dropCommands ( void )
+{
+   std::vector< OpenCIF::Command* > temporal_vector;
+   reader_commands = temporal_vector;
+   
+   return;
+}
+
+/*
+ * Member function to return the messages generated while reading the file.
+ */
+const std::vector< std::string >& OpenCIF::GDSReader::getMessages ( void ) const
+{
+   return ( reader_messages );
+}
+
+/*
+ * Member function to read the GDSII file and convert its contents into commands.
+ */
+OpenCIF::File::LoadStatus OpenCIF::GDSReader::read ( void )
+{
+   for ( unsigned long int i = 0; i < reader_commands.size (); i++ )
+   {
+      delete reader_commands[ i ];
+      reader_commands[ i ] = 0;
+   }
+   
+   reader_commands.clear ();
+   reader_messages.clear ();
+   reader_structures.clear ();
+   reader_referenced.clear ();
+   reader_scale.set ( 1 , 1 );
+   
+   if ( reader_input.is_open () )
+   {
+      reader_input.close ();
+   }
+   
+   reader_input.clear ();
+   reader_input.open ( reader_path.c_str () , std::ios::in | std::ios::binary );
+   
+   if ( !reader_input.is_open () )
+   {
+      reader_messages.push_back ( std::string ( "GDSReader:read:Error: Can't open input file." ) );
+      
+      return ( OpenCIF::File::CantOpenInputFile );
+   }
+   
+   reader_buffer.resize ( GDSInputBlockSize );
+   reader_start = 0;
+   reader_end = 0;
+   record_short = false;
+   element_type = 0;
+   
+   bool library_ended = false;
+   
+   while ( !library_ended && !record_short && nextRecord () )
+   {
+      switch ( record_type )
+      {
+         case GDSInputUnits:
+            {
+               // Second value: meters per database unit. The CIF unit is 0.01 micron (1e-8 meters).
+               double ratio = recordReal ( 1 ) / 1e-8;
+               unsigned long int numerator = 1 , denominator = 1;
+               
+               if ( record_short )
+               {
+                  break;
+               }
+               
+               if ( ratio >= 1.0 )
+               {
+                  numerator = (unsigned long int)( ratio + 0.5 );
+               }
+               else if ( ratio > 0.0 )
+               {
+                  denominator = (unsigned long int)( 1.0 / ratio + 0.5 );
+               }
+               
+               if ( std::fabs ( (double)numerator / denominator - ratio ) > ratio * 1e-9 )
+               {
+                  reader_messages.push_back ( std::string ( "GDSReader:read:Warning: The database unit is not a multiple nor a divisor of 0.01 micron. Coordinates are approximated." ) );
+               }
+               
+               reader_scale.set ( numerator , denominator );
+            }
+            break;
+            
+         case GDSInputStructureName:
+            {
+               std::string name = recordString ();
+               OpenCIF::DefinitionStartCommand* definition = new OpenCIF::DefinitionStartCommand ();
+               OpenCIF::UserExtensionCommand* extension = new OpenCIF::UserExtensionCommand ();
+               
+               definition->setID ( structureID ( name ) );
+               definition->setAB ( reader_scale );
+               extension->setContent ( std::string ( "9 " ) + name );
+               
+               reader_commands.push_back ( definition );
+               reader_commands.push_back ( extension );
+               current_layer = -1;
+            }
+            break;
+            
+         case GDSInputEndStructure:
+            reader_commands.push_back ( new OpenCIF::DefinitionEndCommand () );
+            break;
+            
+         case GDSInputBoundary:
+         case GDSInputPath:
+         case GDSInputStructureReference:
+         case GDSInputArrayReference:
+         case GDSInputText:
+            element_type = record_type;
+            element_layer = 0;
+            element_path_type = 0;
+            element_width = 0;
+            element_reflection = false;
+            element_angle = 0.0;
+            element_magnification = 1.0;
+            element_columns = 1;
+            element_rows = 1;
+            element_name.clear ();
+            element_points.clear ();
+            break;
+            
+         case GDSInputLayer:
+            element_layer = (int)recordInt ( 0 );
+            break;
+            
+         case GDSInputPathType:
+            element_path_type = (int)recordInt ( 0 );
+            break;
+            
+         case GDSInputWidth:
+            element_width = recordInt ( 0 );
+            element_width = ( element_width < 0 ) ? -element_width : element_width;
+            break;
+            
+         case GDSInputReferenceName:
+         case GDSInputString:
+            element_name = recordString ();
+            break;
+            
+         case GDSInputTransformation:
+            element_reflection = ( record_length >= 1 ) && ( ( record_data[ 0 ] & 0x80 ) != 0 );
+            break;
+            
+         case GDSInputMagnification:
+            element_magnification = recordReal ( 0 );
+            break;
+            
+         case GDSInputAngle:
+            element_angle = recordReal ( 0 );
+            break;
+            
+         case GDSInputColumnRow:
+            element_columns = recordInt ( 0 );
+            element_rows = recordInt ( 1 );
+            break;
+            
+         case GDSInputXY:
+            for ( unsigned long int i = 0; i + 1 < record_length / 4; i += 2 )
+            {
+               element_points.push_back ( OpenCIF::Point ( recordInt ( i ) , recordInt ( i + 1 ) ) );
+            }
+            break;
+            
+         case GDSInputEndElement:
+            switch ( element_type )
+            {
+               case GDSInputBoundary:
+                  addBoundary ();
+                  break;
+                  
+               case GDSInputPath:
+                  addPath ();
+                  break;
+                  
+               case GDSInputStructureReference:
+               case GDSInputArrayReference:
+                  addCalls ();
+                  break;
+                  
+               case GDSInputText:
+                  addText ();
+                  break;
+            }
+            
+            element_type = 0;
+            break;
+            
+         case GDSInputEndLibrary:
+            library_ended = true;
+            break;
+            
+         default:
+            // Records without a CIF equivalent (dates, library name, properties, nodes, ...)
+            break;
+      }
+   }
+   
+   reader_input.close ();
+   
+   // Release the block buffer.
+   std::vector< char > empty_buffer;
+   reader_buffer.swap ( empty_buffer );
+   
+   if ( record_short )
+   {
+      reader_messages.push_back ( std::string ( "GDSReader:read:Error: A record is too short for its values (the file is damaged)." ) );
+      
+      return ( OpenCIF::File::IncorrectInputFile );
+   }
+   
+   if ( !library_ended )
+   {
+      reader_messages.push_back ( std::string ( "GDSReader:read:Error: The file contents are incomplete (missing ENDLIB record)." ) );
+      
+      return ( OpenCIF::File::IncompleteInputFile );
+   }
+   
+   // The structures never referenced are the top cells. Call them, as a CIF file does.
+   std::map< std::string , unsigned long int >::const_iterator structure;
+   
+   for ( structure = reader_structures.begin (); structure != reader_structures.end (); structure++ )
+   {
+      if ( reader_referenced.find ( structure->second ) == reader_referenced.end () )
+      {
+         OpenCIF::CallCommand* call = new OpenCIF::CallCommand ();
+         call->setID ( structure->second );
+         reader_commands.push_back ( call );
+      }
+   }
+   
+   reader_commands.push_back ( new OpenCIF::EndCommand () );
+   
+   return ( OpenCIF::File::AllOk );
+}
+
+/*
+ * This member function makes the next record available. The records are decoded from
+ * the block buffer. When the record is not complete in the buffer, the remaining bytes
+ * are moved to the start of the buffer and the buffer is filled again.
+ * 
+ * Returns false at the end of the file (or if the file is truncated).
+ */
+bool OpenCIF::GDSReader::nextRecord ( void )
+{
+   for ( int attempt = 0; attempt < 2; attempt++ )
+   {
+      unsigned long int available = reader_end - reader_start;
+      
+      if ( available >= 4 )
+      {
+         const unsigned char* header = reinterpret_cast< const unsigned char* > ( &reader_buffer[ reader_start ] );
+         unsigned long int length = ( (unsigned long int)header[ 0 ] << 8 ) | header[ 1 ];
+         
+         if ( length < 4 )
+         {
+            // Some files are padded with zeros after the end of the library.
+            return ( false );
+         }
+         
+         if ( available >= length )
+         {
+            record_type = header[ 2 ];
+            record_data_type = header[ 3 ];
+            record_data = header + 4;
+            record_length = length - 4;
+            reader_start += length;
+            
+            return ( true );
+         }
+      }
+      
+      // Refill the buffer.
+      std::copy ( reader_buffer.begin () + reader_start , reader_buffer.begin () + reader_end , reader_buffer.begin () );
+      reader_end = available;
+      reader_start = 0;
+      
+      reader_input.read ( &reader_buffer[ reader_end ] , reader_buffer.size () - reader_end );
+      reader_end += reader_input.gcount ();
+   }
+   
+   return ( false );
+}
+
+/*
+ * This member function returns an integer from the current record (2 or 4 bytes, big endian).
+ * If the record is too short to hold it, it returns zero and marks the record as short.
+ */
+long int OpenCIF::GDSReader::recordInt ( const unsigned long int& index )
+{
+   unsigned long int width = ( record_data_type == 0x02 ) ? 2 : 4;
+   
+   if ( index * width + width > record_length )
+   {
+      record_short = true;
+      
+      return ( 0 );
+   }
+   
+   if ( record_data_type == 0x02 )
+   {
+      const unsigned char* bytes = record_data + index * 2;
+      
+      return ( (long int)(short)( ( bytes[ 0 ] << 8 ) | bytes[ 1 ] ) );
+   }
+   
+   const unsigned char* bytes = record_data + index * 4;
+   unsigned long int value = ( (unsigned long int)bytes[ 0 ] << 24 ) |
+                             ( (unsigned long int)bytes[ 1 ] << 16 ) |
+                             ( (unsigned long int)bytes[ 2 ] << 8 ) |
+                             (unsigned long int)bytes[ 3 ];
+   
+   // Sign extension of the 32 bits value.
+   return ( ( value & 0x80000000UL ) ? -(long int)( ( ~value & 0xFFFFFFFFUL ) + 1 ) : (long int)value );
+}
+
+/*
+ * This member function returns an 8 bytes real from the current record. If the record is
+ * too short to hold it, it returns zero and marks the record as short.
+ */
+double OpenCIF::GDSReader::recordReal ( const unsigned long int& index )
+{
+   if ( index * 8 + 8 > record_length )
+   {
+      record_short = true;
+      
+      return ( 0.0 );
+   }
+   
+   const unsigned char* bytes = record_data + index * 8;
+   double mantissa = 0.0;
+   
+   for ( int i = 7; i >= 1; i-- )
+   {
+      mantissa = ( mantissa + bytes[ i ] ) / 256.0;
+   }
+   
+   double value = mantissa * std::pow ( 16.0 , (int)( bytes[ 0 ] & 0x7F ) - 64 );
+   
+   return ( ( bytes[ 0 ] & 0x80 ) ? -value : value );
+}
+
+/*
+ * This member function returns the string in the current record, without the padding.
+ */
+std::string OpenCIF::GDSReader::recordString ( void ) const
+{
+   unsigned long int length = record_length;
+   
+   while ( length > 0 && record_data[ length - 1 ] == '\0' )
+   {
+      length--;
+   }
+   
+   return ( std::string ( reinterpret_cast< const char* > ( record_data ) , length ) );
+}
+
+/*
+ * This member function returns the definition ID of a structure. The IDs are
+ * assigned in the order the structures are found (defined or referenced).
+ */
+unsigned long int OpenCIF::GDSReader::structureID ( const std::string& name )
+{
+   std::map< std::string , unsigned long int >::iterator structure = reader_structures.find ( name );
+   
+   if ( structure != reader_structures.end () )
+   {
+      return ( structure->second );
+   }
+   
+   unsigned long int id = reader_structures.size () + 1;
+   reader_structures[ name ] = id;
+   
+   return ( id );
+}
+
+/*
+ * This member function adds a layer command, if the layer is not the current one.
+ */
+void OpenCIF::GDSReader::addLayer ( const int& layer )
+{
+   if ( layer == current_layer )
+   {
+      return;
+   }
+   
+   std::map< int , std::string >::const_iterator name = reader_layer_map.find ( layer );
+   OpenCIF::LayerCommand* command = new OpenCIF::LayerCommand ();
+   
+   if ( name != reader_layer_map.end () )
+   {
+      command->setName ( name->second );
+   }
+   else
+   {
+      std::ostringstream oss;
+      oss << "G" << layer;
+      command->setName ( oss.str () );
+   }
+   
+   reader_commands.push_back ( command );
+   current_layer = layer;
+   
+   return;
+}
+
+/*
+ * This member function converts a boundary. A rectangle with a center in integer
+ * coordinates turns into a box, anything else into a polygon.
+ */
+void OpenCIF::GDSReader::addBoundary ( void )
+{
+   // The last point repeats the first one.
+   if ( element_points.size () > 1 &&
+        element_points.front ().getX () == element_points.back ().getX () &&
+        element_points.front ().getY () == element_points.back ().getY () )
+   {
+      element_points.pop_back ();
+   }
+   
+   if ( element_points.size () < 3 )
+   {
+      return;
+   }
+   
+   addLayer ( element_layer );
+   
+   if ( element_points.size () == 4 )
+   {
+      const std::vector< OpenCIF::Point >& p = element_points;
+      bool horizontal_first = p[ 0 ].getY () == p[ 1 ].getY () && p[ 1 ].getX () == p[ 2 ].getX () &&
+                              p[ 2 ].getY () == p[ 3 ].getY () && p[ 3 ].getX () == p[ 0 ].getX ();
+      bool vertical_first = p[ 0 ].getX () == p[ 1 ].getX () && p[ 1 ].getY () == p[ 2 ].getY () &&
+                            p[ 2 ].getX () == p[ 3 ].getX () && p[ 3 ].getY () == p[ 0 ].getY ();
+      long int x_sum = p[ 0 ].getX () + p[ 2 ].getX ();
+      long int y_sum = p[ 0 ].getY () + p[ 2 ].getY ();
+      
+      if ( ( horizontal_first || vertical_first ) && x_sum % 2 == 0 && y_sum % 2 == 0 )
+      {
+         long int width = p[ 2 ].getX () - p[ 0 ].getX ();
+         long int height = p[ 2 ].getY () - p[ 0 ].getY ();
+         OpenCIF::BoxCommand* box = new OpenCIF::BoxCommand ();
+         
+         box->setSize ( OpenCIF::Size ( ( width < 0 ) ? -width : width , ( height < 0 ) ? -height : height ) );
+         box->setPosition ( OpenCIF::Point ( x_sum / 2 , y_sum / 2 ) );
+         reader_commands.push_back ( box );
+         
+         return;
+      }
+   }
+   
+   OpenCIF::PolygonCommand* polygon = new OpenCIF::PolygonCommand ();
+   polygon->setPoints ( element_points );
+   reader_commands.push_back ( polygon );
+   
+   return;
+}
+
+/*
+ * This member function converts a path into a wire. The CIF wires have round ends.
+ */
+void OpenCIF::GDSReader::addPath ( void )
+{
+   if ( element_points.empty () )
+   {
+      return;
+   }
+   
+   if ( element_path_type != 1 )
+   {
+      reader_messages.push_back ( std::string ( "GDSReader:read:Warning: Path without round ends converted into a wire (CIF wires always have round ends)." ) );
+   }
+   
+   addLayer ( element_layer );
+   
+   OpenCIF::WireCommand* wire = new OpenCIF::WireCommand ();
+   wire->setWidth ( element_width );
+   wire->setPoints ( element_points );
+   reader_commands.push_back ( wire );
+   
+   return;
+}
+
+/*
+ * This member function converts a structure reference (or an array of them) into calls.
+ * 
+ * GDSII applies a reflection over the X axis, a rotation and a displacement, in that
+ * order, so the transformations are "M Y", "R" and "T". The Manhattan rotations are
+ * stored exactly; other angles use a direction vector with six decimals.
+ */
+void OpenCIF::GDSReader::addCalls ( void )
+{
+   if ( element_points.empty () )
+   {
+      return;
+   }
+   
+   if ( element_magnification != 1.0 )
+   {
+      reader_messages.push_back ( std::string ( "GDSReader:read:Warning: Magnified references are not supported by CIF. Magnification ignored." ) );
+   }
+   
+   unsigned long int id = structureID ( element_name );
+   reader_referenced.insert ( id );
+   
+   // Rotation, if any.
+   OpenCIF::Transformation rotation;
+   double angle = std::fmod ( element_angle , 360.0 );
+   
+   angle = ( angle < 0.0 ) ? angle + 360.0 : angle;
+   rotation.setType ( OpenCIF::Transformation::Rotation );
+   
+   if ( angle == 90.0 )
+   {
+      rotation.setRotation ( OpenCIF::Point ( 0 , 1 ) );
+   }
+   else if ( angle == 180.0 )
+   {
+      rotation.setRotation ( OpenCIF::Point ( -1 , 0 ) );
+   }
+   else if ( angle == 270.0 )
+   {
+      rotation.setRotation ( OpenCIF::Point ( 0 , -1 ) );
+   }
+   else
+   {
+      double radians = angle * GDSInputPi / 180.0;
+      rotation.setRotation ( OpenCIF::Point ( (long int)std::floor ( std::cos ( radians ) * 1000000.0 + 0.5 ) ,
+                                              (long int)std::floor ( std::sin ( radians ) * 1000000.0 + 0.5 ) ) );
+   }
+   
+   // Positions. A single reference has one; an array has the origin and the displacement
+   // points of the columns and the rows.
+   long int columns = 1 , rows = 1;
+   double column_step[ 2 ] = { 0.0 , 0.0 } , row_step[ 2 ] = { 0.0 , 0.0 };
+   
+   if ( element_type == GDSInputArrayReference && element_points.size () >= 3 && element_columns > 0 && element_rows > 0 )
+   {
+      columns = element_columns;
+      rows = element_rows;
+      column_step[ 0 ] = (double)( element_points[ 1 ].getX () - element_points[ 0 ].getX () ) / columns;
+      column_step[ 1 ] = (double)( element_points[ 1 ].getY () - element_points[ 0 ].getY () ) / columns;
+      row_step[ 0 ] = (double)( element_points[ 2 ].getX () - element_points[ 0 ].getX () ) / rows;
+      row_step[ 1 ] = (double)( element_points[ 2 ].getY () - element_points[ 0 ].getY () ) / rows;
+   }
+   
+   for ( long int row = 0; row < rows; row++ )
+   {
+      for ( long int column = 0; column < columns; column++ )
+      {
+         OpenCIF::CallCommand* call = new OpenCIF::CallCommand ();
+         call->setID ( id );
+         
+         if ( element_reflection )
+         {
+            OpenCIF::Transformation mirroring;
+            mirroring.setType ( OpenCIF::Transformation::VerticalMirroring );
+            call->addTransformation ( mirroring );
+         }
+         
+         if ( angle != 0.0 )
+         {
+            call->addTransformation ( rotation );
+         }
+         
+         OpenCIF::Transformation displacement;
+         displacement.setType ( OpenCIF::Transformation::Displacement );
+         displacement.setDisplacement ( OpenCIF::Point ( element_points[ 0 ].getX () + (long int)std::floor ( column * column_step[ 0 ] + row * row_step[ 0 ] + 0.5 ) ,
+                                                         element_points[ 0 ].getY () + (long int)std::floor ( column * column_step[ 1 ] + row * row_step[ 1 ] + 0.5 ) ) );
+         call->addTransformation ( displacement );
+         
+         reader_commands.push_back ( call );
+      }
+   }
+   
+   return;
+}
+
+/*
+ * This member function converts a text into a "94 text x y layer" user extension.
+ */
+void OpenCIF::GDSReader::addText ( void )
+{
+   if ( element_points.empty () )
+   {
+      return;
+   }
+   
+   std::map< int , std::string >::const_iterator name = reader_layer_map.find ( element_layer );
+   std::ostringstream oss;
+   
+   // The semicolons would end the command.
+   std::replace ( element_name.begin () , element_name.end () , ';' , '_' );
+   
+   oss << "94 " << element_name << " " << element_points[ 0 ] << " ";
+   
+   if ( name != reader_layer_map.end () )
+   {
+      oss << name->second;
+   }
+   else
+   {
+      oss << "G" << element_layer;
+   }
+   
+   OpenCIF::UserExtensionCommand* extension = new OpenCIF::UserExtensionCommand ();
+   extension->setContent ( oss.str () );
+   reader_commands.push_back ( extension );
+   
+   return;
+}
+
+// FILE: validator.cc
+
+
+/*
+ * Default constructor. Nothing to do (the FSM is built by its own constructor).
+ */
+OpenCIF::Validator::Validator ( void )
+{
+}
+
+/*
+ * Destructor. Nothing to do.
+ */
+OpenCIF::Validator::~Validator ( void )
+{
+}
+
+/*
+ * Member function to reset the FSM to its initial state.
+ */
+void OpenCIF::Validator::reset ( void )
+{
+   validator_fsm.reset ();
+   
+   return;
+}
+
+/*
+ * This member function takes as argument a string that, maybe, is a CIF command,
+ * and validates it with the FSM.
+ * 
+ * A string that only contains blank characters is, according to the FSM, valid.
+ * Such strings are considered invalid, since a technically empty string doesn't
+ * count as a command. In that case, the error offset is the size of the string.
+ * 
+ * The same rules are used by File::isCommandValid.
+ */
+OpenCIF::Validator::Result OpenCIF::Validator::validate ( const std::string& command )
+{
+   Result result;
+   int jump_state = 1; // By default, start in 1
+   bool cif_command_found = false; // Flag to prevent validating strings that are, technically speaking, empty.
+   
+   validator_fsm.reset ();
+   
+   result.valid = true;
+   result.error_offset = -1;
+   
+   // Iterate over the contents of the string, until the string end is
+   // reached or the FSM reports a problem.
+   for ( unsigned long int i = 0; i < command.size (); i++ )
+   {
+      jump_state = validator_fsm[ command[ i ] ];
+      
+      if ( jump_state == -1 )
+      {
+         result.valid = false;
+         result.error_offset = i;
+         break;
+      }
+      
+      if ( jump_state > 1 )
+      {
+         cif_command_found = true;
+      }
+   }
+   
+   // If no command found, is considered invalid
+   if ( result.valid && !cif_command_found )
+   {
+      result.valid = false;
+      result.error_offset = command.size ();
+   }
+   
+   validator_fsm.reset ();
+   
+   return ( result );
+}
+
+/*
+ * This member function validates a list of strings, reusing the same FSM.
+ * The results are stored in the "results" vector, in the same order.
+ */
+void OpenCIF::Validator::validate ( const std::string* commands , const unsigned long int& amount , std::vector< Result >& results )
+{
+   results.resize ( amount );
+   
+   for ( unsigned long int i = 0; i < amount; i++ )
+   {
+      results[ i ] = validate ( commands[ i ] );
+   }
+   
+   return;
+}
+
+/*
+ * This member function validates a list of strings, and returns the results in the same order.
+ */
+std::vector< OpenCIF::Validator::Result > OpenCIF::Validator::validate ( const std::vector< std::string >& commands )
+{
+   std::vector< Result > results;
+   
+   if ( !commands.empty () )
+   {
+      validate ( &commands[ 0 ] , commands.size () , results );
+   }
+   
+   return ( results );
+}
+
+/*
+ * This member function returns true if the string contains a valid command.
+ */
+bool OpenCIF::Validator::isCommandValid ( const std::string& command )
+{
+   return ( validate ( command ).valid );
+}
+
+// FILE: symbolindex.cc
+
+
+/*
+ * Default constructor. The index starts empty.
+ */
+OpenCIF::SymbolIndex::SymbolIndex ( void )
+{
+   index_file_size = 0;
+   index_inside_definition = false;
+}
+
+/*
+ * Destructor. Nothing to do.
+ */
+OpenCIF::SymbolIndex::~SymbolIndex ( void )
+{
+}
+
+/*
+ * Member function to remove every symbol and message of the index.
+ */
+void OpenCIF::SymbolIndex::clear ( void )
+{
+   index_symbols.clear ();
+   index_messages.clear ();
+   index_file_size = 0;
+   index_inside_definition = false;
+   
+   return;
+}
+
+/*
+ * This member function builds the index of a CIF file, reading it only once, in big
+ * blocks. The file isn't validated: the commands are only split (the semicolons inside
+ * comments are skipped) and the ones that matter to the index are cleaned and read.
+ * The contents are validated when a symbol is loaded.
+ */
+bool OpenCIF::SymbolIndex::build ( const std::string& cif_path )
+{
+   std::ifstream input ( cif_path.c_str () , std::ios::in | std::ios::binary );
+   std::vector< char > block ( 1 << 22 );
+   std::string command;
+   unsigned long int position = 0;
+   unsigned long int command_begin = 0;
+   int comment_level = 0;
+   bool inside_command = false;
+   bool finished = false;
+   
+   clear ();
+   
+   if ( !input.is_open () )
+   {
+      index_messages.push_back ( std::string ( "SymbolIndex:build:Error: Can't open input file." ) );
+      
+      return ( false );
+   }
+   
+   input.seekg ( 0 , std::ios::end );
+   index_file_size = input.tellg ();
+   input.seekg ( 0 , std::ios::beg );
+   
+   while ( input && !finished )
+   {
+      input.read ( &block[ 0 ] , block.size () );
+      
+      unsigned long int length = input.gcount ();
+      
+      for ( unsigned long int i = 0; i < length && !finished; i++ )
+      {
+         char input_char = block[ i ];
+         
+         if ( comment_level > 0 )
+         {
+            // The contents of the comments are skipped.
+            if ( input_char == '(' )
+            {
+               comment_level++;
+            }
+            else if ( input_char == ')' )
+            {
+               comment_level--;
+            }
+         }
+         else if ( !inside_command )
+         {
+            // Blank chars (and the semicolons after the comments) are skipped. A command
+            // starts with an uppercase char or a digit.
+            if ( input_char == '(' )
+            {
+               comment_level = 1;
+            }
+            else if ( input_char == 'E' )
+            {
+               finished = true;
+            }
+            else if ( ( input_char >= 'A' && input_char <= 'Z' ) || ( input_char >= '0' && input_char <= '9' ) )
+            {
+               inside_command = true;
+               command_begin = position + i;
+               command = input_char;
+            }
+         }
+         else
+         {
+            command += input_char;
+            
+            if ( input_char == ';' )
+            {
+               indexCommand ( command , command_begin , position + i + 1 );
+               inside_command = false;
+            }
+         }
+      }
+      
+      position += length;
+   }
+   
+   if ( index_inside_definition )
+   {
+      index_messages.push_back ( std::string ( "SymbolIndex:build:Warning: The last definition isn't finished. It was not indexed." ) );
+      index_inside_definition = false;
+   }
+   
+   return ( true );
+}
+
+/*
+ * This member function updates the index with a command. Only the definitions, layers
+ * and calls are cleaned (the primitives are only counted).
+ */
+void OpenCIF::SymbolIndex::indexCommand ( const std::string& command , const unsigned long int& begin , const unsigned long int& end )
+{
+   std::istringstream iss;
+   std::string token;
+   
+   // Outside the definitions, only the start of a new one matters.
+   if ( !index_inside_definition && command[ 0 ] != 'D' )
+   {
+      return;
+   }
+   
+   switch ( command[ 0 ] )
+   {
+      case 'D':
+         iss.str ( OpenCIF::File::cleanCommand ( command ) );
+         iss >> token >> token;
+         
+         if ( token == "S" )
+         {
+            if ( index_inside_definition )
+            {
+               index_messages.push_back ( std::string ( "SymbolIndex:build:Warning: Definition inside another definition. The outer one was not indexed." ) );
+            }
+            
+            index_current = Symbol ();
+            iss >> index_current.id;
+            index_current.begin = begin;
+            index_current.end = end;
+            index_current.boxes = 0;
+            index_current.polygons = 0;
+            index_current.wires = 0;
+            index_current.round_flashes = 0;
+            index_current.calls = 0;
+            index_inside_definition = true;
+         }
+         else if ( token == "F" && index_inside_definition )
+         {
+            index_current.end = end;
+            index_symbols[ index_current.id ] = index_current;
+            index_inside_definition = false;
+         }
+         
+         break;
+         
+      case 'L':
+         iss.str ( OpenCIF::File::cleanCommand ( command ) );
+         iss >> token >> token;
+         index_current.layers.insert ( token );
+         break;
+         
+      case 'C':
+         {
+            unsigned long int callee;
+            
+            iss.str ( OpenCIF::File::cleanCommand ( command ) );
+            iss >> token >> callee;
+            index_current.callees.insert ( callee );
+            index_current.calls++;
+         }
+         
+         break;
+         
+      case 'B':
+         index_current.boxes++;
+         break;
+         
+      case 'P':
+         index_current.polygons++;
+         break;
+         
+      case 'W':
+         index_current.wires++;
+         break;
+         
+      case 'R':
+         index_current.round_flashes++;
+         break;
+         
+      default:
+         break;
+   }
+   
+   return;
+}
+
+/*
+ * This member function saves the index as a text file. The first line identifies the
+ * file and stores the size of the indexed file. Then, there is a line per symbol:
+ * 
+ *      S id begin end boxes polygons wires round_flashes calls N layer... N callee...
+ */
+bool OpenCIF::SymbolIndex::save ( const std::string& index_path ) const
+{
+   std::ofstream output ( index_path.c_str () , std::ios::out | std::ios::binary );
+   
+   if ( !output.is_open () )
+   {
+      return ( false );
+   }
+   
+   output << "LIBOPENCIF-SYMBOL-INDEX 1 " << index_file_size << " " << index_symbols.size () << "\n";
+   
+   for ( std::map< unsigned long int , Symbol >::const_iterator i = index_symbols.begin (); i != index_symbols.end (); i++ )
+   {
+      const Symbol& symbol = i->second;
+      
+      output << "S " << symbol.id << " " << symbol.begin << " " << symbol.end << " "
+             << symbol.boxes << " " << symbol.polygons << " " << symbol.wires << " "
+             << symbol.round_flashes << " " << symbol.calls << " " << symbol.layers.size ();
+      
+      for ( std::set< std::string >::const_iterator j = symbol.layers.begin (); j != symbol.layers.end (); j++ )
+      {
+         output << " " << *j;
+      }
+      
+      output << " " << symbol.callees.size ();
+      
+      for ( std::set< unsigned long int >::const_iterator j = symbol.callees.begin (); j != symbol.callees.end (); j++ )
+      {
+         output << " " << *j;
+      }
+      
+      output << "\n";
+   }
+   
+   return ( output.good () );
+}
+
+/*
+ * This member function loads an index saved with the "save" member function.
+ */
+bool OpenCIF::SymbolIndex::load ( const std::string& index_path )
+{
+   std::ifstream input ( index_path.c_str () , std::ios::in | std::ios::binary );
+   std::string header;
+   unsigned long int version = 0;
+   unsigned long int amount = 0;
+   
+   clear ();
+   
+   if ( !input.is_open () )
+   {
+      index_messages.push_back ( std::string ( "SymbolIndex:load:Error: Can't open index file." ) );
+      
+      return ( false );
+   }
+   
+   input >> header >> version >> index_file_size >> amount;
+   
+   if ( header != "LIBOPENCIF-SYMBOL-INDEX" || version != 1 )
+   {
+      index_messages.push_back ( std::string ( "SymbolIndex:load:Error: The file isn't a symbol index (or its version isn't supported)." ) );
+      clear ();
+      
+      return ( false );
+   }
+   
+   for ( unsigned long int i = 0; i < amount; i++ )
+   {
+      Symbol symbol;
+      std::string tag;
+      unsigned long int size;
+      
+      input >> tag >> symbol.id >> symbol.begin >> symbol.end
+            >> symbol.boxes >> symbol.polygons >> symbol.wires
+            >> symbol.round_flashes >> symbol.calls >> size;
+      
+      for ( unsigned long int j = 0; j < size && input; j++ )
+      {
+         std::string layer;
+         input >> layer;
+         symbol.layers.insert ( layer );
+      }
+      
+      input >> size;
+      
+      for ( unsigned long int j = 0; j < size && input; j++ )
+      {
+         unsigned long int callee;
+         input >> callee;
+         symbol.callees.insert ( callee );
+      }
+      
+      if ( !input || tag != "S" )
+      {
+         index_messages.push_back ( std::string ( "SymbolIndex:load:Error: The index file is damaged." ) );
+         clear ();
+         
+         return ( false );
+      }
+      
+      index_symbols[ symbol.id ] = symbol;
+   }
+   
+   return ( true );
+}
+
+/*
+ * Member function to get the size of the indexed file.
+ */
+unsigned long int OpenCIF::SymbolIndex::getFileSize ( void ) const
+{
+   return ( index_file_size );
+}
+
+/*
+ * Member function to know if a symbol is in the index.
+ */
+bool OpenCIF::SymbolIndex::hasSymbol ( const unsigned long int& id ) const
+{
+   return ( index_symbols.find ( id ) != index_symbols.end () );
+}
+
+/*
+ * Member function to get the information of a symbol. If the symbol isn't in
+ * the index, an empty record is returned.
+ */
+OpenCIF::SymbolIndex::Symbol OpenCIF::SymbolIndex::getSymbol ( const unsigned long int& id ) const
+{
+   std::map< unsigned long int , Symbol >::const_iterator symbol = index_symbols.find ( id );
+   
+   if ( symbol == index_symbols.end () )
+   {
+      Symbol empty = Symbol ();
+      
+      return ( empty );
+   }
+   
+   return ( symbol->second );
+}
+
+/*
+ * Member function to get the ids of every symbol indexed.
+ */
+std::vector< unsigned long int > OpenCIF::SymbolIndex::getSymbolIds ( void ) const
+{
+   std::vector< unsigned long int > ids;
+   
+   for ( std::map< unsigned long int , Symbol >::const_iterator i = index_symbols.begin (); i != index_symbols.end (); i++ )
+   {
+      ids.push_back ( i->first );
+   }
+   
+   return ( ids );
+}
+
+/*
+ * This member function returns the symbols given plus every symbol called by them,
+ * directly or through other symbols. Symbols not indexed are ignored.
+ */
+std::set< unsigned long int > OpenCIF::SymbolIndex::getClosure ( const std::vector< unsigned long int >& ids ) const
+{
+   std::map< unsigned long int , std::set< unsigned long int > > callees;
+   
+   for ( std::map< unsigned long int , Symbol >::const_iterator i = index_symbols.begin (); i != index_symbols.end (); i++ )
+   {
+      callees[ i->first ] = i->second.callees;
+   }
+   
+   return ( computeClosure ( callees , ids ) );
+}
+
+/*
+ * This member function computes the transitive closure of some symbols over a call
+ * graph (the symbols called by every symbol defined). Symbols not defined in the
+ * graph are ignored, as well as the calls to them.
+ */
+std::set< unsigned long int > OpenCIF::SymbolIndex::computeClosure ( const std::map< unsigned long int , std::set< unsigned long int > >& callees ,
+                                                                     const std::vector< unsigned long int >& ids )
+{
+   std::set< unsigned long int > closure;
+   std::vector< unsigned long int > pending;
+   
+   for ( unsigned long int i = 0; i < ids.size (); i++ )
+   {
+      if ( callees.find ( ids[ i ] ) != callees.end () && closure.insert ( ids[ i ] ).second )
+      {
+         pending.push_back ( ids[ i ] );
+      }
+   }
+   
+   while ( !pending.empty () )
+   {
+      const std::set< unsigned long int >& called = callees.find ( pending.back () )->second;
+      
+      pending.pop_back ();
+      
+      for ( std::set< unsigned long int >::const_iterator i = called.begin (); i != called.end (); i++ )
+      {
+         if ( callees.find ( *i ) != callees.end () && closure.insert ( *i ).second )
+         {
+            pending.push_back ( *i );
+         }
+      }
+   }
+   
+   return ( closure );
+}
+
+/*
+ * Member function to get the messages of the last operation.
+ */
+const std::vector< std::string >& OpenCIF::SymbolIndex::getMessages ( void ) const
+{
+   return ( index_messages );
+}
+
+// FILE: cancellationtoken.cc
+
+
+/*
+ * Default constructor. The token starts not cancelled.
+ */
+OpenCIF::CancellationToken::CancellationToken ( void )
+{
+   token_cancelled = false;
+}
+
+/*
+ * Destructor. Nothing to do.
+ */
+OpenCIF::CancellationToken::~CancellationToken ( void )
+{
+}
+
+/*
+ * Member function to request the cancellation. It can be called from any thread.
+ */
+void OpenCIF::CancellationToken::cancel ( void )
+{
+   token_cancelled = true;
+   
+   return;
+}
+
+/*
+ * Member function to reuse the token in another load.
+ */
+void OpenCIF::CancellationToken::reset ( void )
+{
+   token_cancelled = false;
+   
+   return;
+}
+
+/*
+ * Member function to know if the cancellation was requested.
+ */
+bool OpenCIF::CancellationToken::isCancelled ( void ) const
+{
+   return ( token_cancelled );
+}
+
+// FILE: blockqueuebuffer.cc
+
+
+# if __cplusplus >= 201103L
+/*
+ * Constructor. The buffer reads the blocks from the queue given.
+ */
+OpenCIF::BlockQueueBuffer::BlockQueueBuffer ( OpenCIF::SPSCQueue< std::string* >& new_blocks ) : buffer_blocks ( new_blocks )
+{
+   buffer_current = 0;
+   buffer_finished = false;
+}
+
+/*
+ * Destructor. Delete the current block.
+ */
+OpenCIF::BlockQueueBuffer::~BlockQueueBuffer ( void )
+{
+   delete buffer_current;
+}
+
+/*
+ * Member function called by the stream when every char of the current block was
+ * read. It waits for the next block. An empty block is the end of the input.
+ */
+OpenCIF::BlockQueueBuffer::int_type OpenCIF::BlockQueueBuffer::underflow ( void )
+{
+   if ( gptr () < egptr () )
+   {
+      return ( traits_type::to_int_type ( *gptr () ) );
+   }
+   
+   if ( buffer_finished )
+   {
+      return ( traits_type::eof () );
+   }
+   
+   delete buffer_current;
+   buffer_current = 0;
+   
+   buffer_blocks.pop ( buffer_current );
+   
+   if ( buffer_current->empty () )
+   {
+      buffer_finished = true;
+      
+      return ( traits_type::eof () );
+   }
+   
+   char* begin = &( *buffer_current )[ 0 ];
+   
+   setg ( begin , begin , begin + buffer_current->size () );
+   
+   return ( traits_type::to_int_type ( *gptr () ) );
+}
+# endif
+
+// FILE: layerregistry.cc
+
+
+/*
+ * Default constructor. The registry starts empty.
+ */
+OpenCIF::LayerRegistry::LayerRegistry ( void )
+{
+}
+
+/*
+ * Destructor. Nothing to do.
+ */
+OpenCIF::LayerRegistry::~LayerRegistry ( void )
+{
+}
+
+/*
+ * This member function returns the id of a layer name. If the name isn't in the
+ * registry, it is added with the next id.
+ */
+unsigned int OpenCIF::LayerRegistry::intern ( const std::string& name )
+{
+# if __cplusplus >= 201103L
+   std::lock_guard< std::mutex > lock ( registry_mutex );
+# endif
+   
+   std::map< std::string , unsigned int >::const_iterator layer = registry_ids.find ( name );
+   
+   if ( layer != registry_ids.end () )
+   {
+      return ( layer->second );
+   }
+   
+   unsigned int id = registry_names.size ();
+   
+   registry_ids[ name ] = id;
+   registry_names.push_back ( name );
+   
+   return ( id );
+}
+
+/*
+ * This member function looks for a layer name, without adding it. Returns true
+ * (and the id) if it is in the registry.
+ */
+bool OpenCIF::LayerRegistry::find ( const std::string& name , unsigned int& id ) const
+{
+# if __cplusplus >= 201103L
+   std::lock_guard< std::mutex > lock ( registry_mutex );
+# endif
+   
+   std::map< std::string , unsigned int >::const_iterator layer = registry_ids.find ( name );
+   
+   if ( layer == registry_ids.end () )
+   {
+      return ( false );
+   }
+   
+   id = layer->second;
+   
+   return ( true );
+}
+
+/*
+ * Member function to get the name of a layer id. An unknown id has an empty name.
+ */
+std::string OpenCIF::LayerRegistry::getName ( const unsigned int& id ) const
+{
+# if __cplusplus >= 201103L
+   std::lock_guard< std::mutex > lock ( registry_mutex );
+# endif
+   
+   return ( ( id < registry_names.size () ) ? registry_names[ id ] : std::string ( "" ) );
+}
+
+/*
+ * Member function to get every name, ordered by id.
+ */
+std::vector< std::string > OpenCIF::LayerRegistry::getNames ( void ) const
+{
+# if __cplusplus >= 201103L
+   std::lock_guard< std::mutex > lock ( registry_mutex );
+# endif
+   
+   return ( registry_names );
+}
+
+/*
+ * Member function to get the amount of layers registered.
+ */
+unsigned int OpenCIF::LayerRegistry::size ( void ) const
+{
+# if __cplusplus >= 201103L
+   std::lock_guard< std::mutex > lock ( registry_mutex );
+# endif
+   
+   return ( registry_names.size () );
+}
+
+/*
+ * Member function to remove every layer.
+ */
+void OpenCIF::LayerRegistry::clear ( void )
+{
+# if __cplusplus >= 201103L
+   std::lock_guard< std::mutex > lock ( registry_mutex );
+# endif
+   
+   registry_ids.clear ();
+   registry_names.clear ();
+   
+   return;
+}
+
+// FILE: library.cc
+
+
+/*
+ * Default constructor. By default, a thread is used per processor.
+ */
+OpenCIF::Library::Library ( void )
+{
+# if __cplusplus >= 201103L
+   library_thread_amount = std::max ( 1u , std::thread::hardware_concurrency () );
+# else
+   library_thread_amount = 1;
+# endif
+   library_seconds = 0.0;
+}
+
+/*
+ * Destructor. Delete the files loaded.
+ */
+OpenCIF::Library::~Library ( void )
+{
+   clear ();
+}
+
+/*
+ * Member function to add a file to the library. It is loaded by the next call to "load".
+ */
+void OpenCIF::Library::addFile ( const std::string& path )
+{
+   library_paths.push_back ( path );
+   
+   return;
+}
+
+/*
+ * Member function to add every file of a directory that ends with the extension given.
+ * The files are added sorted by name. Only supported in POSIX systems.
+ */
+unsigned long int OpenCIF::Library::addDirectory ( const std::string& directory , const std::string& extension )
+{
+   std::vector< std::string > names;
+   
+# if defined ( __unix__ ) || defined ( __APPLE__ )
+   DIR* input_directory = opendir ( directory.c_str () );
+   
+   if ( input_directory == 0 )
+   {
+      library_messages.push_back ( std::string ( "Library:addDirectory:Error: Can't open the directory \"" ) + directory + std::string ( "\"." ) );
+      
+      return ( 0 );
+   }
+   
+   for ( struct dirent* entry = readdir ( input_directory ); entry != 0; entry = readdir ( input_directory ) )
+   {
+      std::string name ( entry->d_name );
+      
+      if ( name.size () > extension.size () && name.compare ( name.size () - extension.size () , extension.size () , extension ) == 0 )
+      {
+         names.push_back ( name );
+      }
+   }
+   
+   closedir ( input_directory );
+# else
+   library_messages.push_back ( std::string ( "Library:addDirectory:Error: Directories are not supported in this system. Add the files one by one." ) );
+# endif
+   
+   std::sort ( names.begin () , names.end () );
+   
+   for ( unsigned long int i = 0; i < names.size (); i++ )
+   {
+      addFile ( directory + std::string ( "/" ) + names[ i ] );
+   }
+   
+   return ( names.size () );
+}
+
+/*
+ * Member function to remove every file (loaded or not), layer and symbol.
+ */
+void OpenCIF::Library::clear ( void )
+{
+   for ( unsigned long int i = 0; i < library_files.size (); i++ )
+   {
+      delete library_files[ i ];
+   }
+   
+   library_paths.clear ();
+   library_files.clear ();
+   library_statuses.clear ();
+   library_file_layers.clear ();
+   library_symbols.clear ();
+   library_layers.clear ();
+   library_messages.clear ();
+   library_seconds = 0.0;
+   
+   return;
+}
+
+/*
+ * Member function to set the amount of threads used to load the files.
+ */
+void OpenCIF::Library::setThreadAmount ( const unsigned int& thread_amount )
+{
+   library_thread_amount = std::max ( 1u , thread_amount );
+   
+   return;
+}
+
+/*
+ * Member function to get the amount of threads used to load the files.
+ */
+unsigned int OpenCIF::Library::getThreadAmount ( void ) const
+{
+   return ( library_thread_amount );
+}
+
+/*
+ * This member function loads every file of the library. The files are shared by the
+ * threads: every thread takes the next file not loaded, until there are no more.
+ * 
+ * Then, the layers and symbols of every file are registered, in the same order the
+ * files were added (so the ids and the names found don't depend on the threads). The
+ * symbol names defined more than once are reported with a single warning.
+ */
+unsigned long int OpenCIF::Library::load ( const OpenCIF::File::LoadMethod& load_method )
+{
+   unsigned long int loaded = 0;
+   std::vector< std::string > duplicates;
+   
+   for ( unsigned long int i = 0; i < library_files.size (); i++ )
+   {
+      delete library_files[ i ];
+   }
+   
+   library_files.assign ( library_paths.size () , 0 );
+   library_statuses.assign ( library_paths.size () , OpenCIF::File::AllOk );
+   library_file_layers.assign ( library_paths.size () , std::vector< unsigned int > () );
+   library_symbols.clear ();
+   library_layers.clear ();
+   library_messages.clear ();
+   
+   for ( unsigned long int i = 0; i < library_paths.size (); i++ )
+   {
+      library_files[ i ] = new OpenCIF::File ();
+      library_files[ i ]->setPath ( library_paths[ i ] );
+      library_files[ i ]->setExtensionRegistry ( &library_registry ); // Only read by the threads.
+   }
+   
+# if __cplusplus >= 201103L
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+   std::atomic< unsigned long int > next_file ( 0 );
+   std::vector< std::thread > workers;
+   unsigned int thread_amount = std::min ( (unsigned long int)library_thread_amount , (unsigned long int)library_paths.size () );
+   
+   for ( unsigned int t = 0; t < thread_amount; t++ )
+   {
+      workers.push_back ( std::thread ( [ & ] ( void )
+      {
+         unsigned long int file;
+         
+         while ( ( file = next_file++ ) < library_files.size () )
+         {
+            library_statuses[ file ] = library_files[ file ]->loadFile ( load_method );
+         }
+      } ) );
+   }
+   
+   for ( unsigned int t = 0; t < workers.size (); t++ )
+   {
+      workers[ t ].join ();
+   }
+# else
+   clock_t start = clock ();
+   
+   for ( unsigned long int file = 0; file < library_files.size (); file++ )
+   {
+      library_statuses[ file ] = library_files[ file ]->loadFile ( load_method );
+   }
+# endif
+   
+   for ( unsigned long int file = 0; file < library_files.size (); file++ )
+   {
+      if ( library_statuses[ file ] == OpenCIF::File::AllOk )
+      {
+         loaded++;
+      }
+      else
+      {
+         library_messages.push_back ( std::string ( "Library:load:Error: Can't load \"" ) + library_paths[ file ] + std::string ( "\"." ) );
+      }
+      
+      indexFile ( file , duplicates );
+   }
+   
+   if ( !duplicates.empty () )
+   {
+      std::ostringstream oss;
+      
+      oss << "Library:load:Warning: " << duplicates.size () << " symbol name(s) are defined more than once. The first "
+          << "definition is used. The first one is " << duplicates[ 0 ] << ".";
+      library_messages.push_back ( oss.str () );
+   }
+   
+# if __cplusplus >= 201103L
+   library_seconds = std::chrono::duration< double > ( std::chrono::steady_clock::now () - start ).count ();
+# else
+   library_seconds = (double)( clock () - start ) / CLOCKS_PER_SEC; // Processor time, there are no threads.
+# endif
+   
+   return ( loaded );
+}
+
+/*
+ * This member function registers the layers and the symbols of a file. The names are the
+ * ones decoded by the file (with the registry of the library). If a symbol name is already
+ * used, the first one is kept, and the name and both definitions are added to "duplicates".
+ */
+void OpenCIF::Library::indexFile ( const unsigned long int& file , std::vector< std::string >& duplicates )
+{
+   const std::vector< OpenCIF::Command* >& commands = library_files[ file ]->getCommands ();
+   std::set< unsigned int > layers;
+   std::vector< std::pair< std::string , unsigned long int > > symbols;
+   const std::vector< OpenCIF::ExtensionRecord >& extensions = library_files[ file ]->getExtensions ();
+   std::map< unsigned long int , std::string > names;
+   
+   // The first "9 name" extension inside a definition names the symbol.
+   for ( unsigned long int i = 0; i < extensions.size (); i++ )
+   {
+      if ( extensions[ i ].type == OpenCIF::ExtensionRecord::SymbolName && extensions[ i ].symbol != 0 )
+      {
+         names.insert ( std::make_pair ( extensions[ i ].symbol , extensions[ i ].name ) );
+      }
+   }
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      switch ( commands[ i ]->type () )
+      {
+         case OpenCIF::Command::Layer:
+            layers.insert ( library_layers.intern ( static_cast< OpenCIF::LayerCommand* > ( commands[ i ] )->getName () ) );
+            break;
+            
+         case OpenCIF::Command::DefinitionStart:
+            {
+               unsigned long int id = static_cast< OpenCIF::DefinitionStartCommand* > ( commands[ i ] )->getID ();
+               std::map< unsigned long int , std::string >::const_iterator name = names.find ( id );
+               
+               if ( name != names.end () )
+               {
+                  symbols.push_back ( std::make_pair ( name->second , id ) );
+               }
+               else
+               {
+                  std::ostringstream oss;
+                  
+                  oss << library_paths[ file ] << ":" << id;
+                  symbols.push_back ( std::make_pair ( oss.str () , id ) );
+               }
+            }
+            break;
+            
+         default:
+            break;
+      }
+   }
+   
+   library_file_layers[ file ].assign ( layers.begin () , layers.end () );
+   
+   for ( unsigned long int i = 0; i < symbols.size (); i++ )
+   {
+      std::map< std::string , SymbolReference >::const_iterator symbol = library_symbols.find ( symbols[ i ].first );
+      
+      if ( symbol != library_symbols.end () )
+      {
+         std::ostringstream oss;
+         
+         oss << "\"" << symbols[ i ].first << "\" ";
+         
+         if ( symbol->second.file == file )
+         {
+            oss << "(symbols " << symbol->second.id << " and " << symbols[ i ].second << " of \"" << library_paths[ file ] << "\")";
+         }
+         else
+         {
+            oss << "(in \"" << library_paths[ symbol->second.file ] << "\" and \"" << library_paths[ file ] << "\")";
+         }
+         
+         duplicates.push_back ( oss.str () );
+      }
+      else
+      {
+         SymbolReference reference;
+         
+         reference.file = file;
+         reference.id = symbols[ i ].second;
+         library_symbols[ symbols[ i ].first ] = reference;
+      }
+   }
+   
+   return;
+}
+
+/*
+ * Member function to get the amount of files of the library.
+ */
+unsigned long int OpenCIF::Library::getFileAmount ( void ) const
+{
+   return ( library_paths.size () );
+}
+
+/*
+ * Member function to get the path of a file.
+ */
+std::string OpenCIF::Library::getPath ( const unsigned long int& file ) const
+{
+   return ( library_paths.at ( file ) );
+}
+
+/*
+ * Member function to get a file loaded. The file belongs to the library: it is deleted
+ * by the next load (or when the library is destroyed). Before loading, it's null.
+ */
+OpenCIF::File* OpenCIF::Library::getFile ( const unsigned long int& file ) const
+{
+   return ( ( file < library_files.size () ) ? library_files[ file ] : 0 );
+}
+
+/*
+ * Member function to get the result of the load of a file.
+ */
+OpenCIF::File::LoadStatus OpenCIF::Library::getStatus ( const unsigned long int& file ) const
+{
+   return ( library_statuses.at ( file ) );
+}
+
+/*
+ * Member function to get the ids (in the layer registry) of the layers used by a file.
+ */
+std::vector< unsigned int > OpenCIF::Library::getFileLayers ( const unsigned long int& file ) const
+{
+   return ( library_file_layers.at ( file ) );
+}
+
+/*
+ * Member function to get the registry of the layers of every file.
+ */
+const OpenCIF::LayerRegistry& OpenCIF::Library::getLayers ( void ) const
+{
+   return ( library_layers );
+}
+
+/*
+ * Member function to find a symbol by its name. Returns true (and the file and
+ * number of the symbol) if it exists.
+ */
+bool OpenCIF::Library::findSymbol ( const std::string& name , SymbolReference& reference ) const
+{
+   std::map< std::string , SymbolReference >::const_iterator symbol = library_symbols.find ( name );
+   
+   if ( symbol == library_symbols.end () )
+   {
+      return ( false );
+   }
+   
+   reference = symbol->second;
+   
+   return ( true );
+}
+
+/*
+ * Member function to get every symbol of the library, by name.
+ */
+const std::map< std::string , OpenCIF::Library::SymbolReference >& OpenCIF::Library::getSymbols ( void ) const
+{
+   return ( library_symbols );
+}
+
+/*
+ * Member function to get the time needed by the last load, in seconds.
+ */
+double OpenCIF::Library::getLoadSeconds ( void ) const
+{
+   return ( library_seconds );
+}
+
+/*
+ * Member function to get the amount of files loaded per second by the last load.
+ */
+double OpenCIF::Library::getFilesPerSecond ( void ) const
+{
+   return ( ( library_seconds > 0.0 ) ? library_files.size () / library_seconds : 0.0 );
+}
+
+/*
+ * Member function to get the messages of the last load.
+ */
+const std::vector< std::string >& OpenCIF::Library::getMessages ( void ) const
+{
+   return ( library_messages );
+}
+
+// FILE: sharedmodel.cc
+
+
+namespace
+{
+   const char shared_model_magic[ 8 ] = { 'O' , 'C' , 'I' , 'F' , 'M' , 'O' , 'D' , 'L' };
+   
+   /*
+    * This function sorts the symbols of a model by id.
+    */
+   bool symbolLess ( const OpenCIF::SharedModel::Symbol& first , const OpenCIF::SharedModel::Symbol& second )
+   {
+      return ( first.id < second.id );
+   }
+   
+   /*
+    * This function appends an array to the block being built, aligned to 8 bytes, and
+    * returns its offset.
+    */
+   template< typename T >
+   unsigned long int appendArray ( std::string& block , const std::vector< T >& items )
+   {
+      block.resize ( ( block.size () + 7 ) & ~7ul , '\0' );
+      
+      unsigned long int offset = block.size ();
+      
+      if ( !items.empty () )
+      {
+         block.append ( reinterpret_cast< const char* > ( &items[ 0 ] ) , items.size () * sizeof ( T ) );
+      }
+      
+      return ( offset );
+   }
+   
+   /*
+    * This function checks that a range of "count" items from "first" fits a table of
+    * "size" items (without overflowing).
+    */
+   inline bool rangeInside ( const unsigned long int& first , const unsigned long int& count , const unsigned long int& size )
+   {
+      return ( first <= size && count <= size - first );
+   }
+}
+
+/*
+ * Default constructor. Nothing is attached.
+ */
+OpenCIF::SharedModel::SharedModel ( void )
+{
+   model_data = 0;
+   model_size = 0;
+   model_mapped = false;
+}
+
+/*
+ * Destructor. Detach the model (if any).
+ */
+OpenCIF::SharedModel::~SharedModel ( void )
+{
+   detach ();
+}
+
+/*
+ * This member function saves the geometry and symbols of a list of commands. The
+ * comments, extensions (but the symbol names) and definition deletions are not saved.
+ */
+bool OpenCIF::SharedModel::save ( const std::vector< OpenCIF::Command* >& commands , const std::string& path )
+{
+   OpenCIF::LayerRegistry layers;
+   std::vector< String > layer_table;
+   std::vector< Symbol > symbols;
+   std::vector< Element > elements;
+   std::vector< Element > top_elements;
+   std::vector< Coordinate > points;
+   std::vector< Transformation > transformations;
+   std::string strings;
+   std::vector< Element >* target = &top_elements;
+   unsigned long int layer = 0;
+   
+   model_messages.clear ();
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      Element element = Element ();
+      
+      switch ( commands[ i ]->type () )
+      {
+         case OpenCIF::Command::DefinitionStart:
+            {
+               OpenCIF::DefinitionStartCommand* definition = static_cast< OpenCIF::DefinitionStartCommand* > ( commands[ i ] );
+               Symbol symbol = Symbol ();
+               
+               symbol.id = definition->getID ();
+               symbol.numerator = definition->getAB ().getNumerator ();
+               symbol.denominator = definition->getAB ().getDenominator ();
+               symbol.first_element = elements.size ();
+               symbols.push_back ( symbol );
+               target = &elements;
+            }
+            continue;
+            
+         case OpenCIF::Command::DefinitionEnd:
+            if ( !symbols.empty () && target == &elements )
+            {
+               symbols.back ().element_count = elements.size () - symbols.back ().first_element;
+            }
+            
+            target = &top_elements;
+            continue;
+            
+         case OpenCIF::Command::UserExtension:
+            {
+               // A "9 name" extension right after the "DS" command names the symbol.
+               const std::string& content = static_cast< OpenCIF::UserExtensionCommand* > ( commands[ i ] )->getContent ();
+               
+               if ( i > 0 &&
+                    commands[ i - 1 ]->type () == OpenCIF::Command::DefinitionStart &&
+                    content.size () > 2 && content[ 0 ] == '9' && content[ 1 ] == ' ' )
+               {
+                  symbols.back ().name.offset = strings.size ();
+                  symbols.back ().name.length = content.size () - 2;
+                  strings += content.substr ( 2 );
+               }
+            }
+            continue;
+            
+         case OpenCIF::Command::Layer:
+            {
+               const std::string& name = static_cast< OpenCIF::LayerCommand* > ( commands[ i ] )->getName ();
+               
+               layer = layers.intern ( name );
+               
+               if ( layer == layer_table.size () )
+               {
+                  String layer_name;
+                  
+                  layer_name.offset = strings.size ();
+                  layer_name.length = name.size ();
+                  strings += name;
+                  layer_table.push_back ( layer_name );
+               }
+            }
+            continue;
+            
+         case OpenCIF::Command::Box:
+            {
+               OpenCIF::BoxCommand* box = static_cast< OpenCIF::BoxCommand* > ( commands[ i ] );
+               Coordinate center = { box->getPosition ().getX () , box->getPosition ().getY () };
+               
+               element.type = Box;
+               element.values[ 0 ] = box->getSize ().getWidth ();
+               element.values[ 1 ] = box->getSize ().getHeight ();
+               element.values[ 2 ] = box->getRotation ().getX ();
+               element.values[ 3 ] = box->getRotation ().getY ();
+               element.first = points.size ();
+               element.count = 1;
+               points.push_back ( center );
+            }
+            break;
+            
+         case OpenCIF::Command::RoundFlash:
+            {
+               OpenCIF::RoundFlashCommand* flash = static_cast< OpenCIF::RoundFlashCommand* > ( commands[ i ] );
+               Coordinate center = { flash->getPosition ().getX () , flash->getPosition ().getY () };
+               
+               element.type = RoundFlash;
+               element.values[ 0 ] = flash->getDiameter ();
+               element.first = points.size ();
+               element.count = 1;
+               points.push_back ( center );
+            }
+            break;
+            
+         case OpenCIF::Command::Polygon:
+         case OpenCIF::Command::Wire:
+            {
+               const OpenCIF::PointVector& path = static_cast< OpenCIF::PathBasedCommand* > ( commands[ i ] )->getPoints ();
+               
+               if ( commands[ i ]->type () == OpenCIF::Command::Wire )
+               {
+                  element.type = Wire;
+                  element.values[ 0 ] = static_cast< OpenCIF::WireCommand* > ( commands[ i ] )->getWidth ();
+               }
+               else
+               {
+                  element.type = Polygon;
+               }
+               
+               element.first = points.size ();
+               element.count = path.size ();
+               
+               for ( unsigned long int j = 0; j < path.size (); j++ )
+               {
+                  Coordinate point = { path[ j ].getX () , path[ j ].getY () };
+                  points.push_back ( point );
+               }
+            }
+            break;
+            
+         case OpenCIF::Command::Call:
+            {
+               const OpenCIF::CallCommand* call = static_cast< const OpenCIF::CallCommand* > ( commands[ i ] );
+               const std::vector< OpenCIF::Transformation >& list = call->getTransformations ();
+               
+               element.type = Call;
+               element.values[ 0 ] = call->getID ();
+               element.first = transformations.size ();
+               element.count = list.size ();
+               
+               for ( unsigned long int j = 0; j < list.size (); j++ )
+               {
+                  Transformation transformation = Transformation ();
+                  
+                  transformation.type = list[ j ].getType ();
+                  
+                  if ( list[ j ].getType () == OpenCIF::Transformation::Displacement )
+                  {
+                     transformation.x = list[ j ].getDisplacement ().getX ();
+                     transformation.y = list[ j ].getDisplacement ().getY ();
+                  }
+                  else if ( list[ j ].getType () == OpenCIF::Transformation::Rotation )
+                  {
+                     transformation.x = list[ j ].getRotation ().getX ();
+                     transformation.y = list[ j ].getRotation ().getY ();
+                  }
+                  
+                  transformations.push_back ( transformation );
+               }
+            }
+            break;
+            
+         default:
+            continue;
+      }
+      
+      element.layer = layer;
+      target->push_back ( element );
+   }
+   
+   // The elements outside the definitions go after the ones of the definitions.
+   Header header = Header ();
+   std::string block ( sizeof ( Header ) , '\0' );
+   
+   header.top_first_element = elements.size ();
+   header.top_element_count = top_elements.size ();
+   elements.insert ( elements.end () , top_elements.begin () , top_elements.end () );
+   
+   std::sort ( symbols.begin () , symbols.end () , symbolLess );
+   
+   std::copy ( shared_model_magic , shared_model_magic + 8 , header.magic );
+   header.version = 1;
+   header.long_size = sizeof ( long int );
+   header.layers_offset = appendArray ( block , layer_table );
+   header.layer_count = layer_table.size ();
+   header.symbols_offset = appendArray ( block , symbols );
+   header.symbol_count = symbols.size ();
+   header.elements_offset = appendArray ( block , elements );
+   header.element_count = elements.size ();
+   header.points_offset = appendArray ( block , points );
+   header.point_count = points.size ();
+   header.transformations_offset = appendArray ( block , transformations );
+   header.transformation_count = transformations.size ();
+   header.strings_offset = appendArray ( block , std::vector< char > ( strings.begin () , strings.end () ) );
+   header.strings_size = strings.size ();
+   header.total_size = block.size ();
+   
+   block.replace ( 0 , sizeof ( Header ) , reinterpret_cast< const char* > ( &header ) , sizeof ( Header ) );
+   
+   std::ofstream output ( path.c_str () , std::ios::out | std::ios::binary | std::ios::trunc );
+   
+   if ( !output.is_open () )
+   {
+      model_messages.push_back ( std::string ( "SharedModel:save:Error: Can't open the output file." ) );
+      
+      return ( false );
+   }
+   
+   output.write ( block.data () , block.size () );
+   
+   return ( output.good () );
+}
+
+/*
+ * This member function attaches (read only) to a model saved with "save". The
+ * sizes, offsets and alignment of the tables, and the ranges held by every record,
+ * are checked before using them, so the accessors never read outside the model.
+ */
+bool OpenCIF::SharedModel::attach ( const std::string& path )
+{
+   detach ();
+   model_messages.clear ();
+   
+# if defined ( __unix__ ) || defined ( __APPLE__ )
+   int descriptor = open ( path.c_str () , O_RDONLY );
+   struct stat status;
+   
+   if ( descriptor < 0 || fstat ( descriptor , &status ) != 0 )
+   {
+      model_messages.push_back ( std::string ( "SharedModel:attach:Error: Can't open the model." ) );
+      
+      if ( descriptor >= 0 )
+      {
+         close ( descriptor );
+      }
+      
+      return ( false );
+   }
+   
+   model_size = status.st_size;
+   
+   if ( model_size >= sizeof ( Header ) )
+   {
+      void* data = mmap ( 0 , model_size , PROT_READ , MAP_SHARED , descriptor , 0 );
+      
+      if ( data != MAP_FAILED )
+      {
+         model_data = static_cast< const char* > ( data );
+         model_mapped = true;
+      }
+   }
+   
+   close ( descriptor );
+# else
+   std::ifstream input ( path.c_str () , std::ios::in | std::ios::binary );
+   
+   if ( !input.is_open () )
+   {
+      model_messages.push_back ( std::string ( "SharedModel:attach:Error: Can't open the model." ) );
+      
+      return ( false );
+   }
+   
+   input.seekg ( 0 , std::ios::end );
+   model_size = input.tellg ();
+   input.seekg ( 0 , std::ios::beg );
+   
+   if ( model_size >= sizeof ( Header ) )
+   {
+      char* data = new char[ model_size ];
+      
+      input.read ( data , model_size );
+      model_data = data;
+   }
+# endif
+   
+   if ( model_data == 0 )
+   {
+      model_messages.push_back ( std::string ( "SharedModel:attach:Error: The model is too small (or it can't be mapped)." ) );
+      model_size = 0;
+      
+      return ( false );
+   }
+   
+   // Check that every table is inside the model.
+   const Header* header = getHeader ();
+   bool valid = std::equal ( shared_model_magic , shared_model_magic + 8 , header->magic ) &&
+                header->version == 1 &&
+                header->long_size == sizeof ( long int ) &&
+                header->total_size == model_size;
+   
+   valid = valid && header->layers_offset <= model_size && header->layer_count <= ( model_size - header->layers_offset ) / sizeof ( String );
+   valid = valid && header->symbols_offset <= model_size && header->symbol_count <= ( model_size - header->symbols_offset ) / sizeof ( Symbol );
+   valid = valid && header->elements_offset <= model_size && header->element_count <= ( model_size - header->elements_offset ) / sizeof ( Element );
+   valid = valid && header->points_offset <= model_size && header->point_count <= ( model_size - header->points_offset ) / sizeof ( Coordinate );
+   valid = valid && header->transformations_offset <= model_size &&
+                    header->transformation_count <= ( model_size - header->transformations_offset ) / sizeof ( Transformation );
+   valid = valid && header->strings_offset <= model_size && header->strings_size <= model_size - header->strings_offset;
+   valid = valid && rangeInside ( header->top_first_element , header->top_element_count , header->element_count );
+   
+   // The tables hold "long int" values, so they must be aligned as "save" does.
+   valid = valid && header->layers_offset % 8 == 0 && header->symbols_offset % 8 == 0 &&
+                    header->elements_offset % 8 == 0 && header->points_offset % 8 == 0 &&
+                    header->transformations_offset % 8 == 0;
+   
+   // Check that every record points inside its tables.
+   for ( unsigned long int i = 0; valid && i < header->layer_count; i++ )
+   {
+      valid = rangeInside ( getLayers ()[ i ].offset , getLayers ()[ i ].length , header->strings_size );
+   }
+   
+   for ( unsigned long int i = 0; valid && i < header->symbol_count; i++ )
+   {
+      const Symbol& symbol = getSymbols ()[ i ];
+      
+      valid = rangeInside ( symbol.first_element , symbol.element_count , header->element_count ) &&
+              rangeInside ( symbol.name.offset , symbol.name.length , header->strings_size );
+   }
+   
+   for ( unsigned long int i = 0; valid && i < header->element_count; i++ )
+   {
+      const Element& element = getElements ()[ i ];
+      
+      if ( element.type == Call )
+      {
+         valid = rangeInside ( element.first , element.count , header->transformation_count );
+      }
+      else
+      {
+         // Without "L" commands, the elements keep the layer 0.
+         valid = element.type < Call && rangeInside ( element.first , element.count , header->point_count ) &&
+                 ( element.layer < header->layer_count || element.layer == 0 );
+      }
+   }
+   
+   if ( !valid )
+   {
+      model_messages.push_back ( std::string ( "SharedModel:attach:Error: The file isn't a model saved by this system (or it is damaged)." ) );
+      detach ();
+      
+      return ( false );
+   }
+   
+   return ( true );
+}
+
+/*
+ * Member function to release the model attached (if any).
+ */
+void OpenCIF::SharedModel::detach ( void )
+{
+   if ( model_data != 0 )
+   {
+# if defined ( __unix__ ) || defined ( __APPLE__ )
+      if ( model_mapped )
+      {
+         munmap ( const_cast< char* > ( model_data ) , model_size );
+      }
+# else
+      delete [] model_data;
+# endif
+   }
+   
+   model_data = 0;
+   model_size = 0;
+   model_mapped = false;
+   
+   return;
+}
+
+/*
+ * Member function to know if there is a model attached.
+ */
+bool OpenCIF::SharedModel::isAttached ( void ) const
+{
+   return ( model_data != 0 );
+}
+
+/*
+ * Member function to get the header of the model. Null if there is no model attached.
+ */
+const OpenCIF::SharedModel::Header* OpenCIF::SharedModel::getHeader ( void ) const
+{
+   return ( reinterpret_cast< const Header* > ( model_data ) );
+}
+
+/*
+ * Member function to get the table of layer names.
+ */
+const OpenCIF::SharedModel::String* OpenCIF::SharedModel::getLayers ( void ) const
+{
+   return ( ( model_data != 0 ) ? reinterpret_cast< const String* > ( model_data + getHeader ()->layers_offset ) : 0 );
+}
+
+/*
+ * Member function to get the table of symbols, sorted by id.
+ */
+const OpenCIF::SharedModel::Symbol* OpenCIF::SharedModel::getSymbols ( void ) const
+{
+   return ( ( model_data != 0 ) ? reinterpret_cast< const Symbol* > ( model_data + getHeader ()->symbols_offset ) : 0 );
+}
+
+/*
+ * Member function to find a symbol by its id (a binary search over the table).
+ */
+const OpenCIF::SharedModel::Symbol* OpenCIF::SharedModel::findSymbol ( const unsigned long int& id ) const
+{
+   if ( model_data == 0 )
+   {
+      return ( 0 );
+   }
+   
+   const Symbol* begin = getSymbols ();
+   const Symbol* end = begin + getHeader ()->symbol_count;
+   Symbol key = Symbol ();
+   
+   key.id = id;
+   
+   const Symbol* symbol = std::lower_bound ( begin , end , key , symbolLess );
+   
+   return ( ( symbol != end && symbol->id == id ) ? symbol : 0 );
+}
+
+/*
+ * Member function to get the table of elements.
+ */
+const OpenCIF::SharedModel::Element* OpenCIF::SharedModel::getElements ( void ) const
+{
+   return ( ( model_data != 0 ) ? reinterpret_cast< const Element* > ( model_data + getHeader ()->elements_offset ) : 0 );
+}
+
+/*
+ * Member function to get the table of points.
+ */
+const OpenCIF::SharedModel::Coordinate* OpenCIF::SharedModel::getPoints ( void ) const
+{
+   return ( ( model_data != 0 ) ? reinterpret_cast< const Coordinate* > ( model_data + getHeader ()->points_offset ) : 0 );
+}
+
+/*
+ * Member function to get the table of transformations.
+ */
+const OpenCIF::SharedModel::Transformation* OpenCIF::SharedModel::getTransformations ( void ) const
+{
+   return ( ( model_data != 0 ) ? reinterpret_cast< const Transformation* > ( model_data + getHeader ()->transformations_offset ) : 0 );
+}
+
+/*
+ * Member function to copy a string of the model (a layer or symbol name).
+ */
+std::string OpenCIF::SharedModel::getString ( const String& string ) const
+{
+   if ( model_data == 0 || string.offset > getHeader ()->strings_size || string.length > getHeader ()->strings_size - string.offset )
+   {
+      return ( std::string ( "" ) );
+   }
+   
+   return ( std::string ( model_data + getHeader ()->strings_offset + string.offset , string.length ) );
+}
+
+/*
+ * Member function to get the messages of the last operation.
+ */
+const std::vector< std::string >& OpenCIF::SharedModel::getMessages ( void ) const
+{
+   return ( model_messages );
+}
+
+// FILE: commandvariant.cc
+
+
+# if __cplusplus >= 201703L
+namespace
+{
+   /*
+    * This function grows an extent to cover the given rectangle.
+    */
+   void extendExtent ( OpenCIF::Extent& extent , const long int& min_x , const long int& min_y , const long int& max_x , const long int& max_y )
+   {
+      if ( extent.empty )
+      {
+         extent.empty = false;
+         extent.min_x = min_x;
+         extent.min_y = min_y;
+         extent.max_x = max_x;
+         extent.max_y = max_y;
+         
+         return;
+      }
+      
+      extent.min_x = std::min ( extent.min_x , min_x );
+      extent.min_y = std::min ( extent.min_y , min_y );
+      extent.max_x = std::max ( extent.max_x , max_x );
+      extent.max_y = std::max ( extent.max_y , max_y );
+      
+      return;
+   }
+}
+
+/*
+ * This function returns the type of a command stored in a variant. The table follows the
+ * order of the alternatives of OpenCIF::CommandVariant.
+ */
+OpenCIF::Command::CommandType OpenCIF::typeOf ( const OpenCIF::CommandVariant& command )
+{
+   static const Command::CommandType types[] = { Command::Polygon ,
+                                                 Command::Wire ,
+                                                 Command::Box ,
+                                                 Command::RoundFlash ,
+                                                 Command::DefinitionStart ,
+                                                 Command::DefinitionDelete ,
+                                                 Command::Call ,
+                                                 Command::DefinitionEnd ,
+                                                 Command::End ,
+                                                 Command::UserExtension ,
+                                                 Command::Comment ,
+                                                 Command::Layer };
+   
+   static_assert ( sizeof ( types ) / sizeof ( types[ 0 ] ) == std::variant_size< OpenCIF::CommandVariant >::value ,
+                   "The type table must follow the alternatives of CommandVariant" );
+   
+   return ( types[ command.index () ] );
+}
+
+/*
+ * This function returns the command stored in a variant through its base class, so it can be
+ * used with the code written for the pointer representation.
+ */
+OpenCIF::Command& OpenCIF::asCommand ( OpenCIF::CommandVariant& command )
+{
+   return ( std::visit ( [] ( auto& stored ) -> OpenCIF::Command& { return ( stored ); } , command ) );
+}
+
+/*
+ * This function copies a vector of commands into the variant representation.
+ */
+OpenCIF::CommandVariantVector OpenCIF::toVariants ( const std::vector< OpenCIF::Command* >& commands )
+{
+   CommandVariantVector variants;
+   
+   variants.reserve ( commands.size () );
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      switch ( commands[ i ]->type () )
+      {
+         case Command::Polygon:
+            variants.emplace_back ( *static_cast< PolygonCommand* > ( commands[ i ] ) );
+            break;
+            
+         case Command::Wire:
+            variants.emplace_back ( *static_cast< WireCommand* > ( commands[ i ] ) );
+            break;
+            
+         case Command::Box:
+            variants.emplace_back ( *static_cast< BoxCommand* > ( commands[ i ] ) );
+            break;
+            
+         case Command::RoundFlash:
+            variants.emplace_back ( *static_cast< RoundFlashCommand* > ( commands[ i ] ) );
+            break;
+            
+         case Command::DefinitionStart:
+            variants.emplace_back ( *static_cast< DefinitionStartCommand* > ( commands[ i ] ) );
+            break;
+            
+         case Command::DefinitionDelete:
+            variants.emplace_back ( *static_cast< DefinitionDeleteCommand* > ( commands[ i ] ) );
+            break;
+            
+         case Command::Call:
+            variants.emplace_back ( *static_cast< CallCommand* > ( commands[ i ] ) );
+            break;
+            
+         case Command::DefinitionEnd:
+            variants.emplace_back ( *static_cast< DefinitionEndCommand* > ( commands[ i ] ) );
+            break;
+            
+         case Command::End:
+            variants.emplace_back ( *static_cast< EndCommand* > ( commands[ i ] ) );
+            break;
+            
+         case Command::UserExtension:
+            variants.emplace_back ( *static_cast< UserExtensionCommand* > ( commands[ i ] ) );
+            break;
+            
+         case Command::Comment:
+            variants.emplace_back ( *static_cast< CommentCommand* > ( commands[ i ] ) );
+            break;
+            
+         case Command::Layer:
+            variants.emplace_back ( *static_cast< LayerCommand* > ( commands[ i ] ) );
+            break;
+            
+         default:
+            break;
+      }
+   }
+   
+   return ( variants );
+}
+
+/*
+ * This function copies a vector of variants into the pointer representation. The caller
+ * must delete the commands, or hand them to a File.
+ */
+std::vector< OpenCIF::Command* > OpenCIF::toPointers ( const OpenCIF::CommandVariantVector& commands )
+{
+   std::vector< Command* > pointers;
+   
+   pointers.reserve ( commands.size () );
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      pointers.push_back ( std::visit ( [] ( const auto& stored ) -> OpenCIF::Command*
+                                        {
+                                           return ( new std::decay_t< decltype ( stored ) > ( stored ) );
+                                        } , commands[ i ] ) );
+   }
+   
+   return ( pointers );
+}
+
+/*
+ * This function computes the extent of the primitives of a vector of variants. Boxes are
+ * measured with their rotation, wires with half their width around every point.
+ */
+OpenCIF::Extent OpenCIF::computeExtent ( const OpenCIF::CommandVariantVector& commands )
+{
+   Extent extent = { true , 0 , 0 , 0 , 0 };
+   
+   auto visitor = Overloaded
+   {
+      [ &extent ] ( const PolygonCommand& polygon )
+      {
+         const PointVector& points = polygon.getPoints ();
+         
+         for ( unsigned long int i = 0; i < points.size (); i++ )
+         {
+            extendExtent ( extent , points[ i ].getX () , points[ i ].getY () , points[ i ].getX () , points[ i ].getY () );
+         }
+      } ,
+      [ &extent ] ( const WireCommand& wire )
+      {
+         const PointVector& points = wire.getPoints ();
+         long int half_width = static_cast< long int > ( ( wire.getWidth () + 1 ) / 2 );
+         
+         for ( unsigned long int i = 0; i < points.size (); i++ )
+         {
+            extendExtent ( extent ,
+                           points[ i ].getX () - half_width , points[ i ].getY () - half_width ,
+                           points[ i ].getX () + half_width , points[ i ].getY () + half_width );
+         }
+      } ,
+      [ &extent ] ( const BoxCommand& box )
+      {
+         Point center = box.getPosition ();
+         Point rotation = box.getRotation ();
+         double width = box.getSize ().getWidth ();
+         double height = box.getSize ().getHeight ();
+         double length = std::sqrt ( static_cast< double > ( rotation.getX () ) * rotation.getX () +
+                                     static_cast< double > ( rotation.getY () ) * rotation.getY () );
+         double cosine = ( length > 0 ) ? std::fabs ( rotation.getX () / length ) : 1.0;
+         double sine = ( length > 0 ) ? std::fabs ( rotation.getY () / length ) : 0.0;
+         double half_x = ( width * cosine + height * sine ) / 2.0;
+         double half_y = ( width * sine + height * cosine ) / 2.0;
+         
+         extendExtent ( extent ,
+                        static_cast< long int > ( std::floor ( center.getX () - half_x ) ) ,
+                        static_cast< long int > ( std::floor ( center.getY () - half_y ) ) ,
+                        static_cast< long int > ( std::ceil ( center.getX () + half_x ) ) ,
+                        static_cast< long int > ( std::ceil ( center.getY () + half_y ) ) );
+      } ,
+      [ &extent ] ( const RoundFlashCommand& flash )
+      {
+         Point center = flash.getPosition ();
+         long int radius = static_cast< long int > ( ( flash.getDiameter () + 1 ) / 2 );
+         
+         extendExtent ( extent ,
+                        center.getX () - radius , center.getY () - radius ,
+                        center.getX () + radius , center.getY () + radius );
+      } ,
+      [] ( const auto& ) {}
+   };
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      std::visit ( visitor , commands[ i ] );
+   }
+   
+   return ( extent );
+}
+
+/*
+ * This function counts the primitives drawn on every layer. Primitives found before the
+ * first layer command are counted under an empty name.
+ */
+std::map< std::string , unsigned long int > OpenCIF::countPrimitivesPerLayer ( const OpenCIF::CommandVariantVector& commands )
+{
+   std::map< std::string , unsigned long int > counts;
+   unsigned long int* current = &counts[ std::string () ];
+   
+   auto visitor = Overloaded
+   {
+      [ &counts , &current ] ( const LayerCommand& layer ) { current = &counts[ layer.getName () ]; } ,
+      [ &current ] ( const PolygonCommand& ) { ( *current )++; } ,
+      [ &current ] ( const WireCommand& ) { ( *current )++; } ,
+      [ &current ] ( const BoxCommand& ) { ( *current )++; } ,
+      [ &current ] ( const RoundFlashCommand& ) { ( *current )++; } ,
+      [] ( const auto& ) {}
+   };
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      std::visit ( visitor , commands[ i ] );
+   }
+   
+   if ( counts[ std::string () ] == 0 )
+   {
+      counts.erase ( std::string () );
+   }
+   
+   return ( counts );
+}
+# endif
+
+// FILE: geometry.cc
+
+
+/*
+ * Constructor. The tables start empty.
+ */
+OpenCIF::Geometry::Geometry ( void )
+{
+   geometry_is_compact = false;
+}
+
+/*
+ * Destructor. Nothing to do.
+ */
+OpenCIF::Geometry::~Geometry ( void )
+{
+}
+
+/*
+ * Member function to fill a set of tables with the primitives of the commands, following
+ * the layer commands and the definitions that hold them. Returns false at the first value
+ * that does not fit.
+ */
+template< typename Tables >
+bool OpenCIF::Geometry::fill ( Tables& tables , const std::vector< OpenCIF::Command* >& commands )
+{
+   unsigned int layer = 0;
+   bool layer_known = false; // Primitives found before the first layer command go to a layer without name.
+   unsigned long int symbol = 0;
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      if ( commands[ i ]->type () == OpenCIF::Command::DefinitionStart )
+      {
+         symbol = static_cast< OpenCIF::DefinitionStartCommand* > ( commands[ i ] )->getID ();
+         continue;
+      }
+      
+      if ( commands[ i ]->type () == OpenCIF::Command::DefinitionEnd )
+      {
+         symbol = 0;
+         continue;
+      }
+      
+      if ( commands[ i ]->type () == OpenCIF::Command::Layer )
+      {
+         layer = geometry_layers.intern ( static_cast< OpenCIF::LayerCommand* > ( commands[ i ] )->getName () );
+         layer_known = true;
+         continue;
+      }
+      
+      if ( !layer_known && commands[ i ]->type () >= OpenCIF::Command::Polygon && commands[ i ]->type () <= OpenCIF::Command::RoundFlash )
+      {
+         layer = geometry_layers.intern ( std::string () );
+         layer_known = true;
+      }
+      
+      if ( !tables.add ( commands[ i ] , layer , symbol ) )
+      {
+         return ( false );
+      }
+   }
+   
+   return ( true );
+}
+
+/*
+ * Member function to build the tables. With AutomaticCoordinates, the compact tables are
+ * tried first; if a value does not fit, they are dropped and the wide tables are built.
+ */
+bool OpenCIF::Geometry::build ( const std::vector< OpenCIF::Command* >& commands , const CoordinateMode& mode )
+{
+   clear ();
+   
+   if ( mode != WideCoordinates )
+   {
+      if ( fill ( geometry_compact , commands ) )
+      {
+         geometry_is_compact = true;
+         
+         return ( true );
+      }
+      
+      geometry_compact.clear ();
+      
+      if ( mode == CompactCoordinates )
+      {
+         geometry_messages.push_back ( std::string ( "Geometry:build:Error: A value doesn't fit in the compact (32 bits) tables." ) );
+         
+         return ( false );
+      }
+      
+      geometry_messages.push_back ( std::string ( "Geometry:build:Warning: A value doesn't fit in 32 bits. Using the wide tables." ) );
+   }
+   
+   return ( fill ( geometry_wide , commands ) );
+}
+
+/*
+ * Member function to drop the tables, the layers and the messages.
+ */
+void OpenCIF::Geometry::clear ( void )
+{
+   geometry_layers.clear ();
+   geometry_wide.clear ();
+   geometry_compact.clear ();
+   geometry_is_compact = false;
+   geometry_messages.clear ();
+   
+   return;
+}
+
+/*
+ * Member function to tell if the primitives were stored in the compact tables.
+ */
+bool OpenCIF::Geometry::isCompact ( void ) const
+{
+   return ( geometry_is_compact );
+}
+
+/*
+ * Member function to get the wide tables (empty when the compact ones are used).
+ */
+const OpenCIF::Geometry::WideTables& OpenCIF::Geometry::getWideTables ( void ) const
+{
+   return ( geometry_wide );
+}
+
+/*
+ * Member function to get the compact tables (empty when the wide ones are used).
+ */
+const OpenCIF::Geometry::CompactTables& OpenCIF::Geometry::getCompactTables ( void ) const
+{
+   return ( geometry_compact );
+}
+
+/*
+ * Member function to get the names of the layers used by the tables.
+ */
+const OpenCIF::LayerRegistry& OpenCIF::Geometry::getLayers ( void ) const
+{
+   return ( geometry_layers );
+}
+
+/*
+ * Member function to compute the bytes used by the elements of the tables.
+ */
+unsigned long int OpenCIF::Geometry::getMemoryUsage ( void ) const
+{
+   return ( geometry_wide.getMemoryUsage () + geometry_compact.getMemoryUsage () );
+}
+
+/*
+ * Member function to get the messages of the last build.
+ */
+const std::vector< std::string >& OpenCIF::Geometry::getMessages ( void ) const
+{
+   return ( geometry_messages );
+}
+
+// FILE: compressedgeometry.cc
+
+
+namespace
+{
+   enum CompressedKind
+   {
+      CompressedBox = 0 ,    // Box with the neutral rotation (1,0).
+      CompressedRotatedBox ,
+      CompressedFlash ,
+      CompressedPolygon ,
+      CompressedWire
+   };
+   
+   /*
+    * This function appends a value as a variable-length integer: seven bits per byte, the
+    * lowest first, with the high bit set on every byte but the last.
+    */
+   void appendVarint ( std::string& bytes , unsigned long int value )
+   {
+      while ( value >= 0x80 )
+      {
+         bytes += static_cast< char > ( ( value & 0x7F ) | 0x80 );
+         value >>= 7;
+      }
+      
+      bytes += static_cast< char > ( value );
+      
+      return;
+   }
+   
+   /*
+    * This function reads a variable-length integer, advancing the offset.
+    */
+   unsigned long int readVarint ( const std::string& bytes , unsigned long int& offset )
+   {
+      const unsigned char* data = reinterpret_cast< const unsigned char* > ( bytes.data () );
+      unsigned long int value = 0;
+      unsigned int shift = 0;
+      
+      while ( offset < bytes.size () )
+      {
+         unsigned char byte = data[ offset++ ];
+         
+         value |= static_cast< unsigned long int > ( byte & 0x7F ) << shift;
+         
+         if ( ( byte & 0x80 ) == 0 )
+         {
+            break;
+         }
+         
+         shift += 7;
+      }
+      
+      return ( value );
+   }
+   
+   /*
+    * These functions map signed values to unsigned ones, so the small negative differences
+    * also take few bytes: 0, -1, 1, -2... become 0, 1, 2, 3... The arithmetic is done
+    * without sign, so the differences wrap around instead of overflowing.
+    */
+   unsigned long int zigzag ( const unsigned long int& value )
+   {
+      return ( ( value << 1 ) ^ ( ( value >> ( sizeof ( value ) * 8 - 1 ) ) ? ~0ul : 0ul ) );
+   }
+   
+   unsigned long int unzigzag ( const unsigned long int& value )
+   {
+      return ( ( value >> 1 ) ^ ( ( value & 1 ) ? ~0ul : 0ul ) );
+   }
+   
+   /*
+    * This function reads a coordinate stored as a difference with the reference point, and
+    * makes it the new reference.
+    */
+   void readPoint ( const std::string& bytes , unsigned long int& offset , OpenCIF::Point& reference )
+   {
+      unsigned long int x = static_cast< unsigned long int > ( reference.getX () ) + unzigzag ( readVarint ( bytes , offset ) );
+      unsigned long int y = static_cast< unsigned long int > ( reference.getY () ) + unzigzag ( readVarint ( bytes , offset ) );
+      
+      reference.set ( static_cast< long int > ( x ) , static_cast< long int > ( y ) );
+      
+      return;
+   }
+}
+
+/*
+ * Constructor. The store starts empty.
+ */
+OpenCIF::CompressedGeometry::CompressedGeometry ( void )
+{
+   geometry_primitives = 0;
+}
+
+/*
+ * Destructor. Nothing to do.
+ */
+OpenCIF::CompressedGeometry::~CompressedGeometry ( void )
+{
+}
+
+/*
+ * Member function to compress the primitives of the commands, following the layer
+ * commands. The previous contents are dropped.
+ */
+void OpenCIF::CompressedGeometry::build ( const std::vector< OpenCIF::Command* >& commands , const unsigned long int& block_size )
+{
+   unsigned int layer = 0;
+   bool layer_known = false; // Primitives found before the first layer command go to a layer without name.
+   unsigned long int primitives_per_block = ( block_size > 0 ) ? block_size : 1;
+   
+   clear ();
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      switch ( commands[ i ]->type () )
+      {
+         case OpenCIF::Command::Layer:
+            layer = geometry_layers.intern ( static_cast< OpenCIF::LayerCommand* > ( commands[ i ] )->getName () );
+            layer_known = true;
+            break;
+            
+         case OpenCIF::Command::Box:
+         case OpenCIF::Command::RoundFlash:
+         case OpenCIF::Command::Polygon:
+         case OpenCIF::Command::Wire:
+            if ( !layer_known )
+            {
+               layer = geometry_layers.intern ( std::string () );
+               layer_known = true;
+            }
+            
+            if ( geometry_blocks.empty () || geometry_block_sizes.back () == primitives_per_block )
+            {
+               geometry_blocks.push_back ( std::string () );
+               geometry_block_sizes.push_back ( 0 );
+               geometry_reference.set ( 0 , 0 );
+            }
+            
+            encode ( commands[ i ] , layer );
+            geometry_block_sizes.back ()++;
+            geometry_primitives++;
+            break;
+            
+         default:
+            break;
+      }
+   }
+   
+   return;
+}
+
+/*
+ * Member function to append a primitive to the last block. Every primitive starts with a
+ * tag holding its kind (three bits) and its layer.
+ */
+void OpenCIF::CompressedGeometry::encode ( OpenCIF::Command* command , const unsigned int& layer )
+{
+   std::string& bytes = geometry_blocks.back ();
+   unsigned long int tag = static_cast< unsigned long int > ( layer ) << 3;
+   
+   switch ( command->type () )
+   {
+      case OpenCIF::Command::Box:
+         {
+            OpenCIF::BoxCommand* box = static_cast< OpenCIF::BoxCommand* > ( command );
+            OpenCIF::Point direction = box->getRotation ();
+            bool rotated = ( direction.getX () != 1 || direction.getY () != 0 );
+            
+            appendVarint ( bytes , tag | ( rotated ? CompressedRotatedBox : CompressedBox ) );
+            encodePoint ( box->getPosition () );
+            appendVarint ( bytes , box->getSize ().getWidth () );
+            appendVarint ( bytes , box->getSize ().getHeight () );
+            
+            if ( rotated )
+            {
+               appendVarint ( bytes , zigzag ( static_cast< unsigned long int > ( direction.getX () ) ) );
+               appendVarint ( bytes , zigzag ( static_cast< unsigned long int > ( direction.getY () ) ) );
+            }
+         }
+         break;
+         
+      case OpenCIF::Command::RoundFlash:
+         {
+            OpenCIF::RoundFlashCommand* flash = static_cast< OpenCIF::RoundFlashCommand* > ( command );
+            
+            appendVarint ( bytes , tag | CompressedFlash );
+            encodePoint ( flash->getPosition () );
+            appendVarint ( bytes , flash->getDiameter () );
+         }
+         break;
+         
+      case OpenCIF::Command::Polygon:
+      case OpenCIF::Command::Wire:
+         {
+            const OpenCIF::PointVector& points = static_cast< OpenCIF::PathBasedCommand* > ( command )->getPoints ();
+            
+            if ( command->type () == OpenCIF::Command::Wire )
+            {
+               appendVarint ( bytes , tag | CompressedWire );
+               appendVarint ( bytes , static_cast< OpenCIF::WireCommand* > ( command )->getWidth () );
+            }
+            else
+            {
+               appendVarint ( bytes , tag | CompressedPolygon );
+            }
+            
+            appendVarint ( bytes , points.size () );
+            
+            for ( unsigned long int i = 0; i < points.size (); i++ )
+            {
+               encodePoint ( points[ i ] );
+            }
+         }
+         break;
+         
+      default:
+         break;
+   }
+   
+   return;
+}
+
+/*
+ * Member function to append a coordinate as the difference with the reference point, and
+ * make it the new reference.
+ */
+void OpenCIF::CompressedGeometry::encodePoint ( const OpenCIF::Point& point )
+{
+   std::string& bytes = geometry_blocks.back ();
+   
+   appendVarint ( bytes , zigzag ( static_cast< unsigned long int > ( point.getX () ) - static_cast< unsigned long int > ( geometry_reference.getX () ) ) );
+   appendVarint ( bytes , zigzag ( static_cast< unsigned long int > ( point.getY () ) - static_cast< unsigned long int > ( geometry_reference.getY () ) ) );
+   geometry_reference = point;
+   
+   return;
+}
+
+/*
+ * Member function to drop every block and layer.
+ */
+void OpenCIF::CompressedGeometry::clear ( void )
+{
+   std::vector< std::string > ().swap ( geometry_blocks );
+   std::vector< unsigned long int > ().swap ( geometry_block_sizes );
+   geometry_layers.clear ();
+   geometry_reference.set ( 0 , 0 );
+   geometry_primitives = 0;
+   
+   return;
+}
+
+/*
+ * Member function to get an iterator to the first primitive.
+ */
+OpenCIF::CompressedGeometry::Iterator OpenCIF::CompressedGeometry::begin ( void ) const
+{
+   Iterator iterator;
+   
+   iterator.iterator_geometry = this;
+   iterator.decode ();
+   
+   return ( iterator );
+}
+
+/*
+ * Member function to get an iterator past the last primitive.
+ */
+OpenCIF::CompressedGeometry::Iterator OpenCIF::CompressedGeometry::end ( void ) const
+{
+   Iterator iterator;
+   
+   iterator.iterator_geometry = this;
+   iterator.iterator_block = geometry_blocks.size ();
+   
+   return ( iterator );
+}
+
+/*
+ * Member function to get the amount of blocks.
+ */
+unsigned long int OpenCIF::CompressedGeometry::getBlockAmount ( void ) const
+{
+   return ( geometry_blocks.size () );
+}
+
+/*
+ * Member function to decode a whole block, appending its primitives to a vector. The
+ * blocks are independent, so different threads can decode different blocks.
+ */
+void OpenCIF::CompressedGeometry::decodeBlock ( const unsigned long int& block , std::vector< Primitive >& primitives ) const
+{
+   if ( block >= geometry_blocks.size () )
+   {
+      return;
+   }
+   
+   Iterator iterator;
+   
+   iterator.iterator_geometry = this;
+   iterator.iterator_block = block;
+   
+   for ( iterator.decode (); iterator.iterator_block == block; iterator.decode () )
+   {
+      primitives.push_back ( iterator.iterator_primitive );
+   }
+   
+   return;
+}
+
+/*
+ * Member function to get the amount of primitives stored.
+ */
+unsigned long int OpenCIF::CompressedGeometry::getPrimitiveAmount ( void ) const
+{
+   return ( geometry_primitives );
+}
+
+/*
+ * Member function to compute the bytes used by the blocks and their table.
+ */
+unsigned long int OpenCIF::CompressedGeometry::getMemoryUsage ( void ) const
+{
+   unsigned long int bytes = geometry_blocks.size () * ( sizeof ( std::string ) + sizeof ( unsigned long int ) );
+   
+   for ( unsigned long int i = 0; i < geometry_blocks.size (); i++ )
+   {
+      bytes += geometry_blocks[ i ].capacity ();
+   }
+   
+   return ( bytes );
+}
+
+/*
+ * Member function to get the names of the layers used by the primitives.
+ */
+const OpenCIF::LayerRegistry& OpenCIF::CompressedGeometry::getLayers ( void ) const
+{
+   return ( geometry_layers );
+}
+
+/*
+ * Constructor of the iterator. It does not point to any store.
+ */
+OpenCIF::CompressedGeometry::Iterator::Iterator ( void )
+{
+   iterator_geometry = 0;
+   iterator_block = 0;
+   iterator_offset = 0;
+}
+
+/*
+ * Member function to get the current primitive.
+ */
+const OpenCIF::CompressedGeometry::Primitive& OpenCIF::CompressedGeometry::Iterator::operator* ( void ) const
+{
+   return ( iterator_primitive );
+}
+
+/*
+ * Member function to access the members of the current primitive.
+ */
+const OpenCIF::CompressedGeometry::Primitive* OpenCIF::CompressedGeometry::Iterator::operator-> ( void ) const
+{
+   return ( &iterator_primitive );
+}
+
+/*
+ * Member function to move to the next primitive.
+ */
+OpenCIF::CompressedGeometry::Iterator& OpenCIF::CompressedGeometry::Iterator::operator++ ( void )
+{
+   decode ();
+   
+   return ( *this );
+}
+
+/*
+ * Two iterators are equal when they are at the same place of the same store.
+ */
+bool OpenCIF::CompressedGeometry::Iterator::operator== ( const Iterator& other ) const
+{
+   return ( iterator_geometry == other.iterator_geometry && iterator_block == other.iterator_block && iterator_offset == other.iterator_offset );
+}
+
+/*
+ * The opposite of the above.
+ */
+bool OpenCIF::CompressedGeometry::Iterator::operator!= ( const Iterator& other ) const
+{
+   return ( !( *this == other ) );
+}
+
+/*
+ * Member function to decode the primitive that starts at the current offset. When the
+ * block is exhausted, the iterator moves to the next one; after the last block it
+ * becomes equal to "end".
+ */
+void OpenCIF::CompressedGeometry::Iterator::decode ( void )
+{
+   const std::vector< std::string >& blocks = iterator_geometry->geometry_blocks;
+   
+   // The blocks are never empty, so at most one block is skipped.
+   if ( iterator_block < blocks.size () && iterator_offset >= blocks[ iterator_block ].size () )
+   {
+      iterator_block++;
+      iterator_offset = 0;
+      iterator_reference.set ( 0 , 0 );
+   }
+   
+   if ( iterator_block >= blocks.size () )
+   {
+      iterator_block = blocks.size ();
+      iterator_offset = 0;
+      
+      return;
+   }
+   
+   const std::string& bytes = blocks[ iterator_block ];
+   unsigned long int tag = readVarint ( bytes , iterator_offset );
+   Primitive& primitive = iterator_primitive;
+   
+   primitive.layer = static_cast< unsigned int > ( tag >> 3 );
+   primitive.points.clear ();
+   
+   switch ( tag & 7 )
+   {
+      case CompressedBox:
+      case CompressedRotatedBox:
+         primitive.type = BoxPrimitive;
+         readPoint ( bytes , iterator_offset , iterator_reference );
+         primitive.position = iterator_reference;
+         primitive.size.setWidth ( readVarint ( bytes , iterator_offset ) );
+         primitive.size.setHeight ( readVarint ( bytes , iterator_offset ) );
+         primitive.direction.set ( 1 , 0 );
+         
+         if ( ( tag & 7 ) == CompressedRotatedBox )
+         {
+            long int x = static_cast< long int > ( unzigzag ( readVarint ( bytes , iterator_offset ) ) );
+            long int y = static_cast< long int > ( unzigzag ( readVarint ( bytes , iterator_offset ) ) );
+            
+            primitive.direction.set ( x , y );
+         }
+         break;
+         
+      case CompressedFlash:
+         primitive.type = RoundFlashPrimitive;
+         readPoint ( bytes , iterator_offset , iterator_reference );
+         primitive.position = iterator_reference;
+         primitive.width = readVarint ( bytes , iterator_offset );
+         break;
+         
+      default:
+         {
+            primitive.type = ( ( tag & 7 ) == CompressedWire ) ? WirePrimitive : PolygonPrimitive;
+            primitive.width = ( primitive.type == WirePrimitive ) ? readVarint ( bytes , iterator_offset ) : 0;
+            
+            unsigned long int count = readVarint ( bytes , iterator_offset );
+            
+            primitive.points.reserve ( count );
+            
+            for ( unsigned long int i = 0; i < count; i++ )
+            {
+               readPoint ( bytes , iterator_offset , iterator_reference );
+               primitive.points.push_back ( iterator_reference );
+            }
+         }
+         break;
+   }
+   
+   return;
+}
+
+
+// FILE: extensionregistry.cc
+
+
+namespace
+{
+   /*
+    * Decoder of "9 name".
+    */
+   bool decodeSymbolName ( const std::string& content , OpenCIF::ExtensionRecord& record )
+   {
+      std::istringstream input ( content );
+      std::string prefix;
+      
+      if ( !( input >> prefix >> record.name ) )
+      {
+         return ( false );
+      }
+      
+      record.type = OpenCIF::ExtensionRecord::SymbolName;
+      
+      return ( true );
+   }
+   
+   /*
+    * Decoder of "94 name x y [layer]".
+    */
+   bool decodeLabel ( const std::string& content , OpenCIF::ExtensionRecord& record )
+   {
+      std::istringstream input ( content );
+      std::string prefix;
+      long int x;
+      long int y;
+      
+      if ( !( input >> prefix >> record.name >> x >> y ) )
+      {
+         return ( false );
+      }
+      
+      input >> record.layer;
+      
+      record.type = OpenCIF::ExtensionRecord::Label;
+      record.position = OpenCIF::Point ( x , y );
+      
+      return ( true );
+   }
+   
+   /*
+    * Decoder of "4N name x y".
+    */
+   bool decodeNodeLabel ( const std::string& content , OpenCIF::ExtensionRecord& record )
+   {
+      std::istringstream input ( content );
+      std::string prefix;
+      long int x;
+      long int y;
+      
+      if ( !( input >> prefix >> record.name >> x >> y ) )
+      {
+         return ( false );
+      }
+      
+      record.type = OpenCIF::ExtensionRecord::NodeLabel;
+      record.position = OpenCIF::Point ( x , y );
+      
+      return ( true );
+   }
+   
+   /*
+    * Decoder of "4A lower_x lower_y upper_x upper_y".
+    */
+   bool decodeAbutmentBox ( const std::string& content , OpenCIF::ExtensionRecord& record )
+   {
+      std::istringstream input ( content );
+      std::string prefix;
+      long int lower_x;
+      long int lower_y;
+      long int upper_x;
+      long int upper_y;
+      
+      if ( !( input >> prefix >> lower_x >> lower_y >> upper_x >> upper_y ) )
+      {
+         return ( false );
+      }
+      
+      record.type = OpenCIF::ExtensionRecord::AbutmentBox;
+      record.position = OpenCIF::Point ( lower_x , lower_y );
+      record.upper = OpenCIF::Point ( upper_x , upper_y );
+      
+      return ( true );
+   }
+   
+   /*
+    * Decoder of "4X name index x y width net".
+    */
+   bool decodeConnector ( const std::string& content , OpenCIF::ExtensionRecord& record )
+   {
+      std::istringstream input ( content );
+      std::string prefix;
+      long int x;
+      long int y;
+      
+      if ( !( input >> prefix >> record.name >> record.index >> x >> y >> record.width ) )
+      {
+         return ( false );
+      }
+      
+      input >> record.net;
+      
+      record.type = OpenCIF::ExtensionRecord::Connector;
+      record.position = OpenCIF::Point ( x , y );
+      
+      return ( true );
+   }
+   
+   /*
+    * Decoder of "85 name".
+    */
+   bool decodeInstanceName ( const std::string& content , OpenCIF::ExtensionRecord& record )
+   {
+      std::istringstream input ( content );
+      std::string prefix;
+      
+      if ( !( input >> prefix >> record.name ) )
+      {
+         return ( false );
+      }
+      
+      record.type = OpenCIF::ExtensionRecord::InstanceName;
+      
+      return ( true );
+   }
+}
+
+/*
+ * Constructor of the registry, with the decoders of the common extensions.
+ */
+OpenCIF::ExtensionRegistry::ExtensionRegistry ( void )
+{
+   registry_decoders[ "9" ] = decodeSymbolName;
+   registry_decoders[ "94" ] = decodeLabel;
+   registry_decoders[ "4N" ] = decodeNodeLabel;
+   registry_decoders[ "4A" ] = decodeAbutmentBox;
+   registry_decoders[ "4X" ] = decodeConnector;
+   registry_decoders[ "85" ] = decodeInstanceName;
+   
+   // Alliance writes these ones in comments.
+   registry_comment_prefixes.insert ( "4N" );
+   registry_comment_prefixes.insert ( "4A" );
+   registry_comment_prefixes.insert ( "4X" );
+   
+   return;
+}
+
+/*
+ * Destructor (virtual) of the registry.
+ */
+OpenCIF::ExtensionRegistry::~ExtensionRegistry ( void )
+{
+   return;
+}
+
+/*
+ * Member function to add the decoder of the extensions whose first word is the prefix. If
+ * "in_comments" is true, the comments that start with the prefix are decoded too.
+ */
+void OpenCIF::ExtensionRegistry::add ( const std::string& prefix , Decoder decoder , const bool& in_comments )
+{
+   registry_decoders[ prefix ] = decoder;
+   
+   if ( in_comments )
+   {
+      registry_comment_prefixes.insert ( prefix );
+   }
+   else
+   {
+      registry_comment_prefixes.erase ( prefix );
+   }
+   
+   return;
+}
+
+/*
+ * Member function to remove the decoder of a prefix.
+ */
+void OpenCIF::ExtensionRegistry::remove ( const std::string& prefix )
+{
+   registry_decoders.erase ( prefix );
+   registry_comment_prefixes.erase ( prefix );
+   
+   return;
+}
+
+/*
+ * Member function to remove all the decoders.
+ */
+void OpenCIF::ExtensionRegistry::clear ( void )
+{
+   registry_decoders.clear ();
+   registry_comment_prefixes.clear ();
+   
+   return;
+}
+
+/*
+ * Member function to decode an extension (the content of the command, without the semicolon).
+ * It returns false if no decoder has its first word, or if the decoder rejects it.
+ */
+bool OpenCIF::ExtensionRegistry::decode ( const std::string& content , OpenCIF::ExtensionRecord& record ) const
+{
+   std::string::size_type end = content.find_first_of ( " \t\n\r" );
+   std::map< std::string , Decoder >::const_iterator found = registry_decoders.find ( content.substr ( 0 , end ) );
+   
+   if ( found == registry_decoders.end () || found->second == 0 )
+   {
+      return ( false );
+   }
+   
+   return ( found->second ( content , record ) );
+}
+
+/*
+ * Member function to decode a user extension, or a comment that holds one. Some writers,
+ * like Alliance, put their extensions in comments: "(4A 0 0 900 1000);". The parentheses
+ * and the blanks around the text are skipped, and the comment is only decoded if its first
+ * word is a prefix added as found in comments. Other commands are never decoded.
+ */
+bool OpenCIF::ExtensionRegistry::decode ( OpenCIF::Command* command , OpenCIF::ExtensionRecord& record ) const
+{
+   if ( command->type () == OpenCIF::Command::UserExtension )
+   {
+      return ( decode ( static_cast< OpenCIF::UserExtensionCommand* > ( command )->getContent () , record ) );
+   }
+   
+   if ( command->type () != OpenCIF::Command::Comment )
+   {
+      return ( false );
+   }
+   
+   const std::string& content = static_cast< OpenCIF::CommentCommand* > ( command )->getContent ();
+   std::string::size_type begin = content.find_first_not_of ( " \t\n\r(" );
+   std::string::size_type end = content.find_last_not_of ( " \t\n\r)" );
+   
+   if ( begin == std::string::npos || end < begin )
+   {
+      return ( false );
+   }
+   
+   std::string text = content.substr ( begin , end - begin + 1 );
+   
+   if ( registry_comment_prefixes.find ( text.substr ( 0 , text.find_first_of ( " \t\n\r" ) ) ) == registry_comment_prefixes.end () )
+   {
+      return ( false );
+   }
+   
+   return ( decode ( text , record ) );
+}
+
+
+// FILE: labelindex.cc
+
+
+namespace
+{
+   /*
+    * Orders the labels by symbol and layer, to group them.
+    */
+   bool labelTreeLess ( const OpenCIF::LabelIndex::Label& first , const OpenCIF::LabelIndex::Label& second )
+   {
+      if ( first.symbol != second.symbol )
+      {
+         return ( first.symbol < second.symbol );
+      }
+      
+      return ( first.layer < second.layer );
+   }
+   
+   /*
+    * Orders the labels by X, and by Y.
+    */
+   bool labelXLess ( const OpenCIF::LabelIndex::Label& first , const OpenCIF::LabelIndex::Label& second )
+   {
+      return ( first.position.getX () < second.position.getX () );
+   }
+   
+   bool labelYLess ( const OpenCIF::LabelIndex::Label& first , const OpenCIF::LabelIndex::Label& second )
+   {
+      return ( first.position.getY () < second.position.getY () );
+   }
+}
+
+/*
+ * Constructor of the index. It starts empty.
+ */
+OpenCIF::LabelIndex::LabelIndex ( void )
+{
+   return;
+}
+
+/*
+ * Destructor (virtual) of the index.
+ */
+OpenCIF::LabelIndex::~LabelIndex ( void )
+{
+   return;
+}
+
+/*
+ * Member function to build the index with the labels, nodes and connectors of a list of
+ * decoded extensions. The other records are ignored.
+ */
+void OpenCIF::LabelIndex::build ( const std::vector< OpenCIF::ExtensionRecord >& records )
+{
+   clear ();
+   
+   Label label;
+   
+   for ( unsigned long int i = 0; i < records.size (); i++ )
+   {
+      if ( records[ i ].type != OpenCIF::ExtensionRecord::Label &&
+           records[ i ].type != OpenCIF::ExtensionRecord::NodeLabel &&
+           records[ i ].type != OpenCIF::ExtensionRecord::Connector )
+      {
+         continue;
+      }
+      
+      label.name = records[ i ].name;
+      label.position = records[ i ].position;
+      label.layer = index_layers.intern ( records[ i ].layer );
+      label.type = records[ i ].type;
+      label.symbol = records[ i ].symbol;
+      label.command = records[ i ].command;
+      
+      index_labels.push_back ( label );
+   }
+   
+   std::stable_sort ( index_labels.begin () , index_labels.end () , labelTreeLess );
+   
+   // Every run of labels with the same symbol and layer is a tree.
+   unsigned long int begin = 0;
+   
+   for ( unsigned long int i = 1; i <= index_labels.size (); i++ )
+   {
+      if ( i == index_labels.size () || labelTreeLess ( index_labels[ begin ] , index_labels[ i ] ) )
+      {
+         index_trees[ std::make_pair ( index_labels[ begin ].symbol , index_labels[ begin ].layer ) ] = std::make_pair ( begin , i );
+         arrange ( begin , i , true );
+         begin = i;
+      }
+   }
+   
+   return;
+}
+
+/*
+ * Member function to build the index from a list of commands (like File::getCommands),
+ * decoding its user extensions with the registry.
+ */
+void OpenCIF::LabelIndex::build ( const std::vector< OpenCIF::Command* >& commands , const OpenCIF::ExtensionRegistry& registry )
+{
+   std::vector< OpenCIF::ExtensionRecord > records;
+   OpenCIF::ExtensionRecord record;
+   unsigned long int current_symbol = 0;
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      switch ( commands[ i ]->type () )
+      {
+         case OpenCIF::Command::DefinitionStart:
+            current_symbol = static_cast< OpenCIF::DefinitionStartCommand* > ( commands[ i ] )->getID ();
+            break;
+            
+         case OpenCIF::Command::DefinitionEnd:
+            current_symbol = 0;
+            break;
+            
+         case OpenCIF::Command::UserExtension:
+         case OpenCIF::Command::Comment:
+            record = OpenCIF::ExtensionRecord ();
+            
+            if ( registry.decode ( commands[ i ] , record ) )
+            {
+               record.symbol = current_symbol;
+               record.command = i;
+               records.push_back ( record );
+            }
+            break;
+            
+         default:
+            break;
+      }
+   }
+   
+   build ( records );
+   
+   return;
+}
+
+/*
+ * Member function to empty the index.
+ */
+void OpenCIF::LabelIndex::clear ( void )
+{
+   index_labels.clear ();
+   index_trees.clear ();
+   index_layers.clear ();
+   
+   return;
+}
+
+/*
+ * Member function to append the labels of a layer of a symbol inside a window (borders
+ * included). The window is in the frame of the symbol.
+ */
+void OpenCIF::LabelIndex::findInWindow ( const unsigned long int& symbol , const unsigned int& layer ,
+                                         const OpenCIF::Point& lower , const OpenCIF::Point& upper ,
+                                         std::vector< const Label* >& found ) const
+{
+   std::map< std::pair< unsigned long int , unsigned int > , std::pair< unsigned long int , unsigned long int > >::const_iterator tree;
+   
+   tree = index_trees.find ( std::make_pair ( symbol , layer ) );
+   
+   if ( tree == index_trees.end () )
+   {
+      return;
+   }
+   
+   searchWindow ( tree->second.first , tree->second.second , true , lower , upper , found );
+   
+   return;
+}
+
+/*
+ * Member function to find the label of a layer of a symbol nearest to a point (in the frame
+ * of the symbol). It returns null if the symbol has no labels in the layer.
+ */
+const OpenCIF::LabelIndex::Label* OpenCIF::LabelIndex::findNearest ( const unsigned long int& symbol , const unsigned int& layer ,
+                                                                     const OpenCIF::Point& point ) const
+{
+   std::map< std::pair< unsigned long int , unsigned int > , std::pair< unsigned long int , unsigned long int > >::const_iterator tree;
+   const Label* nearest = 0;
+   double distance = 0;
+   
+   tree = index_trees.find ( std::make_pair ( symbol , layer ) );
+   
+   if ( tree != index_trees.end () )
+   {
+      searchNearest ( tree->second.first , tree->second.second , true , point , nearest , distance );
+   }
+   
+   return ( nearest );
+}
+
+/*
+ * Member function to get the labels, grouped by symbol and layer, in the order of the trees.
+ */
+const std::vector< OpenCIF::LabelIndex::Label >& OpenCIF::LabelIndex::getLabels ( void ) const
+{
+   return ( index_labels );
+}
+
+/*
+ * Member function to get the amount of labels indexed.
+ */
+unsigned long int OpenCIF::LabelIndex::getLabelAmount ( void ) const
+{
+   return ( index_labels.size () );
+}
+
+/*
+ * Member function to get the layers of the labels.
+ */
+const OpenCIF::LayerRegistry& OpenCIF::LabelIndex::getLayers ( void ) const
+{
+   return ( index_layers );
+}
+
+/*
+ * Private member function to arrange a range of labels as a k-d tree: the label in the
+ * middle splits the range by the axis, and the halves are arranged by the other axis.
+ */
+void OpenCIF::LabelIndex::arrange ( const unsigned long int& begin , const unsigned long int& end , const bool& by_x )
+{
+   if ( end - begin < 2 )
+   {
+      return;
+   }
+   
+   unsigned long int middle = begin + ( end - begin ) / 2;
+   
+   std::nth_element ( index_labels.begin () + begin , index_labels.begin () + middle , index_labels.begin () + end ,
+                      by_x ? labelXLess : labelYLess );
+   
+   arrange ( begin , middle , !by_x );
+   arrange ( middle + 1 , end , !by_x );
+   
+   return;
+}
+
+/*
+ * Private member function to search a window in a range arranged as a k-d tree. The halves
+ * that can't touch the window are skipped.
+ */
+void OpenCIF::LabelIndex::searchWindow ( const unsigned long int& begin , const unsigned long int& end , const bool& by_x ,
+                                         const OpenCIF::Point& lower , const OpenCIF::Point& upper ,
+                                         std::vector< const Label* >& found ) const
+{
+   if ( begin >= end )
+   {
+      return;
+   }
+   
+   unsigned long int middle = begin + ( end - begin ) / 2;
+   const OpenCIF::Point& position = index_labels[ middle ].position;
+   long int split = by_x ? position.getX () : position.getY ();
+   long int low = by_x ? lower.getX () : lower.getY ();
+   long int high = by_x ? upper.getX () : upper.getY ();
+   
+   if ( position.getX () >= lower.getX () && position.getX () <= upper.getX () &&
+        position.getY () >= lower.getY () && position.getY () <= upper.getY () )
+   {
+      found.push_back ( &index_labels[ middle ] );
+   }
+   
+   if ( low <= split )
+   {
+      searchWindow ( begin , middle , !by_x , lower , upper , found );
+   }
+   
+   if ( high >= split )
+   {
+      searchWindow ( middle + 1 , end , !by_x , lower , upper , found );
+   }
+   
+   return;
+}
+
+/*
+ * Private member function to search the nearest label in a range arranged as a k-d tree.
+ * The half at the side of the point is searched first, and the other one only if it can
+ * hold a nearer label. The distances are squared (in double, to avoid overflows).
+ */
+void OpenCIF::LabelIndex::searchNearest ( const unsigned long int& begin , const unsigned long int& end , const bool& by_x ,
+                                          const OpenCIF::Point& point , const Label*& nearest , double& distance ) const
+{
+   if ( begin >= end )
+   {
+      return;
+   }
+   
+   unsigned long int middle = begin + ( end - begin ) / 2;
+   const OpenCIF::Point& position = index_labels[ middle ].position;
+   double delta_x = static_cast< double > ( position.getX () ) - static_cast< double > ( point.getX () );
+   double delta_y = static_cast< double > ( position.getY () ) - static_cast< double > ( point.getY () );
+   double current = delta_x * delta_x + delta_y * delta_y;
+   
+   if ( nearest == 0 || current < distance )
+   {
+      nearest = &index_labels[ middle ];
+      distance = current;
+   }
+   
+   double gap = by_x ? -delta_x : -delta_y; // Distance from the split to the point, along the axis.
+   
+   if ( gap < 0 )
+   {
+      searchNearest ( begin , middle , !by_x , point , nearest , distance );
+      
+      if ( gap * gap < distance )
+      {
+         searchNearest ( middle + 1 , end , !by_x , point , nearest , distance );
+      }
+   }
+   else
+   {
+      searchNearest ( middle + 1 , end , !by_x , point , nearest , distance );
+      
+      if ( gap * gap < distance )
+      {
+         searchNearest ( begin , middle , !by_x , point , nearest , distance );
+      }
+   }
+   
+   return;
+}
+
+
+// FILE: scale.cc
+
+
+namespace
+{
+   /*
+    * Divides rounding to the nearest integer (halves away from zero). Returns false if the
+    * division is not exact. With a constant divisor the compiler avoids the division.
+    */
+   inline bool divideRounded ( const long int& dividend , const long int& divisor , long int& quotient )
+   {
+      long int remainder = dividend % divisor;
+      
+      quotient = dividend / divisor;
+      
+      if ( remainder == 0 )
+      {
+         return ( true );
+      }
+      
+      if ( 2 * ( ( remainder < 0 ) ? -remainder : remainder ) >= divisor )
+      {
+         quotient += ( dividend < 0 ) ? -1 : 1;
+      }
+      
+      return ( false );
+   }
+   
+   /*
+    * The kernels of the kinds of scale. Each one scales a single value.
+    */
+   struct MultiplicationKernel
+   {
+      long int numerator;
+      
+      bool operator() ( long int& value ) const
+      {
+         value *= numerator;
+         
+         return ( true );
+      }
+   };
+   
+   template< long int Divisor >
+   struct PowerOfTenKernel
+   {
+      long int numerator;
+      
+      bool operator() ( long int& value ) const
+      {
+         return ( divideRounded ( value * numerator , Divisor , value ) );
+      }
+   };
+   
+   struct RationalKernel
+   {
+      long int numerator;
+      long int denominator;
+      
+      bool operator() ( long int& value ) const
+      {
+         return ( divideRounded ( value * numerator , denominator , value ) );
+      }
+   };
+   
+   /*
+    * Scales the coordinates of a list of points with a kernel. Returns false if any of them
+    * was rounded.
+    */
+   template< typename Kernel >
+   bool scalePoints ( OpenCIF::Point* points , const unsigned long int& amount , const Kernel& kernel )
+   {
+      bool exact = true;
+      long int x;
+      long int y;
+      
+      for ( unsigned long int i = 0; i < amount; i++ )
+      {
+         x = points[ i ].getX ();
+         y = points[ i ].getY ();
+         
+         if ( !kernel ( x ) )
+         {
+            exact = false;
+         }
+         
+         if ( !kernel ( y ) )
+         {
+            exact = false;
+         }
+         
+         points[ i ].set ( x , y );
+      }
+      
+      return ( exact );
+   }
+   
+   /*
+    * Greatest common divisor, to reduce the fractions.
+    */
+   unsigned long int greatestCommonDivisor ( unsigned long int first , unsigned long int second )
+   {
+      while ( second != 0 )
+      {
+         unsigned long int rest = first % second;
+         
+         first = second;
+         second = rest;
+      }
+      
+      return ( first );
+   }
+}
+
+/*
+ * Default constructor. The scale is 1/1.
+ */
+OpenCIF::Scale::Scale ( void )
+{
+   set ( 1 , 1 );
+}
+
+/*
+ * Constructor from the A/B of a definition.
+ */
+OpenCIF::Scale::Scale ( const OpenCIF::Fraction& ab )
+{
+   set ( ab.getNumerator () , ab.getDenominator () );
+}
+
+/*
+ * Constructor from a numerator and a denominator.
+ */
+OpenCIF::Scale::Scale ( const unsigned long int& numerator , const unsigned long int& denominator )
+{
+   set ( numerator , denominator );
+}
+
+/*
+ * Destructor. Nothing to do.
+ */
+OpenCIF::Scale::~Scale ( void )
+{
+}
+
+/*
+ * Member function to set the fraction. It is reduced, and its kind is found.
+ */
+void OpenCIF::Scale::set ( const unsigned long int& numerator , const unsigned long int& denominator )
+{
+   scale_numerator = numerator;
+   scale_denominator = denominator;
+   scale_power = 0;
+   
+   if ( scale_denominator == 0 )
+   {
+      scale_numerator = 1;
+      scale_denominator = 1;
+   }
+   
+   unsigned long int divisor = greatestCommonDivisor ( scale_numerator , scale_denominator );
+   
+   scale_numerator /= divisor;
+   scale_denominator /= divisor;
+   
+   if ( scale_denominator == 1 )
+   {
+      scale_kind = ( scale_numerator == 1 ) ? Identity : Multiplication;
+      
+      return;
+   }
+   
+   scale_kind = Rational;
+   
+   unsigned long int power = 1;
+   
+   for ( unsigned int k = 1; k <= 6; k++ )
+   {
+      power *= 10;
+      
+      if ( scale_denominator == power )
+      {
+         scale_kind = PowerOfTen;
+         scale_power = k;
+         break;
+      }
+   }
+   
+   return;
+}
+
+/*
+ * Member function to get the kind of the scale.
+ */
+OpenCIF::Scale::ScaleKind OpenCIF::Scale::getKind ( void ) const
+{
+   return ( scale_kind );
+}
+
+/*
+ * Member function to get the reduced numerator.
+ */
+unsigned long int OpenCIF::Scale::getNumerator ( void ) const
+{
+   return ( scale_numerator );
+}
+
+/*
+ * Member function to get the reduced denominator.
+ */
+unsigned long int OpenCIF::Scale::getDenominator ( void ) const
+{
+   return ( scale_denominator );
+}
+
+/*
+ * Member function to scale a single value. Returns false if it was rounded.
+ */
+bool OpenCIF::Scale::apply ( long int& value ) const
+{
+   OpenCIF::Point point ( value , 0 );
+   bool exact = apply ( &point , 1 );
+   
+   value = point.getX ();
+   
+   return ( exact );
+}
+
+/*
+ * Member function to scale a point. Returns false if it was rounded.
+ */
+bool OpenCIF::Scale::apply ( OpenCIF::Point& point ) const
+{
+   return ( apply ( &point , 1 ) );
+}
+
+/*
+ * Member function to scale a list of points, choosing the kernel once for all of them.
+ * Returns false if any of them was rounded.
+ */
+bool OpenCIF::Scale::apply ( OpenCIF::Point* points , const unsigned long int& amount ) const
+{
+   long int numerator = static_cast< long int > ( scale_numerator );
+   
+   switch ( scale_kind )
+   {
+      case Identity:
+         return ( true );
+         
+      case Multiplication:
+         {
+            MultiplicationKernel kernel = { numerator };
+            return ( scalePoints ( points , amount , kernel ) );
+         }
+         
+      case PowerOfTen:
+         switch ( scale_power )
+         {
+            case 1:
+               {
+                  PowerOfTenKernel< 10L > kernel = { numerator };
+                  return ( scalePoints ( points , amount , kernel ) );
+               }
+               
+            case 2:
+               {
+                  PowerOfTenKernel< 100L > kernel = { numerator };
+                  return ( scalePoints ( points , amount , kernel ) );
+               }
+               
+            case 3:
+               {
+                  PowerOfTenKernel< 1000L > kernel = { numerator };
+                  return ( scalePoints ( points , amount , kernel ) );
+               }
+               
+            case 4:
+               {
+                  PowerOfTenKernel< 10000L > kernel = { numerator };
+                  return ( scalePoints ( points , amount , kernel ) );
+               }
+               
+            case 5:
+               {
+                  PowerOfTenKernel< 100000L > kernel = { numerator };
+                  return ( scalePoints ( points , amount , kernel ) );
+               }
+               
+            default:
+               {
+                  PowerOfTenKernel< 1000000L > kernel = { numerator };
+                  return ( scalePoints ( points , amount , kernel ) );
+               }
+         }
+         
+      default:
+         {
+            RationalKernel kernel = { numerator , static_cast< long int > ( scale_denominator ) };
+            return ( scalePoints ( points , amount , kernel ) );
+         }
+   }
+}
+
+/*
+ * Member function to scale a length (a width, a diameter, a side). Returns false if it
+ * was rounded.
+ */
+bool OpenCIF::Scale::applyLength ( unsigned long int& length ) const
+{
+   long int value = static_cast< long int > ( length );
+   bool exact = apply ( value );
+   
+   length = static_cast< unsigned long int > ( value );
+   
+   return ( exact );
+}
+
+// FILE: flattener.cc
+
+
+/*
+ * Constructor. Nothing flattened yet.
+ */
+OpenCIF::Flattener::Flattener ( void )
+{
+   flattener_commands = 0;
+   flattener_output = 0;
+   flattener_has_output_layer = false;
+   flattener_errors = false;
+   flattener_losses = 0;
+}
+
+/*
+ * Destructor. The output belongs to the caller.
+ */
+OpenCIF::Flattener::~Flattener ( void )
+{
+}
+
+/*
+ * Member function to flatten a list of commands, appending the primitives (and layer
+ * commands) to the output. The definitions are taken in order, as they are found, so a
+ * symbol can be redefined after a "DD". Returns false if there were errors (recursive
+ * calls, unfinished definitions); the output keeps what could be flattened.
+ */
+bool OpenCIF::Flattener::flatten ( const std::vector< OpenCIF::Command* >& commands , std::vector< OpenCIF::Command* >& primitives )
+{
+   flattener_commands = &commands;
+   flattener_output = &primitives;
+   flattener_symbols.clear ();
+   flattener_levels.clear ();
+   flattener_active.clear ();
+   flattener_layer.clear ();
+   flattener_output_layer.clear ();
+   flattener_has_output_layer = false;
+   flattener_errors = false;
+   flattener_losses = 0;
+   flattener_messages.clear ();
+   
+   Symbol symbol;
+   unsigned long int symbol_id = 0;
+   bool inside = false;
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      switch ( commands[ i ]->type () )
+      {
+         case OpenCIF::Command::DefinitionStart:
+            {
+               OpenCIF::DefinitionStartCommand* definition = static_cast< OpenCIF::DefinitionStartCommand* > ( commands[ i ] );
+               
+               symbol_id = definition->getID ();
+               symbol.begin = i + 1;
+               symbol.scale = OpenCIF::Scale ( definition->getAB () );
+               inside = true;
+            }
+            break;
+            
+         case OpenCIF::Command::DefinitionEnd:
+            if ( inside )
+            {
+               symbol.end = i;
+               flattener_symbols[ symbol_id ] = symbol;
+               inside = false;
+            }
+            break;
+            
+         case OpenCIF::Command::DefinitionDelete:
+            if ( !inside )
+            {
+               // "DD n" deletes the symbols from n on.
+               flattener_symbols.erase ( flattener_symbols.lower_bound ( static_cast< OpenCIF::DefinitionDeleteCommand* > ( commands[ i ] )->getID () ) ,
+                                         flattener_symbols.end () );
+            }
+            break;
+            
+         default:
+            if ( !inside )
+            {
+               process ( commands[ i ] );
+            }
+            break;
+      }
+   }
+   
+   if ( inside )
+   {
+      std::ostringstream oss;
+      oss << "Flattener:flatten:Error: The definition of the symbol " << symbol_id << " has no end.";
+      flattener_messages.push_back ( oss.str () );
+      flattener_errors = true;
+   }
+   
+   if ( flattener_losses > 0 )
+   {
+      std::ostringstream oss;
+      oss << "Flattener:flatten:Warning: " << flattener_losses << " primitives were rounded.";
+      flattener_messages.push_back ( oss.str () );
+   }
+   
+   flattener_commands = 0;
+   flattener_output = 0;
+   
+   return ( !flattener_errors );
+}
+
+/*
+ * Member function to know if the last flatten rounded any value.
+ */
+bool OpenCIF::Flattener::hasPrecisionLoss ( void ) const
+{
+   return ( flattener_losses > 0 );
+}
+
+/*
+ * Member function to get the amount of primitives rounded by the last flatten.
+ */
+unsigned long int OpenCIF::Flattener::getPrecisionLosses ( void ) const
+{
+   return ( flattener_losses );
+}
+
+/*
+ * Member function to get the messages of the last flatten.
+ */
+const std::vector< std::string >& OpenCIF::Flattener::getMessages ( void ) const
+{
+   return ( flattener_messages );
+}
+
+/*
+ * Private member function to process a command outside of a definition, or inside of the
+ * symbol being expanded.
+ */
+void OpenCIF::Flattener::process ( OpenCIF::Command* command )
+{
+   switch ( command->type () )
+   {
+      case OpenCIF::Command::Layer:
+         flattener_layer = static_cast< OpenCIF::LayerCommand* > ( command )->getName ();
+         break;
+         
+      case OpenCIF::Command::Call:
+         expand ( static_cast< OpenCIF::CallCommand* > ( command ) );
+         break;
+         
+      case OpenCIF::Command::Polygon:
+      case OpenCIF::Command::Wire:
+      case OpenCIF::Command::Box:
+      case OpenCIF::Command::RoundFlash:
+         emit ( command );
+         break;
+         
+      default:
+         break;
+   }
+   
+   return;
+}
+
+/*
+ * Private member function to expand a call: the commands of its symbol are processed with
+ * one more level of scale and transformations.
+ */
+void OpenCIF::Flattener::expand ( const OpenCIF::CallCommand* call )
+{
+   std::map< unsigned long int , Symbol >::const_iterator symbol = flattener_symbols.find ( call->getID () );
+   
+   if ( symbol == flattener_symbols.end () )
+   {
+      std::ostringstream oss;
+      oss << "Flattener:flatten:Warning: The symbol " << call->getID () << " is not defined. The call is skipped.";
+      flattener_messages.push_back ( oss.str () );
+      return;
+   }
+   
+   if ( !flattener_active.insert ( call->getID () ).second )
+   {
+      std::ostringstream oss;
+      oss << "Flattener:flatten:Error: The symbol " << call->getID () << " calls itself.";
+      flattener_messages.push_back ( oss.str () );
+      flattener_errors = true;
+      return;
+   }
+   
+   Level level;
+   std::string caller_layer = flattener_layer;
+   level.placement = call->getPlacement ();
+   
+   OpenCIF::Point offset = level.placement.getOffset ();
+   OpenCIF::Point scaled_offset = offset;
+   
+   // The translation of the call is written in the caller, so the A/B of the caller scales it.
+   level.exact = flattener_levels.empty () || flattener_levels.back ().scale->apply ( scaled_offset );
+   level.scale = &symbol->second.scale;
+   level.correction.set ( scaled_offset.getX () - offset.getX () , scaled_offset.getY () - offset.getY () );
+   flattener_levels.push_back ( level );
+   
+   for ( unsigned long int i = symbol->second.begin; i < symbol->second.end; i++ )
+   {
+      process ( ( *flattener_commands )[ i ] );
+   }
+   
+   flattener_levels.pop_back ();
+   flattener_active.erase ( call->getID () );
+   flattener_layer = caller_layer;
+   
+   return;
+}
+
+/*
+ * Private member function to move a list of points to the top level: they are scaled by
+ * the A/B of the symbol being expanded, and then, from that symbol up, every level applies
+ * the placement of its call (with the offset scaled by the A/B of the caller). Returns
+ * false if any value was rounded.
+ */
+bool OpenCIF::Flattener::place ( OpenCIF::Point* points , const unsigned long int& amount ) const
+{
+   bool exact = true;
+   
+   if ( !flattener_levels.empty () && !flattener_levels.back ().scale->apply ( points , amount ) )
+   {
+      exact = false;
+   }
+   
+   for ( unsigned long int i = flattener_levels.size (); i > 0; i-- )
+   {
+      const Level& level = flattener_levels[ i - 1 ];
+      
+      if ( !level.placement.apply ( points , amount ) || !level.exact )
+      {
+         exact = false;
+      }
+      
+      if ( level.correction.getX () != 0 || level.correction.getY () != 0 )
+      {
+         for ( unsigned long int j = 0; j < amount; j++ )
+         {
+            points[ j ].set ( points[ j ].getX () + level.correction.getX () , points[ j ].getY () + level.correction.getY () );
+         }
+      }
+   }
+   
+   return ( exact );
+}
+
+/*
+ * Private member function to scale a length by the A/B of the symbol being expanded (the
+ * placements don't change lengths). Returns false if it was rounded.
+ */
+bool OpenCIF::Flattener::placeLength ( unsigned long int& length ) const
+{
+   if ( flattener_levels.empty () )
+   {
+      return ( true );
+   }
+   
+   return ( flattener_levels.back ().scale->applyLength ( length ) );
+}
+
+/*
+ * Private member function to turn the direction of a box to the top level. Only the
+ * orientations of the placements change it.
+ */
+void OpenCIF::Flattener::placeDirection ( OpenCIF::Point& direction ) const
+{
+   for ( unsigned long int i = flattener_levels.size (); i > 0; i-- )
+   {
+      flattener_levels[ i - 1 ].placement.applyDirection ( direction );
+   }
+   
+   return;
+}
+
+/*
+ * Private member function to copy a primitive to the output, moved to the top level, after
+ * the layer command needed (if the layer changed).
+ */
+void OpenCIF::Flattener::emit ( OpenCIF::Command* primitive )
+{
+   OpenCIF::Command* placed = 0;
+   bool exact = true;
+   
+   switch ( primitive->type () )
+   {
+      case OpenCIF::Command::Polygon:
+      case OpenCIF::Command::Wire:
+         {
+            OpenCIF::PathBasedCommand* path = 0;
+            
+            if ( primitive->type () == OpenCIF::Command::Polygon )
+            {
+               path = new OpenCIF::PolygonCommand ( *static_cast< OpenCIF::PolygonCommand* > ( primitive ) );
+            }
+            else
+            {
+               OpenCIF::WireCommand* wire = new OpenCIF::WireCommand ( *static_cast< OpenCIF::WireCommand* > ( primitive ) );
+               unsigned long int width = wire->getWidth ();
+               
+               exact = placeLength ( width );
+               wire->setWidth ( width );
+               path = wire;
+            }
+            
+            OpenCIF::PointVector points ( path->getPoints () );
+            
+            if ( !place ( points.data () , points.size () ) )
+            {
+               exact = false;
+            }
+            
+            path->setPoints ( points );
+            placed = path;
+         }
+         break;
+         
+      case OpenCIF::Command::Box:
+         {
+            OpenCIF::BoxCommand* box = new OpenCIF::BoxCommand ( *static_cast< OpenCIF::BoxCommand* > ( primitive ) );
+            OpenCIF::Point position = box->getPosition ();
+            OpenCIF::Point direction = box->getRotation ();
+            unsigned long int width = box->getSize ().getWidth ();
+            unsigned long int height = box->getSize ().getHeight ();
+            
+            exact = place ( &position , 1 );
+            
+            if ( !placeLength ( width ) || !placeLength ( height ) )
+            {
+               exact = false;
+            }
+            
+            placeDirection ( direction );
+            
+            box->setPosition ( position );
+            box->setRotation ( direction );
+            box->setSize ( OpenCIF::Size ( width , height ) );
+            placed = box;
+         }
+         break;
+         
+      case OpenCIF::Command::RoundFlash:
+         {
+            OpenCIF::RoundFlashCommand* flash = new OpenCIF::RoundFlashCommand ( *static_cast< OpenCIF::RoundFlashCommand* > ( primitive ) );
+            OpenCIF::Point position = flash->getPosition ();
+            unsigned long int diameter = flash->getDiameter ();
+            
+            exact = place ( &position , 1 );
+            
+            if ( !placeLength ( diameter ) )
+            {
+               exact = false;
+            }
+            
+            flash->setPosition ( position );
+            flash->setDiameter ( diameter );
+            placed = flash;
+         }
+         break;
+         
+      default:
+         return;
+   }
+   
+   if ( !exact )
+   {
+      flattener_losses++;
+   }
+   
+   if ( !flattener_has_output_layer || flattener_layer != flattener_output_layer )
+   {
+      if ( !flattener_layer.empty () || flattener_has_output_layer )
+      {
+         OpenCIF::LayerCommand* layer = new OpenCIF::LayerCommand ();
+         
+         layer->setName ( flattener_layer );
+         flattener_output->push_back ( layer );
+      }
+      
+      flattener_output_layer = flattener_layer;
+      flattener_has_output_layer = true;
+   }
+   
+   flattener_output->push_back ( placed );
+   
+   return;
+}
+
+// FILE: placement.cc
+
+
+namespace
+{
+   /*
+    * The kernels of the Manhattan orientations. Each one turns a single point.
+    */
+   template< int Code >
+   struct OrientationKernel;
+   
+   template<>
+   struct OrientationKernel< OpenCIF::Placement::R0 >
+   {
+      static void apply ( long int x , long int y , long int& new_x , long int& new_y )
+      {
+         new_x = x;
+         new_y = y;
+      }
+   };
+   
+   template<>
+   struct OrientationKernel< OpenCIF::Placement::R90 >
+   {
+      static void apply ( long int x , long int y , long int& new_x , long int& new_y )
+      {
+         new_x = -y;
+         new_y = x;
+      }
+   };
+   
+   template<>
+   struct OrientationKernel< OpenCIF::Placement::R180 >
+   {
+      static void apply ( long int x , long int y , long int& new_x , long int& new_y )
+      {
+         new_x = -x;
+         new_y = -y;
+      }
+   };
+   
+   template<>
+   struct OrientationKernel< OpenCIF::Placement::R270 >
+   {
+      static void apply ( long int x , long int y , long int& new_x , long int& new_y )
+      {
+         new_x = y;
+         new_y = -x;
+      }
+   };
+   
+   template<>
+   struct OrientationKernel< OpenCIF::Placement::MirroredR0 >
+   {
+      static void apply ( long int x , long int y , long int& new_x , long int& new_y )
+      {
+         new_x = -x;
+         new_y = y;
+      }
+   };
+   
+   template<>
+   struct OrientationKernel< OpenCIF::Placement::MirroredR90 >
+   {
+      static void apply ( long int x , long int y , long int& new_x , long int& new_y )
+      {
+         new_x = -y;
+         new_y = -x;
+      }
+   };
+   
+   template<>
+   struct OrientationKernel< OpenCIF::Placement::MirroredR180 >
+   {
+      static void apply ( long int x , long int y , long int& new_x , long int& new_y )
+      {
+         new_x = x;
+         new_y = -y;
+      }
+   };
+   
+   template<>
+   struct OrientationKernel< OpenCIF::Placement::MirroredR270 >
+   {
+      static void apply ( long int x , long int y , long int& new_x , long int& new_y )
+      {
+         new_x = y;
+         new_y = x;
+      }
+   };
+   
+   /*
+    * Turns and moves a list of points with the kernel of an orientation.
+    */
+   template< int Code >
+   void orientPoints ( OpenCIF::Point* points , const unsigned long int& amount , const OpenCIF::Point& offset )
+   {
+      long int offset_x = offset.getX ();
+      long int offset_y = offset.getY ();
+      long int x;
+      long int y;
+      
+      for ( unsigned long int i = 0; i < amount; i++ )
+      {
+         OrientationKernel< Code >::apply ( points[ i ].getX () , points[ i ].getY () , x , y );
+         points[ i ].set ( x + offset_x , y + offset_y );
+      }
+      
+      return;
+   }
+   
+   /*
+    * Turns a single point with an orientation chosen at run time.
+    */
+   void orientPoint ( const OpenCIF::Placement::Orientation& orientation , long int& x , long int& y )
+   {
+      OpenCIF::Point point ( x , y );
+      
+      switch ( orientation )
+      {
+         case OpenCIF::Placement::R90: orientPoints< OpenCIF::Placement::R90 > ( &point , 1 , OpenCIF::Point () ); break;
+         case OpenCIF::Placement::R180: orientPoints< OpenCIF::Placement::R180 > ( &point , 1 , OpenCIF::Point () ); break;
+         case OpenCIF::Placement::R270: orientPoints< OpenCIF::Placement::R270 > ( &point , 1 , OpenCIF::Point () ); break;
+         case OpenCIF::Placement::MirroredR0: orientPoints< OpenCIF::Placement::MirroredR0 > ( &point , 1 , OpenCIF::Point () ); break;
+         case OpenCIF::Placement::MirroredR90: orientPoints< OpenCIF::Placement::MirroredR90 > ( &point , 1 , OpenCIF::Point () ); break;
+         case OpenCIF::Placement::MirroredR180: orientPoints< OpenCIF::Placement::MirroredR180 > ( &point , 1 , OpenCIF::Point () ); break;
+         case OpenCIF::Placement::MirroredR270: orientPoints< OpenCIF::Placement::MirroredR270 > ( &point , 1 , OpenCIF::Point () ); break;
+         default: break;
+      }
+      
+      x = point.getX ();
+      y = point.getY ();
+      
+      return;
+   }
+   
+   /*
+    * Applies a mirror, or a rotation along the axes, to a single point.
+    */
+   void stepPoint ( const OpenCIF::Transformation& transformation , long int& x , long int& y )
+   {
+      OpenCIF::Point rotation = transformation.getRotation ();
+      long int old_x = x;
+      
+      switch ( transformation.getType () )
+      {
+         case OpenCIF::Transformation::HorizontalMirroring: // "M X": X turns into -X
+            x = -x;
+            break;
+            
+         case OpenCIF::Transformation::VerticalMirroring: // "M Y": Y turns into -Y
+            y = -y;
+            break;
+            
+         case OpenCIF::Transformation::Rotation:
+            if ( rotation.getY () == 0 && rotation.getX () < 0 )
+            {
+               x = -x;
+               y = -y;
+            }
+            else if ( rotation.getX () == 0 && rotation.getY () != 0 )
+            {
+               x = ( rotation.getY () > 0 ) ? -y : y;
+               y = ( rotation.getY () > 0 ) ? old_x : -old_x;
+            }
+            break;
+            
+         default:
+            break;
+      }
+      
+      return;
+   }
+}
+
+/*
+ * Default constructor. The placement does nothing.
+ */
+OpenCIF::Placement::Placement ( void )
+{
+   clear ();
+}
+
+/*
+ * Constructor from the transformations of a call.
+ */
+OpenCIF::Placement::Placement ( const std::vector< OpenCIF::Transformation >& transformations )
+{
+   set ( transformations );
+}
+
+/*
+ * Destructor. Nothing to do.
+ */
+OpenCIF::Placement::~Placement ( void )
+{
+}
+
+/*
+ * Member function to reduce a list of transformations, applied in order.
+ */
+void OpenCIF::Placement::set ( const std::vector< OpenCIF::Transformation >& transformations )
+{
+   clear ();
+   
+   for ( unsigned long int i = 0; i < transformations.size (); i++ )
+   {
+      add ( transformations[ i ] );
+   }
+   
+   return;
+}
+
+/*
+ * Member function to add a transformation after the ones reduced so far. While the
+ * placement is Manhattan, the new orientation is found from the images of the unit
+ * vectors, so nothing is rounded.
+ */
+void OpenCIF::Placement::add ( const OpenCIF::Transformation& transformation )
+{
+   OpenCIF::Point rotation = transformation.getRotation ();
+   
+   if ( transformation.getType () == OpenCIF::Transformation::Rotation )
+   {
+      if ( rotation.getX () == 0 && rotation.getY () == 0 )
+      {
+         return;
+      }
+      
+      if ( rotation.getX () != 0 && rotation.getY () != 0 )
+      {
+         toGeneral ();
+      }
+   }
+   
+   if ( placement_orientation == General )
+   {
+      switch ( transformation.getType () )
+      {
+         case OpenCIF::Transformation::Displacement:
+            placement_displacement[ 0 ] += transformation.getDisplacement ().getX ();
+            placement_displacement[ 1 ] += transformation.getDisplacement ().getY ();
+            break;
+            
+         case OpenCIF::Transformation::HorizontalMirroring: // Mirroring X after turning by r is turning by -r after mirroring X.
+            placement_matrix[ 0 ][ 0 ] = -placement_matrix[ 0 ][ 0 ];
+            placement_matrix[ 0 ][ 1 ] = -placement_matrix[ 0 ][ 1 ];
+            placement_displacement[ 0 ] = -placement_displacement[ 0 ];
+            placement_rotation.setY ( -placement_rotation.getY () );
+            placement_mirrored = !placement_mirrored;
+            break;
+            
+         case OpenCIF::Transformation::VerticalMirroring: // The same, turned by 180 degrees.
+            placement_matrix[ 1 ][ 0 ] = -placement_matrix[ 1 ][ 0 ];
+            placement_matrix[ 1 ][ 1 ] = -placement_matrix[ 1 ][ 1 ];
+            placement_displacement[ 1 ] = -placement_displacement[ 1 ];
+            placement_rotation.setX ( -placement_rotation.getX () );
+            placement_mirrored = !placement_mirrored;
+            break;
+            
+         case OpenCIF::Transformation::Rotation:
+            {
+               double length = std::sqrt ( (double)rotation.getX () * rotation.getX () + (double)rotation.getY () * rotation.getY () );
+               double cosine = rotation.getX () / length;
+               double sine = rotation.getY () / length;
+               double x;
+               double y;
+               
+               for ( int column = 0; column < 2; column++ )
+               {
+                  x = cosine * placement_matrix[ 0 ][ column ] - sine * placement_matrix[ 1 ][ column ];
+                  y = sine * placement_matrix[ 0 ][ column ] + cosine * placement_matrix[ 1 ][ column ];
+                  placement_matrix[ 0 ][ column ] = x;
+                  placement_matrix[ 1 ][ column ] = y;
+               }
+               
+               x = cosine * placement_displacement[ 0 ] - sine * placement_displacement[ 1 ];
+               y = sine * placement_displacement[ 0 ] + cosine * placement_displacement[ 1 ];
+               placement_displacement[ 0 ] = x;
+               placement_displacement[ 1 ] = y;
+               
+               // The rotations are composed as integer vectors, reduced.
+               long int rotation_x = rotation.getX () * placement_rotation.getX () - rotation.getY () * placement_rotation.getY ();
+               long int rotation_y = rotation.getY () * placement_rotation.getX () + rotation.getX () * placement_rotation.getY ();
+               long int divisor = static_cast< long int > ( greatestCommonDivisor ( ( rotation_x < 0 ) ? -rotation_x : rotation_x ,
+                                                                                     ( rotation_y < 0 ) ? -rotation_y : rotation_y ) );
+               
+               placement_rotation.set ( rotation_x / divisor , rotation_y / divisor );
+            }
+            break;
+      }
+      
+      return;
+   }
+   
+   if ( transformation.getType () == OpenCIF::Transformation::Displacement )
    {
-      input_char = command[ i ];
-      
-      jump_state = fsm->operator[] ( input_char );
+      placement_offset.set ( placement_offset.getX () + transformation.getDisplacement ().getX () ,
+                             placement_offset.getY () + transformation.getDisplacement ().getY () );
       
-      if ( jump_state > 1 )
-      {
-         cif_command_found = true;
-      }
+      return;
    }
    
-   // String validated. What is the result?
-   if ( jump_state == -1 )
-   {      
-      return ( false );
-   }
+   long int first_x = 1;
+   long int first_y = 0;
+   long int second_x = 0;
+   long int second_y = 1;
+   long int offset_x = placement_offset.getX ();
+   long int offset_y = placement_offset.getY ();
    
-   // If no command found, is considered invalid
-   if ( !cif_command_found )
+   orientPoint ( placement_orientation , first_x , first_y );
+   orientPoint ( placement_orientation , second_x , second_y );
+   stepPoint ( transformation , first_x , first_y );
+   stepPoint ( transformation , second_x , second_y );
+   stepPoint ( transformation , offset_x , offset_y );
+   
+   // The image of (1,0) gives the rotation, and the sign of the determinant the mirror.
+   int turns = ( first_x == 1 ) ? 0 : ( first_y == 1 ) ? 1 : ( first_x == -1 ) ? 2 : 3;
+   
+   if ( first_x * second_y - first_y * second_x < 0 )
    {
-      return ( false );
+      placement_orientation = static_cast< Orientation > ( MirroredR0 + ( turns + 2 ) % 4 );
+   }
+   else
+   {
+      placement_orientation = static_cast< Orientation > ( R0 + turns );
    }
    
-   // Everything Ok. The string is a valid according to the CIF format.
+   placement_offset.set ( offset_x , offset_y );
    
-   return ( true );
+   return;
 }
 
 /*
- * This member function takes as argument a Definition command and returns it cleaned.
- * 
- * A definition command can be something like this:
- * 
- *      "DxxxxxSlol100im,totally,legal;"
- * 
- * So, the task of this member function is to turn it into like this:
- * 
- *      "D S 100 ;"
- * 
- * The process begins with the deletion of any non-digit and non-uppercase characters.
- * Such operation, if good, can leave a command like this:
- * 
- *      "DS100;"
- * 
- * To simplify the process of converting commands into instances, the commands must have
- * whitespaces to separate components (to use the strings as, for example, input streams).
- * 
- * So, the next process is to separate the components to turn the command into this:
- * 
- *      "D S 100 ;"
+ * Member function to reset the placement, so it does nothing.
  */
-std::string OpenCIF::File::cleanDefinitionCommand ( std::string command )
+void OpenCIF::Placement::clear ( void )
 {
-   std::string final_command;
-   std::string tmp = " ";
-            
-   // There are only uppercase chars and digits
-   final_command = command[ 0 ];
-   final_command += tmp;
+   placement_orientation = R0;
+   placement_offset.set ( 0 , 0 );
+   placement_matrix[ 0 ][ 0 ] = 1.0;
+   placement_matrix[ 0 ][ 1 ] = 0.0;
+   placement_matrix[ 1 ][ 0 ] = 0.0;
+   placement_matrix[ 1 ][ 1 ] = 1.0;
+   placement_displacement[ 0 ] = 0.0;
+   placement_displacement[ 1 ] = 0.0;
+   placement_rotation.set ( 1 , 0 );
+   placement_mirrored = false;
    
-   // Remove not-necessary characters
-   command[ 0 ] = ' ';
-   for ( unsigned int i = 0; i < command.size (); i++ )
+   return;
+}
+
+/*
+ * Member function to get the orientation.
+ */
+OpenCIF::Placement::Orientation OpenCIF::Placement::getOrientation ( void ) const
+{
+   return ( placement_orientation );
+}
+
+/*
+ * Member function to know if the placement is one of the Manhattan orientations.
+ */
+bool OpenCIF::Placement::isManhattan ( void ) const
+{
+   return ( placement_orientation != General );
+}
+
+/*
+ * Member function to get the offset (rounded, for General).
+ */
+OpenCIF::Point OpenCIF::Placement::getOffset ( void ) const
+{
+   if ( placement_orientation == General )
    {
-      // If the current char is not a 'D', not a digit, not an 'S' and not an 'F'
-      if ( !std::isdigit ( command[ i ] ) && !std::isupper ( command[ i ] ) )
-      {
-         command[ i ] = ' ';
-      }
+      return ( OpenCIF::Point ( static_cast< long int > ( std::floor ( placement_displacement[ 0 ] + 0.5 ) ) ,
+                                static_cast< long int > ( std::floor ( placement_displacement[ 1 ] + 0.5 ) ) ) );
    }
    
-   for ( unsigned int i = 1; i < command.size (); i++ )
+   return ( placement_offset );
+}
+
+/*
+ * Member function to get the placement as a matrix and a displacement, for any orientation.
+ */
+void OpenCIF::Placement::getMatrix ( double matrix[ 2 ][ 2 ] , double displacement[ 2 ] ) const
+{
+   if ( placement_orientation == General )
    {
-      if ( std::isdigit ( command[ i ] ) )
-      {
-         final_command += command[ i ];
-      }
-      else if ( command[ i ] != ' ' )
-      {
-         final_command += command[ i ];
-         final_command += " ";
-      }
-      else if ( command[ i ] == ' ' && final_command[ final_command.size () - 1 ] != ' ' )
-      {
-         final_command += " ";
-      }
+      matrix[ 0 ][ 0 ] = placement_matrix[ 0 ][ 0 ];
+      matrix[ 0 ][ 1 ] = placement_matrix[ 0 ][ 1 ];
+      matrix[ 1 ][ 0 ] = placement_matrix[ 1 ][ 0 ];
+      matrix[ 1 ][ 1 ] = placement_matrix[ 1 ][ 1 ];
+      displacement[ 0 ] = placement_displacement[ 0 ];
+      displacement[ 1 ] = placement_displacement[ 1 ];
+      
+      return;
    }
    
-   ( final_command[ final_command.size () - 1 ] == ' ' )
-      ? final_command += ";"
-      : final_command += " ;";
+   long int first_x = 1;
+   long int first_y = 0;
+   long int second_x = 0;
+   long int second_y = 1;
    
-   return ( final_command );
+   orientPoint ( placement_orientation , first_x , first_y );
+   orientPoint ( placement_orientation , second_x , second_y );
+   
+   matrix[ 0 ][ 0 ] = first_x;
+   matrix[ 1 ][ 0 ] = first_y;
+   matrix[ 0 ][ 1 ] = second_x;
+   matrix[ 1 ][ 1 ] = second_y;
+   displacement[ 0 ] = placement_offset.getX ();
+   displacement[ 1 ] = placement_offset.getY ();
+   
+   return;
 }
 
 /*
- * This member function takes as argument a call command and returns it cleaned.
- * 
- * A call command can be something like this:
- * 
- *      "C1T20000 -20000R1000000 -59999MXlololololololololMY MXMXMXMYMXR100 100R100 100;"
- * 
- * So, the task of this member function is to turn it into like this:
- * 
- *      "C 1 T 20000 -20000 R 1000000 -59999 M X M Y M X M X M X M Y M X R 100 100 R 100 100;"
- * 
- * The process begins with the deletion of any non-digit, non-dash ('-') and non-uppercase characters.
- * Such operation, if good, can leave a command like this:
- * 
- *      "C 1 T 20000 -20000 R 1000000 -59999 MX MY MXMXMXMYMXR100 100R100 100;"
- * 
- * To simplify the process of converting commands into instances, the commands must have
- * whitespaces to separate components (to use the strings as, for example, input streams).
- * 
- * So, the next process is to separate the components to turn the command into this:
- * 
- *      "C 1 T 20000 -20000 R 1000000 -59999 M X M Y M X M X M X M Y M X R 100 100 R 100 100;"
+ * Member function to place a single point. Returns false if it was rounded.
  */
-std::string OpenCIF::File::cleanCallCommand ( std::string command )
+bool OpenCIF::Placement::apply ( OpenCIF::Point& point ) const
 {
-   std::string final_command;
-   std::string tmp = " ";
-            
-   // There are only uppercase chars
-   final_command = command[ 0 ];
-   final_command += tmp;
-   
-   // Remove not-necessary characters
-   command[ 0 ] = ' ';
-   for ( unsigned int i = 0; i < command.size (); i++ )
+   return ( apply ( &point , 1 ) );
+}
+
+/*
+ * Member function to place a list of points, choosing the kernel once for all of them.
+ * Returns false if any value was rounded (only General rounds).
+ */
+bool OpenCIF::Placement::apply ( OpenCIF::Point* points , const unsigned long int& amount ) const
+{
+   switch ( placement_orientation )
    {
-      if ( !std::isdigit ( command[ i ] ) && !std::isupper( command[ i ] ) && command[ i ] != '-' )
-      {
-         command[ i ] = ' ';
-      }
+      case R0: orientPoints< R0 > ( points , amount , placement_offset ); return ( true );
+      case R90: orientPoints< R90 > ( points , amount , placement_offset ); return ( true );
+      case R180: orientPoints< R180 > ( points , amount , placement_offset ); return ( true );
+      case R270: orientPoints< R270 > ( points , amount , placement_offset ); return ( true );
+      case MirroredR0: orientPoints< MirroredR0 > ( points , amount , placement_offset ); return ( true );
+      case MirroredR90: orientPoints< MirroredR90 > ( points , amount , placement_offset ); return ( true );
+      case MirroredR180: orientPoints< MirroredR180 > ( points , amount , placement_offset ); return ( true );
+      case MirroredR270: orientPoints< MirroredR270 > ( points , amount , placement_offset ); return ( true );
+      default: break;
    }
    
-   for ( unsigned int i = 1; i < command.size (); i++ )
+   bool exact = true;
+   
+   for ( unsigned long int i = 0; i < amount; i++ )
    {
-      tmp = command[ i ];
+      double x = placement_matrix[ 0 ][ 0 ] * points[ i ].getX () + placement_matrix[ 0 ][ 1 ] * points[ i ].getY () + placement_displacement[ 0 ];
+      double y = placement_matrix[ 1 ][ 0 ] * points[ i ].getX () + placement_matrix[ 1 ][ 1 ] * points[ i ].getY () + placement_displacement[ 1 ];
+      double rounded_x = std::floor ( x + 0.5 );
+      double rounded_y = std::floor ( y + 0.5 );
       
-      if ( std::isdigit ( command[ i ] ) )
-      {
-         final_command += tmp;
-      }
-      else if ( command[ i ] != ' ' )
-      {
-         if ( final_command[ final_command.size () - 1 ] != ' ' )
-         {
-            final_command += " ";
-         }
-         
-         final_command += tmp;
-         
-         if ( std::isupper ( command[ i ] ) )
-         {
-            final_command += " ";
-         }
-      }
-      else if ( final_command[ final_command.size () - 1 ] != ' ' )
+      if ( std::fabs ( x - rounded_x ) > 1e-9 || std::fabs ( y - rounded_y ) > 1e-9 )
       {
-         final_command += " ";
+         exact = false;
       }
+      
+      points[ i ].set ( static_cast< long int > ( rounded_x ) , static_cast< long int > ( rounded_y ) );
    }
    
-   ( final_command[ final_command.size () - 1 ] == ' ' )
-      ? final_command += ";"
-      : final_command += " ;";
-   
-   return ( final_command );
+   return ( exact );
 }
 
 /*
- * This member function takes as argument a Layer camand and removes any unnecesary character.
+ * Member function to turn a direction (of a box), without the offset. For General, the
+ * direction is turned with the integer rotation, so it stays exact (and reduced).
  */
-std::string OpenCIF::File::cleanLayerCommand ( std::string command )
+void OpenCIF::Placement::applyDirection ( OpenCIF::Point& direction ) const
 {
-   std::string tmp = " ";
-   std::string final_command;
-            
-   final_command = command[ 0 ];
-   final_command += tmp;
+   long int x = direction.getX ();
+   long int y = direction.getY ();
    
-   // Remove not-necessary characters
-   command[ 0 ] = ' ';
-   for ( unsigned int i = 0; i < command.size (); i++ )
+   if ( placement_orientation != General )
    {
-      if ( !std::isupper ( command[ i ] ) && command[ i ] != '_' && ! std::isdigit ( command[ i ] ) )
-      {
-         command[ i ] = ' ';
-      }
+      orientPoint ( placement_orientation , x , y );
+      direction.set ( x , y );
+      
+      return;
    }
    
-   std::istringstream iss ( command );
+   if ( placement_mirrored )
+   {
+      x = -x;
+   }
    
-   while ( !iss.eof () )
+   long int turned_x = placement_rotation.getX () * x - placement_rotation.getY () * y;
+   long int turned_y = placement_rotation.getY () * x + placement_rotation.getX () * y;
+   long int divisor = static_cast< long int > ( greatestCommonDivisor ( ( turned_x < 0 ) ? -turned_x : turned_x ,
+                                                                        ( turned_y < 0 ) ? -turned_y : turned_y ) );
+   
+   if ( divisor != 0 )
    {
-      iss >> tmp;
-      
-      if ( !iss.eof () )
-      {
-         final_command += tmp;
-         tmp = " ";
-         final_command += tmp;
-      }
+      direction.set ( turned_x / divisor , turned_y / divisor );
    }
    
-   final_command += ";";
-            
-   return ( final_command );
+   return;
 }
 
 /*
- * This member function takes as argument a numeric command (like a Polygon or Box command)
- * and cleans it.
- * 
- * A numeric command can be something like this:
- * 
- *      "W1000,muajajajajaja20000,,,this,is,valid20000twerking,so,hard,,,,,,xoxoxoxoxox-10000,-10000,-500 juar juar juarX-4000;"
- * 
- * So, the task of this member function is to turn it into like this:
- * 
- *      "W 1000 20000 20000 -10000 -10000 -500 -4000 ;"
- * 
- * The process begins with the deletion of any non-digit and non-dash ('-') characters.
- * Such operation, if good, can leave a command like this:
- * 
- *      "W1000              20000                20000                                 -10000 -10000 -500                -4000;"
- * 
- * To simplify the process of converting commands into instances, the commands must have
- * whitespaces to separate components (to use the strings as, for example, input streams).
- * 
- * So, the next process is to separate the components to turn the command into this:
- * 
- *      "W 1000 20000 20000 -10000 -10000 -500 -4000 ;"
+ * Private member function to turn a Manhattan placement into a general matrix.
  */
-std::string OpenCIF::File::clearNumericCommand ( std::string command )
+void OpenCIF::Placement::toGeneral ( void )
 {
-   std::string tmp = " ";
-   std::string final_command;
-            
-   // There are only numbers and guides ("-")
-   final_command = command[ 0 ];
-   final_command += tmp;
-   
-   // Remove not-necessary characters
-   for ( unsigned int i = 0; i < command.size (); i++ )
+   if ( placement_orientation == General )
    {
-      if ( !std::isdigit ( command[ i ] ) && command[ i ] != '-' )
-      {
-         command[ i ] = ' ';
-      }
+      return;
    }
    
-   std::istringstream iss ( command );
+   double matrix[ 2 ][ 2 ];
+   double displacement[ 2 ];
    
-   while ( !iss.eof () )
-   {
-      iss >> tmp;
-      
-      if ( !iss.eof () )
-      {
-         final_command += tmp;
-         tmp = " ";
-         final_command += tmp;
-      }
-   }
+   getMatrix ( matrix , displacement );
    
-   final_command += ";";
+   placement_matrix[ 0 ][ 0 ] = matrix[ 0 ][ 0 ];
+   placement_matrix[ 0 ][ 1 ] = matrix[ 0 ][ 1 ];
+   placement_matrix[ 1 ][ 0 ] = matrix[ 1 ][ 0 ];
+   placement_matrix[ 1 ][ 1 ] = matrix[ 1 ][ 1 ];
+   placement_displacement[ 0 ] = displacement[ 0 ];
+   placement_displacement[ 1 ] = displacement[ 1 ];
+   placement_mirrored = ( placement_orientation >= MirroredR0 );
+   placement_rotation.set ( 1 , 0 );
    
-   return ( final_command );
+   long int rotation_x = 1;
+   long int rotation_y = 0;
+   
+   orientPoint ( static_cast< Orientation > ( placement_orientation % 4 ) , rotation_x , rotation_y );
+   placement_rotation.set ( rotation_x , rotation_y );
+   placement_orientation = General;
+   
+   return;
 }
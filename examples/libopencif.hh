@@ -28,6 +28,26 @@
 # include <fstream>
 # include <sstream>
 # include <vector>
+# include <set>
+# include <algorithm>
+# include <map>
+# include <new>
+# include <stdexcept>
+
+# if __cplusplus >= 201103L
+# include <thread>
+# include <atomic>
+# include <future>
+# include <mutex>
+# include <condition_variable>
+# include <chrono>
+# include <utility>
+# include <unordered_map>
+# endif
+
+# if __cplusplus >= 201703L
+# include <variant>
+# endif
 
 // To search over the contents of the original files, search for the word "FILE:"
 
@@ -113,47 +133,724 @@ namespace OpenCIF
 // FILE: point.h
 
 
-namespace OpenCIF { class Point; }
-std::istream& operator>> ( std::istream& input_stream , OpenCIF::Point& point );
-std::ostream& operator<< ( std::ostream& output_stream , const OpenCIF::Point& point );
+namespace OpenCIF
+{
+   /*
+    * This function tells if a value can be stored in the type T without changing it. It is
+    * used to detect the coordinates that overflow the compact geometry types.
+    */
+   template< typename T , typename U >
+   bool fitsIn ( const U& value )
+   {
+      T narrowed = static_cast< T > ( value );
+      
+      return ( static_cast< U > ( narrowed ) == value && ( narrowed < T () ) == ( value < U () ) );
+   }
+   
+   /*
+    * A point, templated on the type of its coordinates. The library uses "Point" (long int)
+    * in the commands, and "CompactPoint" (int, half the size) in the compact geometry tables.
+    * No destructor is declared, so the points are trivially copyable, and the vectors of
+    * points are copied as plain memory.
+    */
+   template< typename T >
+   class BasicPoint
+   {
+      public:
+         typedef T CoordinateType;
+         
+      public:
+         explicit BasicPoint ( void );
+         explicit BasicPoint ( const T& new_x , const T& new_y );
+         void setX ( const T& new_x );
+         void setY ( const T& new_y );
+         void set ( const T& new_x , const T& new_y );
+         T getX ( void ) const;
+         T getY ( void ) const;
+         
+         template< typename U >
+         bool assign ( const OpenCIF::BasicPoint< U >& other ); // False (and unchanged) if the coordinates overflow T.
+         
+      private:
+         T point_x;
+         T point_y;
+   };
+   
+   typedef OpenCIF::BasicPoint< long int > Point;
+   typedef OpenCIF::BasicPoint< int > CompactPoint;
+   
+   /*
+    * Default constructor. Initialices the point with a 0,0 value.
+    */
+   template< typename T >
+   BasicPoint< T >::BasicPoint ( void )
+   {
+      set ( 0 , 0 );
+   }
+   
+   /*
+    * Specialized constructor. Initialices a point with the values specified.
+    */
+   template< typename T >
+   BasicPoint< T >::BasicPoint ( const T& new_x , const T& new_y )
+   {
+      set ( new_x , new_y );
+   }
+   
+   /*
+    * Returns the X position value of the actual point.
+    */
+   template< typename T >
+   T BasicPoint< T >::getX ( void ) const
+   {
+      return ( point_x );
+   }
+   
+   /*
+    * Returns the Y position value of the actual point.
+    */
+   template< typename T >
+   T BasicPoint< T >::getY ( void ) const
+   {
+      return ( point_y );
+   }
+   
+   /*
+    * This member function let the user to set a point in a single call.
+    * The first argument is the X position value, the second is the Y position value.
+    */
+   template< typename T >
+   void BasicPoint< T >::set ( const T& new_x , const T& new_y )
+   {
+      setX ( new_x );
+      setY ( new_y );
+      
+      return;
+   }
+   
+   /*
+    * This member functions receives the X position value and sets it to
+    * the attribute "point_x".
+    */
+   template< typename T >
+   void BasicPoint< T >::setX ( const T& new_x )
+   {
+      point_x = new_x;
+      
+      return;
+   }
+   
+   /*
+    * This member functions receives the Y position value and sets it to
+    * the attribute "point_y".
+    */
+   template< typename T >
+   void BasicPoint< T >::setY ( const T& new_y )
+   {
+      point_y = new_y;
+      
+      return;
+   }
+   
+   /*
+    * This member function copies a point with another coordinate type. If a coordinate
+    * does not fit, the point is left unchanged and false is returned.
+    */
+   template< typename T >
+   template< typename U >
+   bool BasicPoint< T >::assign ( const OpenCIF::BasicPoint< U >& other )
+   {
+      if ( !fitsIn< T > ( other.getX () ) || !fitsIn< T > ( other.getY () ) )
+      {
+         return ( false );
+      }
+      
+      set ( static_cast< T > ( other.getX () ) , static_cast< T > ( other.getY () ) );
+      
+      return ( true );
+   }
+}
+
+/*
+ * This function helps to load a point from an input stream. A value that does not fit the
+ * coordinate type sets the failbit of the stream.
+ */
+template< typename T >
+std::istream& operator>> ( std::istream& input_stream , OpenCIF::BasicPoint< T >& point )
+{
+   T x , y;
+   
+   input_stream >> x >> y;
+   point.set ( x , y );
+   
+   return ( input_stream );
+}
+
+template< typename T >
+std::ostream& operator<< ( std::ostream& output_stream , const OpenCIF::BasicPoint< T >& point )
+{
+   output_stream << point.getX () << " " << point.getY ();
+   
+   return ( output_stream );
+}
+
+// FILE: smallvector.h
+
 
 namespace OpenCIF
 {
-   class Point
+   /*
+    * A vector that keeps up to N items inside the object, and only moves them to the heap
+    * when it grows beyond that. It is used for the vertices of the wires and polygons, that
+    * are short most of the time. The interface follows std::vector, but only the members
+    * needed by the library are provided. The iterators are plain pointers.
+    */
+   template< typename T , unsigned long int N >
+   class SmallVector
    {
       public:
-         explicit Point ( void );
-         explicit Point ( const long int& new_x , const long int& new_y );
-         virtual ~Point ( void );
-         void setX ( const long int& new_x );
-         void setY ( const long int& new_y );
-         void set ( const long int& new_x , const long int& new_y );
-         long int getX ( void ) const;
-         long int getY ( void ) const;
+         typedef T value_type;
+         typedef T* iterator;
+         typedef const T* const_iterator;
+         typedef unsigned long int size_type;
+         
+      public:
+         explicit SmallVector ( void );
+         explicit SmallVector ( const size_type& count , const T& value = T () );
+         explicit SmallVector ( const std::vector< T >& items );
+         SmallVector ( const SmallVector& other );
+         ~SmallVector ( void );
+         SmallVector& operator= ( const SmallVector& other );
+# if __cplusplus >= 201103L
+         SmallVector ( SmallVector&& other ) noexcept;
+         SmallVector& operator= ( SmallVector&& other ) noexcept;
+# endif
+         
+         size_type size ( void ) const;
+         size_type capacity ( void ) const;
+         bool empty ( void ) const;
+         bool isInline ( void ) const; // True while the items are stored inside the object.
+         
+         T& operator[] ( const size_type& index );
+         const T& operator[] ( const size_type& index ) const;
+         T& at ( const size_type& index );             // Throws std::out_of_range, as std::vector.
+         const T& at ( const size_type& index ) const;
+         T& front ( void );
+         const T& front ( void ) const;
+         T& back ( void );
+         const T& back ( void ) const;
+         T* data ( void );
+         const T* data ( void ) const;
+         
+         iterator begin ( void );
+         const_iterator begin ( void ) const;
+         iterator end ( void );
+         const_iterator end ( void ) const;
+         
+         void push_back ( const T& item );
+         void pop_back ( void );
+         void clear ( void ); // Keeps the capacity, as std::vector.
+         void reserve ( const size_type& new_capacity );
+         void resize ( const size_type& new_size , const T& value = T () );
+         void assign ( const T* first , const T* last );
+         
+         std::vector< T > toVector ( void ) const;
          
-         friend std::istream& (::operator>>) ( std::istream& input_stream , Point& point );
-         friend std::ostream& (::operator<<) ( std::ostream& output_stream , const Point& point );
+      private:
+         T* inlineItems ( void );
+         void grow ( const size_type& new_capacity );
+         void release ( void ); // Destroys the items and frees the heap buffer.
          
       private:
-         long int point_x;
-         long int point_y;
+         // The union gives the inline buffer the alignment of the widest basic types.
+         union InlineStorage
+         {
+            char bytes[ N * sizeof ( T ) ];
+            long double align_long_double;
+            long int align_long;
+            void* align_pointer;
+         };
+         
+         T* vector_items;                // The inline buffer, or a heap buffer.
+         size_type vector_size;
+         size_type vector_capacity;
+         InlineStorage vector_inline;
    };
+   
+   /*
+    * Default constructor. The vector starts empty, using the inline buffer.
+    */
+   template< typename T , unsigned long int N >
+   SmallVector< T , N >::SmallVector ( void ) : vector_items ( inlineItems () ) , vector_size ( 0 ) , vector_capacity ( N )
+   {
+   }
+   
+   /*
+    * Constructor with "count" copies of a value.
+    */
+   template< typename T , unsigned long int N >
+   SmallVector< T , N >::SmallVector ( const size_type& count , const T& value ) : vector_items ( inlineItems () ) , vector_size ( 0 ) , vector_capacity ( N )
+   {
+      resize ( count , value );
+   }
+   
+   /*
+    * Constructor that copies the items of a std::vector.
+    */
+   template< typename T , unsigned long int N >
+   SmallVector< T , N >::SmallVector ( const std::vector< T >& items ) : vector_items ( inlineItems () ) , vector_size ( 0 ) , vector_capacity ( N )
+   {
+      if ( !items.empty () )
+      {
+         assign ( &items[ 0 ] , &items[ 0 ] + items.size () );
+      }
+   }
+   
+   /*
+    * Copy constructor. The copy is inline if the items fit.
+    */
+   template< typename T , unsigned long int N >
+   SmallVector< T , N >::SmallVector ( const SmallVector& other ) : vector_items ( inlineItems () ) , vector_size ( 0 ) , vector_capacity ( N )
+   {
+      assign ( other.begin () , other.end () );
+   }
+   
+   /*
+    * Destructor. Destroys the items and frees the heap buffer, if any.
+    */
+   template< typename T , unsigned long int N >
+   SmallVector< T , N >::~SmallVector ( void )
+   {
+      release ();
+   }
+   
+   /*
+    * Assignment operator. Reuses the current buffer when it is big enough.
+    */
+   template< typename T , unsigned long int N >
+   SmallVector< T , N >& SmallVector< T , N >::operator= ( const SmallVector& other )
+   {
+      if ( this != &other )
+      {
+         assign ( other.begin () , other.end () );
+      }
+      
+      return ( *this );
+   }
+   
+# if __cplusplus >= 201103L
+   /*
+    * Move constructor. A heap buffer is taken over; inline items are moved one by one.
+    */
+   template< typename T , unsigned long int N >
+   SmallVector< T , N >::SmallVector ( SmallVector&& other ) noexcept : vector_items ( inlineItems () ) , vector_size ( 0 ) , vector_capacity ( N )
+   {
+      *this = std::move ( other );
+   }
+   
+   /*
+    * Move assignment. The other vector is left empty.
+    */
+   template< typename T , unsigned long int N >
+   SmallVector< T , N >& SmallVector< T , N >::operator= ( SmallVector&& other ) noexcept
+   {
+      if ( this == &other )
+      {
+         return ( *this );
+      }
+      
+      release ();
+      
+      if ( other.isInline () )
+      {
+         for ( size_type i = 0; i < other.vector_size; i++ )
+         {
+            new ( vector_items + i ) T ( std::move ( other.vector_items[ i ] ) );
+            other.vector_items[ i ].~T ();
+         }
+      }
+      else
+      {
+         vector_items = other.vector_items;
+         vector_capacity = other.vector_capacity;
+         other.vector_items = other.inlineItems ();
+         other.vector_capacity = N;
+      }
+      
+      vector_size = other.vector_size;
+      other.vector_size = 0;
+      
+      return ( *this );
+   }
+# endif
+   
+   /*
+    * Member function to get the amount of items.
+    */
+   template< typename T , unsigned long int N >
+   typename SmallVector< T , N >::size_type SmallVector< T , N >::size ( void ) const
+   {
+      return ( vector_size );
+   }
+   
+   /*
+    * Member function to get the amount of items that fit without growing.
+    */
+   template< typename T , unsigned long int N >
+   typename SmallVector< T , N >::size_type SmallVector< T , N >::capacity ( void ) const
+   {
+      return ( vector_capacity );
+   }
+   
+   /*
+    * Member function to tell if there are no items.
+    */
+   template< typename T , unsigned long int N >
+   bool SmallVector< T , N >::empty ( void ) const
+   {
+      return ( vector_size == 0 );
+   }
+   
+   /*
+    * Member function to tell if the items are stored inside the object.
+    */
+   template< typename T , unsigned long int N >
+   bool SmallVector< T , N >::isInline ( void ) const
+   {
+      return ( vector_items == reinterpret_cast< const T* > ( vector_inline.bytes ) );
+   }
+   
+   /*
+    * Unchecked access to an item.
+    */
+   template< typename T , unsigned long int N >
+   T& SmallVector< T , N >::operator[] ( const size_type& index )
+   {
+      return ( vector_items[ index ] );
+   }
+   
+   /*
+    * Unchecked access to an item, read-only.
+    */
+   template< typename T , unsigned long int N >
+   const T& SmallVector< T , N >::operator[] ( const size_type& index ) const
+   {
+      return ( vector_items[ index ] );
+   }
+   
+   /*
+    * Checked access to an item.
+    */
+   template< typename T , unsigned long int N >
+   T& SmallVector< T , N >::at ( const size_type& index )
+   {
+      if ( index >= vector_size )
+      {
+         throw std::out_of_range ( "SmallVector:at:Error: Index out of range." );
+      }
+      
+      return ( vector_items[ index ] );
+   }
+   
+   /*
+    * Checked access to an item, read-only.
+    */
+   template< typename T , unsigned long int N >
+   const T& SmallVector< T , N >::at ( const size_type& index ) const
+   {
+      if ( index >= vector_size )
+      {
+         throw std::out_of_range ( "SmallVector:at:Error: Index out of range." );
+      }
+      
+      return ( vector_items[ index ] );
+   }
+   
+   /*
+    * Member function to get the first item. The vector must not be empty.
+    */
+   template< typename T , unsigned long int N >
+   T& SmallVector< T , N >::front ( void )
+   {
+      return ( vector_items[ 0 ] );
+   }
+   
+   /*
+    * Same as above, read-only.
+    */
+   template< typename T , unsigned long int N >
+   const T& SmallVector< T , N >::front ( void ) const
+   {
+      return ( vector_items[ 0 ] );
+   }
+   
+   /*
+    * Member function to get the last item. The vector must not be empty.
+    */
+   template< typename T , unsigned long int N >
+   T& SmallVector< T , N >::back ( void )
+   {
+      return ( vector_items[ vector_size - 1 ] );
+   }
+   
+   /*
+    * Same as above, read-only.
+    */
+   template< typename T , unsigned long int N >
+   const T& SmallVector< T , N >::back ( void ) const
+   {
+      return ( vector_items[ vector_size - 1 ] );
+   }
+   
+   /*
+    * Member function to get the items as an array.
+    */
+   template< typename T , unsigned long int N >
+   T* SmallVector< T , N >::data ( void )
+   {
+      return ( vector_items );
+   }
+   
+   /*
+    * Same as above, read-only.
+    */
+   template< typename T , unsigned long int N >
+   const T* SmallVector< T , N >::data ( void ) const
+   {
+      return ( vector_items );
+   }
+   
+   /*
+    * Member function to get an iterator to the first item.
+    */
+   template< typename T , unsigned long int N >
+   typename SmallVector< T , N >::iterator SmallVector< T , N >::begin ( void )
+   {
+      return ( vector_items );
+   }
+   
+   /*
+    * Same as above, read-only.
+    */
+   template< typename T , unsigned long int N >
+   typename SmallVector< T , N >::const_iterator SmallVector< T , N >::begin ( void ) const
+   {
+      return ( vector_items );
+   }
+   
+   /*
+    * Member function to get an iterator past the last item.
+    */
+   template< typename T , unsigned long int N >
+   typename SmallVector< T , N >::iterator SmallVector< T , N >::end ( void )
+   {
+      return ( vector_items + vector_size );
+   }
+   
+   /*
+    * Same as above, read-only.
+    */
+   template< typename T , unsigned long int N >
+   typename SmallVector< T , N >::const_iterator SmallVector< T , N >::end ( void ) const
+   {
+      return ( vector_items + vector_size );
+   }
+   
+   /*
+    * Member function to add an item at the end. The capacity doubles when it runs out.
+    */
+   template< typename T , unsigned long int N >
+   void SmallVector< T , N >::push_back ( const T& item )
+   {
+      if ( vector_size == vector_capacity )
+      {
+         T copy ( item ); // The item may live in this vector.
+         
+         grow ( vector_capacity * 2 );
+         new ( vector_items + vector_size ) T ( copy );
+      }
+      else
+      {
+         new ( vector_items + vector_size ) T ( item );
+      }
+      
+      vector_size++;
+      
+      return;
+   }
+   
+   /*
+    * Member function to remove the last item. The vector must not be empty.
+    */
+   template< typename T , unsigned long int N >
+   void SmallVector< T , N >::pop_back ( void )
+   {
+      vector_size--;
+      vector_items[ vector_size ].~T ();
+      
+      return;
+   }
+   
+   /*
+    * Member function to remove every item.
+    */
+   template< typename T , unsigned long int N >
+   void SmallVector< T , N >::clear ( void )
+   {
+      while ( vector_size > 0 )
+      {
+         pop_back ();
+      }
+      
+      return;
+   }
+   
+   /*
+    * Member function to make room for "new_capacity" items.
+    */
+   template< typename T , unsigned long int N >
+   void SmallVector< T , N >::reserve ( const size_type& new_capacity )
+   {
+      if ( new_capacity > vector_capacity )
+      {
+         grow ( new_capacity );
+      }
+      
+      return;
+   }
+   
+   /*
+    * Member function to change the amount of items, adding copies of "value" if needed.
+    */
+   template< typename T , unsigned long int N >
+   void SmallVector< T , N >::resize ( const size_type& new_size , const T& value )
+   {
+      reserve ( new_size );
+      
+      while ( vector_size > new_size )
+      {
+         pop_back ();
+      }
+      
+      while ( vector_size < new_size )
+      {
+         new ( vector_items + vector_size ) T ( value );
+         vector_size++;
+      }
+      
+      return;
+   }
+   
+   /*
+    * Member function to replace the items with a copy of a range. The range must not
+    * belong to this vector.
+    */
+   template< typename T , unsigned long int N >
+   void SmallVector< T , N >::assign ( const T* first , const T* last )
+   {
+      clear ();
+      reserve ( static_cast< size_type > ( last - first ) );
+      
+      for ( ; first != last; ++first )
+      {
+         new ( vector_items + vector_size ) T ( *first );
+         vector_size++;
+      }
+      
+      return;
+   }
+   
+   /*
+    * Member function to copy the items into a std::vector.
+    */
+   template< typename T , unsigned long int N >
+   std::vector< T > SmallVector< T , N >::toVector ( void ) const
+   {
+      return ( std::vector< T > ( begin () , end () ) );
+   }
+   
+   /*
+    * Member function to get the inline buffer as an array of items.
+    */
+   template< typename T , unsigned long int N >
+   T* SmallVector< T , N >::inlineItems ( void )
+   {
+      return ( reinterpret_cast< T* > ( vector_inline.bytes ) );
+   }
+   
+   /*
+    * Member function to move the items to a new heap buffer.
+    */
+   template< typename T , unsigned long int N >
+   void SmallVector< T , N >::grow ( const size_type& new_capacity )
+   {
+      T* items = static_cast< T* > ( ::operator new ( new_capacity * sizeof ( T ) ) );
+      
+      for ( size_type i = 0; i < vector_size; i++ )
+      {
+         new ( items + i ) T ( vector_items[ i ] );
+         vector_items[ i ].~T ();
+      }
+      
+      if ( !isInline () )
+      {
+         ::operator delete ( vector_items );
+      }
+      
+      vector_items = items;
+      vector_capacity = new_capacity;
+      
+      return;
+   }
+   
+   /*
+    * Member function to destroy the items and go back to the inline buffer.
+    */
+   template< typename T , unsigned long int N >
+   void SmallVector< T , N >::release ( void )
+   {
+      clear ();
+      
+      if ( !isInline () )
+      {
+         ::operator delete ( vector_items );
+         vector_items = inlineItems ();
+         vector_capacity = N;
+      }
+      
+      return;
+   }
 }
 
 // FILE: pathbasedcommand.h
 
 namespace OpenCIF
 {
+   // Most polygons are rectangles (four vertices), and most wires have two or three points.
+   // Four inline points keep them off the heap, for 72 bytes more than a std::vector.
+   typedef OpenCIF::SmallVector< OpenCIF::Point , 4 > PointVector;
+   
    class PathBasedCommand : public OpenCIF::PrimitiveCommand
    {
       public:
          explicit PathBasedCommand ( void );
          virtual ~PathBasedCommand ( void );
+# if __cplusplus >= 201103L
+         PathBasedCommand ( const PathBasedCommand& ) = default;
+         PathBasedCommand ( PathBasedCommand&& ) = default;
+         PathBasedCommand& operator= ( const PathBasedCommand& ) = default;
+         PathBasedCommand& operator= ( PathBasedCommand&& ) = default;
+# endif
          void setPoints ( const std::vector< OpenCIF::Point >& new_points );
-         std::vector< OpenCIF::Point > getPoints ( void ) const;
+         void setPoints ( const OpenCIF::PointVector& new_points );
+# if __cplusplus >= 201103L
+         void setPoints ( std::vector< OpenCIF::Point >&& new_points );
+         void setPoints ( OpenCIF::PointVector&& new_points );
+# endif
+         const OpenCIF::PointVector& getPoints ( void ) const; // Use "toVector" for a std::vector.
          
       protected:
-         std::vector< OpenCIF::Point > command_points;
+         OpenCIF::PointVector command_points;
    };
 }
 
@@ -173,6 +870,12 @@ namespace OpenCIF
          explicit PolygonCommand ( void );
          explicit PolygonCommand ( const std::string& str_command );
          virtual ~PolygonCommand ( void );
+# if __cplusplus >= 201103L
+         PolygonCommand ( const PolygonCommand& ) = default;
+         PolygonCommand ( PolygonCommand&& ) = default;
+         PolygonCommand& operator= ( const PolygonCommand& ) = default;
+         PolygonCommand& operator= ( PolygonCommand&& ) = default;
+# endif
          
          friend std::ostream& (::operator<<) ( std::ostream& output_stream , PolygonCommand& command );
          friend std::istream& (::operator>>) ( std::istream& input_stream , PolygonCommand& command );
@@ -201,6 +904,12 @@ namespace OpenCIF
          explicit WireCommand ( void );
          explicit WireCommand ( const std::string& str_command );
          virtual ~WireCommand ( void );
+# if __cplusplus >= 201103L
+         WireCommand ( const WireCommand& ) = default;
+         WireCommand ( WireCommand&& ) = default;
+         WireCommand& operator= ( const WireCommand& ) = default;
+         WireCommand& operator= ( WireCommand&& ) = default;
+# endif
          void setWidth ( const unsigned long int& new_width );
          unsigned long int getWidth ( void ) const;
          
@@ -238,31 +947,143 @@ namespace OpenCIF
 // FILE: size.h
 
 
-namespace OpenCIF { class Size; }
-std::istream& operator>> ( std::istream& input_stream , OpenCIF::Size& command );
-std::ostream& operator<< ( std::ostream& output_stream , const OpenCIF::Size& command );
-
 namespace OpenCIF
 {
-   class Size
+   /*
+    * The size of a box, templated on the type of its dimensions, as BasicPoint.
+    */
+   template< typename T >
+   class BasicSize
    {
       public:
-         explicit Size ( void );
-         explicit Size ( const unsigned long int& new_width , const unsigned long int& new_height );
-         virtual ~Size ( void );
-         unsigned long int getWidth ( void ) const;
-         unsigned long int getHeight ( void ) const;
-         void setWidth ( const unsigned long int& new_width );
-         void setHeight ( const unsigned long int& new_height );
-         void set ( const unsigned long int& new_width , const unsigned long int& new_height );
+         typedef T DimensionType;
+         
+      public:
+         explicit BasicSize ( void );
+         explicit BasicSize ( const T& new_width , const T& new_height );
+         T getWidth ( void ) const;
+         T getHeight ( void ) const;
+         void setWidth ( const T& new_width );
+         void setHeight ( const T& new_height );
+         void set ( const T& new_width , const T& new_height );
          
-         friend std::istream& (::operator>>) ( std::istream& input_stream , Size& command );
-         friend std::ostream& (::operator<<) ( std::ostream& output_stream , const Size& command );
+         template< typename U >
+         bool assign ( const OpenCIF::BasicSize< U >& other ); // False (and unchanged) if the dimensions overflow T.
          
       private:
-         unsigned long int size_width;
-         unsigned long int size_height;
+         T size_width;
+         T size_height;
    };
+   
+   typedef OpenCIF::BasicSize< unsigned long int > Size;
+   typedef OpenCIF::BasicSize< unsigned int > CompactSize;
+   
+   /*
+    * Default constructor. Initialize the values of the size to a non-zero value.
+    */
+   template< typename T >
+   BasicSize< T >::BasicSize ( void )
+   {
+      set ( 1 , 1 );
+   }
+   
+   /*
+    * Non-Default constructor. Initialize the values of the size.
+    */
+   template< typename T >
+   BasicSize< T >::BasicSize ( const T& new_width , const T& new_height )
+   {
+      set ( new_width , new_height );
+   }
+   
+   /*
+    * Member function to return the width of the size.
+    */
+   template< typename T >
+   T BasicSize< T >::getWidth ( void ) const
+   {
+      return ( size_width );
+   }
+   
+   /*
+    * Member function to return the height of the size.
+    */
+   template< typename T >
+   T BasicSize< T >::getHeight ( void ) const
+   {
+      return ( size_height );
+   }
+   
+   /*
+    * Member function to set both dimensions of the size at the same time.
+    */
+   template< typename T >
+   void BasicSize< T >::set ( const T& new_width , const T& new_height )
+   {
+      setWidth ( new_width );
+      setHeight ( new_height );
+      
+      return;
+   }
+   
+   /*
+    * Member function to set the width of the size.
+    */
+   template< typename T >
+   void BasicSize< T >::setWidth ( const T& new_width )
+   {
+      size_width = new_width;
+      
+      return;
+   }
+   
+   /*
+    * Member function to set the height of the size.
+    */
+   template< typename T >
+   void BasicSize< T >::setHeight ( const T& new_height )
+   {
+      size_height = new_height;
+      
+      return;
+   }
+   
+   /*
+    * Member function to copy a size with another dimension type. If a dimension does not
+    * fit, the size is left unchanged and false is returned.
+    */
+   template< typename T >
+   template< typename U >
+   bool BasicSize< T >::assign ( const OpenCIF::BasicSize< U >& other )
+   {
+      if ( !fitsIn< T > ( other.getWidth () ) || !fitsIn< T > ( other.getHeight () ) )
+      {
+         return ( false );
+      }
+      
+      set ( static_cast< T > ( other.getWidth () ) , static_cast< T > ( other.getHeight () ) );
+      
+      return ( true );
+   }
+}
+
+template< typename T >
+std::istream& operator>> ( std::istream& input_stream , OpenCIF::BasicSize< T >& size )
+{
+   T width , height;
+   
+   input_stream >> width >> height;
+   size.set ( width , height );
+   
+   return ( input_stream );
+}
+
+template< typename T >
+std::ostream& operator<< ( std::ostream& output_stream , const OpenCIF::BasicSize< T >& size )
+{
+   output_stream << size.getWidth () << " " << size.getHeight ();
+   
+   return ( output_stream );
 }
 
 // FILE: boxcommand.h
@@ -494,6 +1315,65 @@ namespace OpenCIF
    };
 }
 
+// FILE: placement.h
+
+
+namespace OpenCIF
+{
+   /*
+    * The transformations of a call reduced to a single step. Most calls only mirror, turn
+    * by multiples of 90 degrees and move, so they reduce to one of the 8 Manhattan
+    * orientations plus an offset, applied with integer kernels (one per orientation). A
+    * rotation out of the axes turns the placement into a general matrix, applied in double
+    * and rounded.
+    */
+   class Placement
+   {
+      public:
+         enum Orientation
+         {
+            R0 = 0 ,       // Counterclockwise rotations...
+            R90 ,
+            R180 ,
+            R270 ,
+            MirroredR0 ,   // ... and the same, after mirroring X ("M X").
+            MirroredR90 ,
+            MirroredR180 ,
+            MirroredR270 ,
+            General        // Rotation out of the axes.
+         };
+         
+      public:
+         explicit Placement ( void );
+         explicit Placement ( const std::vector< OpenCIF::Transformation >& transformations );
+         virtual ~Placement ( void );
+         
+         void set ( const std::vector< OpenCIF::Transformation >& transformations );
+         void add ( const OpenCIF::Transformation& transformation ); // Applied after the previous ones.
+         void clear ( void );
+         
+         Orientation getOrientation ( void ) const;
+         bool isManhattan ( void ) const;
+         OpenCIF::Point getOffset ( void ) const; // Rounded for General.
+         void getMatrix ( double matrix[ 2 ][ 2 ] , double displacement[ 2 ] ) const;
+         
+         bool apply ( OpenCIF::Point& point ) const;
+         bool apply ( OpenCIF::Point* points , const unsigned long int& amount ) const; // False if a value was rounded.
+         void applyDirection ( OpenCIF::Point& direction ) const; // Without the offset, for the directions of boxes.
+         
+      private:
+         void toGeneral ( void );
+         
+      private:
+         Orientation placement_orientation;
+         OpenCIF::Point placement_offset;
+         double placement_matrix[ 2 ][ 2 ];  // Used by General.
+         double placement_displacement[ 2 ]; // Used by General.
+         OpenCIF::Point placement_rotation;  // Used by General: the matrix is this rotation...
+         bool placement_mirrored;            // ... after mirroring X, if true. Kept to turn directions exactly.
+   };
+}
+
 // FILE: callcommand.h
 
 
@@ -512,10 +1392,21 @@ namespace OpenCIF
          explicit CallCommand ( void );
          explicit CallCommand ( const std::string& str_command );
          virtual ~CallCommand ( void );
+# if __cplusplus >= 201103L
+         CallCommand ( const CallCommand& ) = default;
+         CallCommand ( CallCommand&& ) = default;
+         CallCommand& operator= ( const CallCommand& ) = default;
+         CallCommand& operator= ( CallCommand&& ) = default;
+# endif
          
          void setTransformations ( const std::vector< OpenCIF::Transformation >& new_transformations );
+# if __cplusplus >= 201103L
+         void setTransformations ( std::vector< OpenCIF::Transformation >&& new_transformations );
+# endif
          void addTransformation ( const OpenCIF::Transformation& new_transformation );
-         std::vector< OpenCIF::Transformation >& getTransformations ( void );
+         std::vector< OpenCIF::Transformation >& getTransformations ( void ); // The placement is rebuilt by every getPlacement after this.
+         const std::vector< OpenCIF::Transformation >& getTransformations ( void ) const;
+         OpenCIF::Placement getPlacement ( void ) const;
          
          friend std::ostream& (::operator<<) ( std::ostream& output_stream , CallCommand& command );
          friend std::istream& (::operator>>) ( std::istream& input_stream , CallCommand& command );
@@ -528,6 +1419,8 @@ namespace OpenCIF
          
       private:
          std::vector< OpenCIF::Transformation > call_transformations;
+         OpenCIF::Placement call_placement;
+         bool call_placement_stale;          // The transformations may have changed since the placement was computed.
    };
 }
 
@@ -607,11 +1500,27 @@ namespace OpenCIF
       public:
          explicit RawContentCommand ( void );
          virtual ~RawContentCommand ( void );
+# if __cplusplus >= 201103L
+         RawContentCommand ( const RawContentCommand& ) = default;
+         RawContentCommand ( RawContentCommand&& ) = default;
+         RawContentCommand& operator= ( const RawContentCommand& ) = default;
+         RawContentCommand& operator= ( RawContentCommand&& ) = default;
+# endif
          void setContent ( const std::string& new_contents );
-         std::string getContent ( void ) const;
+# if __cplusplus >= 201103L
+         void setContent ( std::string&& new_contents );
+# endif
+         const std::string& getContent ( void ) const;
+         
+         void setSpan ( const unsigned long int& begin , const unsigned long int& end ); // Bytes of the source file.
+         unsigned long int getSpanBegin ( void ) const;
+         unsigned long int getSpanEnd ( void ) const;
+         bool hasSpan ( void ) const; // True when only the span was kept, without the content.
          
       protected:
          std::string command_content;
+         unsigned long int command_span_begin;
+         unsigned long int command_span_end;
    };
 }
 
@@ -632,6 +1541,12 @@ namespace OpenCIF
          explicit UserExtensionCommand ( void );
          explicit UserExtensionCommand ( const std::string& str_command );
          virtual ~UserExtensionCommand ( void );
+# if __cplusplus >= 201103L
+         UserExtensionCommand ( const UserExtensionCommand& ) = default;
+         UserExtensionCommand ( UserExtensionCommand&& ) = default;
+         UserExtensionCommand& operator= ( const UserExtensionCommand& ) = default;
+         UserExtensionCommand& operator= ( UserExtensionCommand&& ) = default;
+# endif
          
          friend std::istream& (::operator>>) ( std::istream& input_stream , UserExtensionCommand& command );
          friend std::ostream& (::operator<<) ( std::ostream& output_stream , UserExtensionCommand& command );
@@ -661,6 +1576,12 @@ namespace OpenCIF
          explicit CommentCommand ( void );
          explicit CommentCommand ( const std::string& str_command );
          virtual ~CommentCommand ( void );
+# if __cplusplus >= 201103L
+         CommentCommand ( const CommentCommand& ) = default;
+         CommentCommand ( CommentCommand&& ) = default;
+         CommentCommand& operator= ( const CommentCommand& ) = default;
+         CommentCommand& operator= ( CommentCommand&& ) = default;
+# endif
          
          friend std::istream& (::operator>>) ( std::istream& input_stream , CommentCommand& command );
          friend std::ostream& (::operator<<) ( std::ostream& output_stream , CommentCommand& command );
@@ -690,9 +1611,18 @@ namespace OpenCIF
          explicit LayerCommand ( void );
          explicit LayerCommand ( const std::string& str_command );
          virtual ~LayerCommand ( void );
+# if __cplusplus >= 201103L
+         LayerCommand ( const LayerCommand& ) = default;
+         LayerCommand ( LayerCommand&& ) = default;
+         LayerCommand& operator= ( const LayerCommand& ) = default;
+         LayerCommand& operator= ( LayerCommand&& ) = default;
+# endif
          
          void setName ( const std::string& new_name );
-         std::string getName ( void ) const;
+# if __cplusplus >= 201103L
+         void setName ( std::string&& new_name );
+# endif
+         const std::string& getName ( void ) const;
          
          friend std::istream& (::operator>>) ( std::istream& input_stream , LayerCommand& command );
          friend std::ostream& (::operator<<) ( std::ostream& output_stream , LayerCommand& command );
@@ -708,6 +1638,71 @@ namespace OpenCIF
    };
 }
 
+// FILE: commandvariant.h
+
+# if __cplusplus >= 201703L
+namespace OpenCIF
+{
+   /*
+    * A closed-set representation of the commands. The values are stored by value, one after
+    * the other, so a traversal uses std::visit (a jump on the index) instead of following a
+    * pointer and calling a virtual member function. The order of the alternatives is fixed,
+    * and "typeOf" maps it back to Command::CommandType.
+    */
+   typedef std::variant< OpenCIF::PolygonCommand ,
+                         OpenCIF::WireCommand ,
+                         OpenCIF::BoxCommand ,
+                         OpenCIF::RoundFlashCommand ,
+                         OpenCIF::DefinitionStartCommand ,
+                         OpenCIF::DefinitionDeleteCommand ,
+                         OpenCIF::CallCommand ,
+                         OpenCIF::DefinitionEndCommand ,
+                         OpenCIF::EndCommand ,
+                         OpenCIF::UserExtensionCommand ,
+                         OpenCIF::CommentCommand ,
+                         OpenCIF::LayerCommand > CommandVariant;
+   
+   typedef std::vector< OpenCIF::CommandVariant > CommandVariantVector;
+   
+   /*
+    * Helper to build a visitor from several lambdas:
+    *    std::visit ( OpenCIF::Overloaded { [] ( const BoxCommand& ) { ... } , [] ( const auto& ) {} } , command );
+    */
+   template < class... Visitors >
+   struct Overloaded : Visitors...
+   {
+      using Visitors::operator()...;
+   };
+   
+   template < class... Visitors >
+   Overloaded ( Visitors... ) -> Overloaded< Visitors... >;
+   
+   /*
+    * Axis-aligned extent of a set of primitives, in CIF units.
+    */
+   struct Extent
+   {
+      bool empty;
+      long int min_x;
+      long int min_y;
+      long int max_x;
+      long int max_y;
+   };
+   
+   Command::CommandType typeOf ( const OpenCIF::CommandVariant& command );       // Without a virtual call.
+   OpenCIF::Command& asCommand ( OpenCIF::CommandVariant& command );             // To use the stream operators.
+   
+   // Conversions. The pointers returned by "toPointers" are owned by the caller, as the ones
+   // given to File::setCommands. Commands of other types (none in a loaded file) are skipped.
+   OpenCIF::CommandVariantVector toVariants ( const std::vector< OpenCIF::Command* >& commands );
+   std::vector< OpenCIF::Command* > toPointers ( const OpenCIF::CommandVariantVector& commands );
+   
+   // Algorithms over the variants. Calls are not expanded.
+   OpenCIF::Extent computeExtent ( const OpenCIF::CommandVariantVector& commands );
+   std::map< std::string , unsigned long int > countPrimitivesPerLayer ( const OpenCIF::CommandVariantVector& commands );
+}
+# endif
+
 // FILE: state.h
 
 
@@ -776,6 +1771,8 @@ namespace OpenCIF
          virtual ~CIFFSM ( void );
          
          int operator[] ( const char& input_char );
+         void reset ( void ); // Also resets the parentheses counter.
+         unsigned long int feed ( const char* input_chars , const unsigned long int& length );
          
       private:
          // This member function is being hidden.
@@ -788,64 +1785,1598 @@ namespace OpenCIF
    };
 }
 
-// FILE: file.h
+// FILE: spscqueue.h
 
 
+# if __cplusplus >= 201103L
 namespace OpenCIF
 {
-   class File
+   /*
+    * This class is a bounded queue for a single producer thread and a single consumer
+    * thread. The items move without locks: the mutex is only taken by a thread that must
+    * sleep, and by the other one to wake it up (only if it sleeps). "tryPush" and "tryPop" fail when the queue is full or empty, while
+    * "push" and "pop" sleep until they can go on. The consumer can close the queue when
+    * it stops reading, so a producer waiting in "push" gives up.
+    */
+   template< typename T >
+   class SPSCQueue
    {
       public:
-         enum LoadStatus
+         explicit SPSCQueue ( const unsigned long int& capacity );
+         virtual ~SPSCQueue ( void );
+         
+         bool tryPush ( const T& item ); // Only called by the producer.
+         bool tryPop ( T& item );        // Only called by the consumer.
+         bool push ( const T& item );    // Only called by the producer. False if the queue was closed.
+         void pop ( T& item );           // Only called by the consumer.
+         void close ( void );            // Only called by the consumer.
+         unsigned long int capacity ( void ) const;
+         
+      private:
+         void wakeUp ( void );
+         void wakeUpWaiters ( void );
+         
+      private:
+         std::vector< T > queue_items;   // One slot is always empty, to tell a full queue from an empty one.
+         std::atomic< unsigned long int > queue_head; // Next item to pop. Written by the consumer.
+         char queue_padding[ 64 ];                    // Keeps the indexes in different cache lines.
+         std::atomic< unsigned long int > queue_tail; // Next slot to push. Written by the producer.
+         std::atomic< bool > queue_closed;
+         std::atomic< unsigned int > queue_waiters;   // Threads sleeping (or about to) in "push" or "pop".
+         std::mutex queue_mutex;
+         std::condition_variable queue_condition;
+   };
+   
+   /*
+    * Constructor. Reserve the slots.
+    */
+   template< typename T >
+   SPSCQueue< T >::SPSCQueue ( const unsigned long int& capacity ) : queue_items ( capacity + 1 ) , queue_head ( 0 ) , queue_tail ( 0 ) , queue_closed ( false ) , queue_waiters ( 0 )
+   {
+   }
+   
+   /*
+    * Destructor. The items still queued are not deleted.
+    */
+   template< typename T >
+   SPSCQueue< T >::~SPSCQueue ( void )
+   {
+   }
+   
+   /*
+    * Member function to add an item. Returns false if the queue is full.
+    */
+   template< typename T >
+   bool SPSCQueue< T >::tryPush ( const T& item )
+   {
+      unsigned long int tail = queue_tail.load ( std::memory_order_relaxed );
+      unsigned long int next = ( tail + 1 ) % queue_items.size ();
+      
+      if ( next == queue_head.load ( std::memory_order_acquire ) )
+      {
+         return ( false );
+      }
+      
+      queue_items[ tail ] = item;
+      queue_tail.store ( next , std::memory_order_release );
+      wakeUpWaiters ();
+      
+      return ( true );
+   }
+   
+   /*
+    * Member function to remove the oldest item. Returns false if the queue is empty.
+    */
+   template< typename T >
+   bool SPSCQueue< T >::tryPop ( T& item )
+   {
+      unsigned long int head = queue_head.load ( std::memory_order_relaxed );
+      
+      if ( head == queue_tail.load ( std::memory_order_acquire ) )
+      {
+         return ( false );
+      }
+      
+      item = queue_items[ head ];
+      queue_head.store ( ( head + 1 ) % queue_items.size () , std::memory_order_release );
+      wakeUpWaiters ();
+      
+      return ( true );
+   }
+   
+   /*
+    * Member function to add an item, sleeping while the queue is full. Returns false
+    * (without adding it) if the consumer closed the queue.
+    */
+   template< typename T >
+   bool SPSCQueue< T >::push ( const T& item )
+   {
+      while ( !tryPush ( item ) )
+      {
+         std::unique_lock< std::mutex > lock ( queue_mutex );
+         
+         // Announced before checking again, so the consumer either sees the waiter or
+         // this thread sees the slot it freed (see wakeUpWaiters).
+         queue_waiters.fetch_add ( 1 );
+         
+         while ( !queue_closed && ( queue_tail.load () + 1 ) % queue_items.size () == queue_head.load () )
          {
-            AllOk = 0 ,
-            CantOpenInputFile ,
-            IncompleteInputFile ,
-            IncorrectInputFile
-         };
+            queue_condition.wait ( lock );
+         }
          
-         enum LoadMethod
+         queue_waiters.fetch_sub ( 1 );
+         
+         if ( queue_closed )
          {
-            StopOnError = 0 ,
-            ContinueOnError
-         };
+            return ( false );
+         }
+      }
+      
+      return ( true );
+   }
+   
+   /*
+    * Member function to remove the oldest item, sleeping while the queue is empty.
+    */
+   template< typename T >
+   void SPSCQueue< T >::pop ( T& item )
+   {
+      while ( !tryPop ( item ) )
+      {
+         std::unique_lock< std::mutex > lock ( queue_mutex );
+         
+         queue_waiters.fetch_add ( 1 );
+         
+         while ( queue_head.load () == queue_tail.load () )
+         {
+            queue_condition.wait ( lock );
+         }
+         
+         queue_waiters.fetch_sub ( 1 );
+      }
+      
+      return;
+   }
+   
+   /*
+    * Member function to tell the producer that nothing more will be popped.
+    */
+   template< typename T >
+   void SPSCQueue< T >::close ( void )
+   {
+      queue_closed = true;
+      wakeUp ();
+      
+      return;
+   }
+   
+   /*
+    * Private member function to wake up the other thread, if it waits. Taking the mutex
+    * makes sure the other thread is either before its check or already waiting.
+    */
+   template< typename T >
+   void SPSCQueue< T >::wakeUp ( void )
+   {
+      {
+         std::lock_guard< std::mutex > lock ( queue_mutex );
+      }
+      
+      queue_condition.notify_one ();
+      
+      return;
+   }
+   
+   /*
+    * Private member function to wake up the other thread after an item moved, only if
+    * it sleeps (or is about to). The fence orders the move before reading the counter:
+    * a thread that announced itself later checks the queue again and sees the move.
+    */
+   template< typename T >
+   void SPSCQueue< T >::wakeUpWaiters ( void )
+   {
+      std::atomic_thread_fence ( std::memory_order_seq_cst );
       
+      if ( queue_waiters.load ( std::memory_order_relaxed ) != 0 )
+      {
+         wakeUp ();
+      }
+      
+      return;
+   }
+   
+   /*
+    * Member function to get the maximum amount of items.
+    */
+   template< typename T >
+   unsigned long int SPSCQueue< T >::capacity ( void ) const
+   {
+      return ( queue_items.size () - 1 );
+   }
+}
+
+// FILE: blockqueuebuffer.h
+
+
+namespace OpenCIF
+{
+   /*
+    * This class is a stream buffer that reads its contents from a queue of blocks,
+    * filled by another thread. An empty block marks the end of the contents.
+    */
+   class BlockQueueBuffer : public std::streambuf
+   {
       public:
-         explicit File ( void );
-         virtual ~File ( void );
-         void setPath ( const std::string& new_path );
-         std::string getPath ( void ) const;
+         explicit BlockQueueBuffer ( OpenCIF::SPSCQueue< std::string* >& new_blocks );
+         virtual ~BlockQueueBuffer ( void );
          
-         void setCommands ( const std::vector< OpenCIF::Command* >& new_commands );
-         std::vector< OpenCIF::Command* > getCommands ( void ) const;
-         void dropCommands ( void );
+      protected:
+         virtual int_type underflow ( void );
          
-         LoadStatus loadFile ( const LoadMethod& load_method = StopOnError ); // Whole process of loading a CIF file, from opening the file
-                                                                              // to converting the commands into instances.
-         LoadStatus openFile ( void );
-         LoadStatus validateSyntax ( const LoadMethod& load_method = StopOnError );
-         void cleanCommands ( void );
-         void convertCommands ( void );
+      private:
+         OpenCIF::SPSCQueue< std::string* >& buffer_blocks;
+         std::string* buffer_current;
+         bool buffer_finished;
+   };
+}
+# endif
+
+// FILE: cancellationtoken.h
+
+
+namespace OpenCIF
+{
+   /*
+    * This class allows to cancel a load from another thread. The loading code checks
+    * the token from time to time, and stops as soon as it finds it cancelled.
+    */
+   class CancellationToken
+   {
+      public:
+         explicit CancellationToken ( void );
+         virtual ~CancellationToken ( void );
+         
+         void cancel ( void );
+         void reset ( void );
+         bool isCancelled ( void ) const;
+         
+      private:
+# if __cplusplus >= 201103L
+         std::atomic< bool > token_cancelled;
+# else
+         volatile bool token_cancelled;
+# endif
+   };
+}
+
+// FILE: symbolindex.h
+
+
+namespace OpenCIF
+{
+   /*
+    * This class indexes the symbol definitions of a CIF file: for every "DS n" block
+    * it records the range of bytes that contains it (from the "DS" to the ";" of the
+    * "DF"), the layers used, the amount of every primitive and the symbols called.
+    * 
+    * The index is built reading the file once, without storing any command, and it
+    * can be saved to (and loaded from) a sidecar file. With it, a File instance can
+    * load a single symbol (and the ones it calls) reading only their bytes.
+    */
+   class SymbolIndex
+   {
+      public:
+         struct Symbol
+         {
+            unsigned long int id;
+            unsigned long int begin;          // First byte of the "DS" command.
+            unsigned long int end;            // Byte after the ";" of the "DF" command.
+            unsigned long int boxes;
+            unsigned long int polygons;
+            unsigned long int wires;
+            unsigned long int round_flashes;
+            unsigned long int calls;
+            std::set< std::string > layers;
+            std::set< unsigned long int > callees;
+         };
+         
+      public:
+         explicit SymbolIndex ( void );
+         virtual ~SymbolIndex ( void );
          
-         std::vector< std::string > getMessages ( void );
+         bool build ( const std::string& cif_path );
+         bool save ( const std::string& index_path ) const;
+         bool load ( const std::string& index_path );
+         void clear ( void );
          
-         std::vector< std::string > getRawCommands ( void ) const;
+         unsigned long int getFileSize ( void ) const; // Size of the indexed file, to detect changes.
+         bool hasSymbol ( const unsigned long int& id ) const;
+         Symbol getSymbol ( const unsigned long int& id ) const;
+         std::vector< unsigned long int > getSymbolIds ( void ) const;
+         std::set< unsigned long int > getClosure ( const std::vector< unsigned long int >& ids ) const;
          
-         static std::string cleanCommand ( std::string command );
-         static bool isCommandValid ( std::string command );
+         static std::set< unsigned long int > computeClosure ( const std::map< unsigned long int , std::set< unsigned long int > >& callees ,
+                                                               const std::vector< unsigned long int >& ids );
+         
+         const std::vector< std::string >& getMessages ( void ) const;
          
       private:
-         static std::string clearNumericCommand ( std::string command );
-         static std::string cleanLayerCommand ( std::string command );
-         static std::string cleanCallCommand ( std::string command );
-         static std::string cleanDefinitionCommand ( std::string command );
+         void indexCommand ( const std::string& command , const unsigned long int& begin , const unsigned long int& end );
          
       private:
-         std::string file_path;
-         std::ifstream file_input;
-         std::vector< OpenCIF::Command* > file_commands;
-         std::vector< std::string > file_raw_commands;
-         std::vector< std::string > file_messages;
+         std::map< unsigned long int , Symbol > index_symbols;
+         unsigned long int index_file_size;
+         std::vector< std::string > index_messages;
+         
+         // State of the build process.
+         Symbol index_current;
+         bool index_inside_definition;
+   };
+}
+
+// FILE: extensionregistry.h
+
+
+namespace OpenCIF
+{
+   /*
+    * A user extension decoded into fields. The fields used depend on the type of the
+    * record; the others are left empty (or zero).
+    */
+   struct ExtensionRecord
+   {
+      enum RecordType
+      {
+         SymbolName = 0 ,  // "9 name"
+         Label ,           // "94 name x y [layer]"
+         NodeLabel ,       // "4N name x y" (Alliance)
+         AbutmentBox ,     // "4A lower_x lower_y upper_x upper_y" (Alliance)
+         Connector ,       // "4X name index x y width net" (Alliance)
+         InstanceName ,    // "85 name" (Alliance, names the next call)
+         UserRecord = 100  // First type free for the decoders added by the user.
+      };
+      
+      int type;
+      std::string name;
+      std::string layer;          // Layer of labels.
+      std::string net;            // Net of connectors.
+      OpenCIF::Point position;    // Position of labels, nodes and connectors. Lower corner of boxes.
+      OpenCIF::Point upper;       // Upper corner of boxes.
+      long int width;             // Width of connectors.
+      long int index;             // Index of connectors.
+      std::vector< long int > values; // Free for the decoders added by the user.
+      unsigned long int symbol;   // ID of the symbol that holds the extension (0 outside symbols).
+      unsigned long int command;  // Index of the extension in the commands of the file.
+   };
+   
+   // Symbol names and their IDs. A hash table when available.
+# if __cplusplus >= 201103L
+   typedef std::unordered_map< std::string , unsigned long int > SymbolNameIndex;
+# else
+   typedef std::map< std::string , unsigned long int > SymbolNameIndex;
+# endif
+   
+   /*
+    * This class chooses the decoder of a user extension (or of a comment that holds one,
+    * as Alliance writes them) by its first word ("9", "94", "4A"...). Comments are only
+    * decoded for the prefixes added as found in comments: an ordinary comment like
+    * "(9 cells follow);" is not a symbol name.
+    * A new registry has the decoders of the common extensions ("4A", "4N" and "4X" also
+    * in comments); more can be added, and the existing ones replaced or removed. A registry
+    * can be shared by many files (and threads) while it is not modified.
+    */
+   class ExtensionRegistry
+   {
+      public:
+         // Fills the record (but "symbol" and "command") and returns true, or returns false.
+         typedef bool ( *Decoder ) ( const std::string& content , OpenCIF::ExtensionRecord& record );
+         
+      public:
+         explicit ExtensionRegistry ( void );
+         virtual ~ExtensionRegistry ( void );
+         
+         void add ( const std::string& prefix , Decoder decoder , const bool& in_comments = false ); // Replaces the decoder of the prefix, if any.
+         void remove ( const std::string& prefix );
+         void clear ( void );
+         bool decode ( const std::string& content , OpenCIF::ExtensionRecord& record ) const;
+         bool decode ( OpenCIF::Command* command , OpenCIF::ExtensionRecord& record ) const; // User extensions and comments.
+         
+      private:
+         std::map< std::string , Decoder > registry_decoders;
+         std::set< std::string > registry_comment_prefixes; // The prefixes also decoded in comments.
+   };
+}
+
+// FILE: file.h
+
+
+namespace OpenCIF
+{
+   class File
+   {
+      public:
+         enum LoadStatus
+         {
+            AllOk = 0 ,
+            CantOpenInputFile ,
+            IncompleteInputFile ,
+            IncorrectInputFile ,
+            LoadCancelled
+         };
+         
+         // Called from time to time while loading, with the bytes read and the commands produced so far.
+         typedef void ( *ProgressCallback ) ( unsigned long int bytes , unsigned long int commands , void* user_data );
+         
+         // Called by loadFilePipelined with every batch of commands converted, in order. The
+         // commands belong to the file: with StopOnError, the batches are only passed once
+         // the whole file is known to be correct, so they are never deleted after the call.
+         typedef void ( *BatchCallback ) ( const std::vector< OpenCIF::Command* >& batch , void* user_data );
+         
+         enum LoadMethod
+         {
+            StopOnError = 0 ,
+            ContinueOnError ,
+            ValidateOnly     // Only run the FSM over the file. No commands are stored, cleaned nor converted.
+         };
+         
+         // What to do with the comments and the user extensions of the file.
+         enum AnnotationMode
+         {
+            KeepAnnotations = 0 , // Load them with their content.
+            DiscardAnnotations ,  // Validate them, but don't load them.
+            SpanAnnotations       // Load them without content, only with their span of bytes (see readSpan).
+         };
+         
+         struct Error
+         {
+            unsigned long int offset;        // Byte of the file where the incorrect char is.
+            unsigned long int line;          // Line and column of such byte, starting at 1.
+            unsigned long int column;
+            unsigned long int resume_offset; // Byte where the validation continued, after the next semicolon.
+            int state;                       // State of the FSM before the incorrect char.
+            char input_char;
+         };
+      
+      public:
+         explicit File ( void );
+         virtual ~File ( void );
+         void setPath ( const std::string& new_path );
+         std::string getPath ( void ) const;
+         
+         void setCommands ( const std::vector< OpenCIF::Command* >& new_commands );
+# if __cplusplus >= 201103L
+         void setCommands ( std::vector< OpenCIF::Command* >&& new_commands );
+# endif
+         const std::vector< OpenCIF::Command* >& getCommands ( void ) const;
+         void dropCommands ( void );
+         
+         LoadStatus loadFile ( const LoadMethod& load_method = StopOnError ); // Whole process of loading a CIF file, from opening the file
+                                                                              // to converting the commands into instances.
+# if __cplusplus >= 201103L
+         std::future< LoadStatus > loadFileAsync ( const LoadMethod& load_method = StopOnError ); // The same, in another thread.
+# endif
+         
+         LoadStatus loadFilePipelined ( const LoadMethod& load_method = StopOnError , // Same result as loadFile, overlapping
+                                        BatchCallback batch_callback = 0 ,              // reading, validation and conversion.
+                                        void* user_data = 0 );
+         
+         void setProgressCallback ( ProgressCallback new_callback , void* new_user_data = 0 );
+         void setCancellationToken ( OpenCIF::CancellationToken* new_token ); // Not owned. Zero to remove it.
+         LoadStatus openFile ( void );
+         LoadStatus validateSyntax ( const LoadMethod& load_method = StopOnError );
+         void cleanCommands ( void );
+         void convertCommands ( void );
+         
+         const std::vector< std::string >& getMessages ( void ) const;
+         const std::vector< Error >& getErrors ( void ) const;
+         
+         void setErrorLimit ( const unsigned long int& new_limit ); // Errors collected by "ContinueOnError". Zero means no limit.
+         unsigned long int getErrorLimit ( void ) const;
+         
+         const std::vector< std::string >& getRawCommands ( void ) const; // The spans of SpanAnnotations are packed as '#', 'C' or 'U', and 12 bytes.
+         
+         LoadStatus loadSymbol ( const unsigned long int& id , const OpenCIF::SymbolIndex& index ); // Loads the symbol and the ones it calls.
+         LoadStatus loadSymbols ( const std::vector< unsigned long int >& ids );                     // Same, for many symbols, reading the whole file.
+         LoadStatus loadSymbols ( const std::vector< unsigned long int >& ids , const OpenCIF::SymbolIndex& index );
+         
+         void setLayerFilter ( const std::set< std::string >& new_layers ); // Only primitives on these layers are loaded.
+         const std::set< std::string >& getLayerFilter ( void ) const;      // An empty set means "load every layer".
+         void clearLayerFilter ( void );
+         
+         void setAnnotationMode ( const AnnotationMode& new_mode );
+         AnnotationMode getAnnotationMode ( void ) const;
+         std::string readSpan ( const OpenCIF::RawContentCommand& command ); // The bytes of the command, read from the file.
+         
+         void setExtensionRegistry ( const OpenCIF::ExtensionRegistry* new_registry ); // Null (the default) to skip the decoding.
+         const OpenCIF::ExtensionRegistry* getExtensionRegistry ( void ) const;
+         const std::vector< OpenCIF::ExtensionRecord >& getExtensions ( void ) const; // Decoded by the last load.
+         const OpenCIF::SymbolNameIndex& getSymbolNames ( void ) const;
+         bool findSymbol ( const std::string& name , unsigned long int& id ) const;
+         
+         static std::string cleanCommand ( std::string command );
+         static OpenCIF::Command* convertCommand ( const std::string& command ); // From a clean raw command.
+         static bool isCommandValid ( std::string command );
+         
+      private:
+         static std::string clearNumericCommand ( std::string command );
+         static std::string cleanLayerCommand ( std::string command );
+         static std::string cleanCallCommand ( std::string command );
+         static std::string cleanDefinitionCommand ( std::string command );
+         
+         LoadStatus validateStream ( std::istream& input , const LoadMethod& load_method );
+         LoadStatus scanSyntax ( void );
+         void storeRawCommand ( const std::string& command );
+# if __cplusplus >= 201103L
+         void flushRawCommands ( void );
+# endif
+         void addError ( const unsigned long int& offset , const int& state , const char& input_char );
+         bool keepLoading ( const unsigned long int& bytes , const unsigned long int& commands );
+         bool isCancelled ( void ) const;
+         LoadStatus cancelLoad ( void );
+         LoadStatus loadRanges ( const std::set< unsigned long int >& symbols , const OpenCIF::SymbolIndex& index );
+         void decodeExtensions ( void );
+         bool decodeAnnotation ( OpenCIF::Command* command , std::ifstream& span_input , OpenCIF::ExtensionRecord& record ) const;
+         
+         void buildLineIndex ( void );
+         void locate ( const unsigned long int& offset , unsigned long int& line , unsigned long int& column );
+         std::string describePosition ( const unsigned long int& offset );
+         
+      private:
+         std::string file_path;
+         std::ifstream file_input;
+         std::vector< OpenCIF::Command* > file_commands;
+         std::vector< std::string > file_raw_commands;
+         std::vector< std::string > file_messages;
+         std::set< std::string > file_layer_filter;
+         AnnotationMode file_annotation_mode;
+         const OpenCIF::ExtensionRegistry* file_extension_registry;
+         std::vector< OpenCIF::ExtensionRecord > file_extensions;
+         OpenCIF::SymbolNameIndex file_symbol_names;
+         ProgressCallback file_progress_callback;
+         void* file_progress_user_data;
+         OpenCIF::CancellationToken* file_cancellation_token;
+         unsigned long int file_bytes_read; // By the last validation. Reported while converting.
+         unsigned long int file_raw_flushed; // Raw commands sent to the pipeline.
+# if __cplusplus >= 201103L
+         OpenCIF::SPSCQueue< std::vector< std::string >* >* file_raw_batches; // Only while loading with the pipeline.
+# endif
+         std::vector< Error > file_errors;
+         unsigned long int file_error_limit;
+         std::vector< std::pair< unsigned long int , unsigned long int > > file_load_ranges; // Only these bytes are validated, if not empty.
+         std::vector< unsigned long int > file_line_starts; // Built only when a diagnostic needs a line number.
+         bool file_line_index_built;
+   };
+}
+
+// FILE: layerregistry.h
+
+
+namespace OpenCIF
+{
+   /*
+    * This class interns layer names: every different name gets a small number (its
+    * id), starting at zero, that can be used instead of the name. The registry can
+    * be shared by many threads.
+    */
+   class LayerRegistry
+   {
+      public:
+         explicit LayerRegistry ( void );
+         virtual ~LayerRegistry ( void );
+         
+         unsigned int intern ( const std::string& name ); // The id of the name (added if it's new).
+         bool find ( const std::string& name , unsigned int& id ) const;
+         std::string getName ( const unsigned int& id ) const;
+         std::vector< std::string > getNames ( void ) const; // Ordered by id.
+         unsigned int size ( void ) const;
+         void clear ( void );
+         
+      private:
+         std::map< std::string , unsigned int > registry_ids;
+         std::vector< std::string > registry_names;
+# if __cplusplus >= 201103L
+         mutable std::mutex registry_mutex;
+# endif
+   };
+}
+
+// FILE: geometry.h
+
+
+namespace OpenCIF
+{
+   /*
+    * Flat tables with the primitives of a list of commands (the calls are not expanded),
+    * with coordinates of type T and dimensions of type U. Every primitive keeps the id of
+    * its layer and the ID of the symbol that holds it (0 outside symbols, and of type U
+    * too), given by the caller, since its coordinates are in the frame of that symbol. Wires and polygons
+    * share the table of paths, and their vertices are stored one after the other in the
+    * table of points.
+    */
+   template< typename T , typename U >
+   class BasicGeometry
+   {
+      public:
+         typedef OpenCIF::BasicPoint< T > PointType;
+         typedef OpenCIF::BasicSize< U > SizeType;
+         
+         struct Box
+         {
+            unsigned int layer;
+            U symbol;
+            PointType center;
+            PointType direction;
+            SizeType size;
+         };
+         
+         struct Flash
+         {
+            unsigned int layer;
+            U symbol;
+            PointType center;
+            U diameter;
+         };
+         
+         struct Path
+         {
+            unsigned int layer;
+            U symbol;
+            bool wire;
+            U width;                 // Zero for polygons.
+            unsigned long int first; // Index of the first vertex in the table of points.
+            unsigned long int count;
+         };
+         
+      public:
+         explicit BasicGeometry ( void );
+         virtual ~BasicGeometry ( void );
+         
+         bool add ( OpenCIF::Command* command , const unsigned int& layer , const unsigned long int& symbol ); // False (and nothing added) on overflow.
+         void clear ( void );
+         
+         const std::vector< Box >& getBoxes ( void ) const;
+         const std::vector< Flash >& getFlashes ( void ) const;
+         const std::vector< Path >& getPaths ( void ) const;
+         const std::vector< PointType >& getPoints ( void ) const;
+         unsigned long int getMemoryUsage ( void ) const; // Bytes used by the elements of the tables.
+         
+      private:
+         std::vector< Box > geometry_boxes;
+         std::vector< Flash > geometry_flashes;
+         std::vector< Path > geometry_paths;
+         std::vector< PointType > geometry_points;
+   };
+   
+   /*
+    * Constructor. Nothing to do.
+    */
+   template< typename T , typename U >
+   BasicGeometry< T , U >::BasicGeometry ( void )
+   {
+   }
+   
+   /*
+    * Destructor. Nothing to do.
+    */
+   template< typename T , typename U >
+   BasicGeometry< T , U >::~BasicGeometry ( void )
+   {
+   }
+   
+   /*
+    * Member function to add a primitive to the tables. Other commands are ignored. If a
+    * value does not fit the types of the tables, the primitive is not added and false is
+    * returned.
+    */
+   template< typename T , typename U >
+   bool BasicGeometry< T , U >::add ( OpenCIF::Command* command , const unsigned int& layer , const unsigned long int& symbol )
+   {
+      bool primitive = ( command->type () >= OpenCIF::Command::Polygon && command->type () <= OpenCIF::Command::RoundFlash );
+      
+      if ( primitive && !fitsIn< U > ( symbol ) )
+      {
+         return ( false );
+      }
+      
+      switch ( command->type () )
+      {
+         case OpenCIF::Command::Box:
+            {
+               OpenCIF::BoxCommand* box_command = static_cast< OpenCIF::BoxCommand* > ( command );
+               Box box;
+               
+               box.layer = layer;
+               box.symbol = static_cast< U > ( symbol );
+               
+               if ( !box.center.assign ( box_command->getPosition () ) ||
+                    !box.direction.assign ( box_command->getRotation () ) ||
+                    !box.size.assign ( box_command->getSize () ) )
+               {
+                  return ( false );
+               }
+               
+               geometry_boxes.push_back ( box );
+            }
+            break;
+            
+         case OpenCIF::Command::RoundFlash:
+            {
+               OpenCIF::RoundFlashCommand* flash_command = static_cast< OpenCIF::RoundFlashCommand* > ( command );
+               Flash flash;
+               
+               flash.layer = layer;
+               flash.symbol = static_cast< U > ( symbol );
+               flash.diameter = static_cast< U > ( flash_command->getDiameter () );
+               
+               if ( !flash.center.assign ( flash_command->getPosition () ) || !fitsIn< U > ( flash_command->getDiameter () ) )
+               {
+                  return ( false );
+               }
+               
+               geometry_flashes.push_back ( flash );
+            }
+            break;
+            
+         case OpenCIF::Command::Polygon:
+         case OpenCIF::Command::Wire:
+            {
+               const OpenCIF::PointVector& points = static_cast< OpenCIF::PathBasedCommand* > ( command )->getPoints ();
+               Path path;
+               
+               path.layer = layer;
+               path.symbol = static_cast< U > ( symbol );
+               path.wire = ( command->type () == OpenCIF::Command::Wire );
+               path.width = 0;
+               path.first = geometry_points.size ();
+               path.count = points.size ();
+               
+               if ( path.wire )
+               {
+                  unsigned long int width = static_cast< OpenCIF::WireCommand* > ( command )->getWidth ();
+                  
+                  if ( !fitsIn< U > ( width ) )
+                  {
+                     return ( false );
+                  }
+                  
+                  path.width = static_cast< U > ( width );
+               }
+               
+               geometry_points.resize ( path.first + path.count );
+               
+               for ( unsigned long int i = 0; i < points.size (); i++ )
+               {
+                  if ( !geometry_points[ path.first + i ].assign ( points[ i ] ) )
+                  {
+                     geometry_points.resize ( path.first );
+                     
+                     return ( false );
+                  }
+               }
+               
+               geometry_paths.push_back ( path );
+            }
+            break;
+            
+         default:
+            break;
+      }
+      
+      return ( true );
+   }
+   
+   /*
+    * Member function to empty the tables, releasing their memory.
+    */
+   template< typename T , typename U >
+   void BasicGeometry< T , U >::clear ( void )
+   {
+      std::vector< Box > ().swap ( geometry_boxes );
+      std::vector< Flash > ().swap ( geometry_flashes );
+      std::vector< Path > ().swap ( geometry_paths );
+      std::vector< PointType > ().swap ( geometry_points );
+      
+      return;
+   }
+   
+   /*
+    * Member function to get the table of boxes.
+    */
+   template< typename T , typename U >
+   const std::vector< typename BasicGeometry< T , U >::Box >& BasicGeometry< T , U >::getBoxes ( void ) const
+   {
+      return ( geometry_boxes );
+   }
+   
+   /*
+    * Member function to get the table of round flashes.
+    */
+   template< typename T , typename U >
+   const std::vector< typename BasicGeometry< T , U >::Flash >& BasicGeometry< T , U >::getFlashes ( void ) const
+   {
+      return ( geometry_flashes );
+   }
+   
+   /*
+    * Member function to get the table of wires and polygons.
+    */
+   template< typename T , typename U >
+   const std::vector< typename BasicGeometry< T , U >::Path >& BasicGeometry< T , U >::getPaths ( void ) const
+   {
+      return ( geometry_paths );
+   }
+   
+   /*
+    * Member function to get the vertices of the wires and polygons.
+    */
+   template< typename T , typename U >
+   const std::vector< typename BasicGeometry< T , U >::PointType >& BasicGeometry< T , U >::getPoints ( void ) const
+   {
+      return ( geometry_points );
+   }
+   
+   /*
+    * Member function to compute the bytes used by the elements of the tables.
+    */
+   template< typename T , typename U >
+   unsigned long int BasicGeometry< T , U >::getMemoryUsage ( void ) const
+   {
+      return ( geometry_boxes.size () * sizeof ( Box ) +
+               geometry_flashes.size () * sizeof ( Flash ) +
+               geometry_paths.size () * sizeof ( Path ) +
+               geometry_points.size () * sizeof ( PointType ) );
+   }
+   
+   /*
+    * This class builds the geometry tables of a list of commands, choosing the coordinate
+    * width when it is built: the compact tables (32 bits) are used when every value fits,
+    * and the wide ones (the width of "long int") otherwise.
+    */
+   class Geometry
+   {
+      public:
+         enum CoordinateMode
+         {
+            AutomaticCoordinates = 0 , // Compact if every value fits, wide otherwise.
+            WideCoordinates ,
+            CompactCoordinates         // Fails if a value does not fit.
+         };
+         
+         typedef OpenCIF::BasicGeometry< long int , unsigned long int > WideTables;
+         typedef OpenCIF::BasicGeometry< int , unsigned int > CompactTables;
+         
+      public:
+         explicit Geometry ( void );
+         virtual ~Geometry ( void );
+         
+         bool build ( const std::vector< OpenCIF::Command* >& commands , const CoordinateMode& mode = AutomaticCoordinates );
+         void clear ( void );
+         
+         bool isCompact ( void ) const; // Tells which tables hold the primitives.
+         const WideTables& getWideTables ( void ) const;
+         const CompactTables& getCompactTables ( void ) const;
+         const OpenCIF::LayerRegistry& getLayers ( void ) const;
+         unsigned long int getMemoryUsage ( void ) const;
+         const std::vector< std::string >& getMessages ( void ) const;
+         
+      private:
+         template< typename Tables >
+         bool fill ( Tables& tables , const std::vector< OpenCIF::Command* >& commands );
+         
+      private:
+         OpenCIF::LayerRegistry geometry_layers;
+         WideTables geometry_wide;
+         CompactTables geometry_compact;
+         bool geometry_is_compact;
+         std::vector< std::string > geometry_messages;
+   };
+}
+
+// FILE: compressedgeometry.h
+
+
+namespace OpenCIF
+{
+   /*
+    * This class keeps the primitives of a list of commands (the calls are not expanded)
+    * compressed in memory, for designs too big to keep as commands. The primitives are
+    * grouped in blocks (1024 primitives by default). Inside a block, every coordinate is
+    * stored as the difference with the previous one (the centre of the previous box or
+    * flash, or the previous vertex of a path), packed as a variable-length integer, so
+    * every block can be decoded on its own. The iterator decodes one primitive at a time.
+    */
+   class CompressedGeometry
+   {
+      public:
+         enum PrimitiveType
+         {
+            BoxPrimitive = 0 ,
+            RoundFlashPrimitive ,
+            PolygonPrimitive ,
+            WirePrimitive
+         };
+         
+         struct Primitive
+         {
+            PrimitiveType type;
+            unsigned int layer;          // Id in the LayerRegistry of the store.
+            OpenCIF::Point position;     // Centre of boxes and flashes.
+            OpenCIF::Point direction;    // Rotation of boxes.
+            OpenCIF::Size size;          // Size of boxes.
+            unsigned long int width;     // Width of wires, diameter of flashes.
+            OpenCIF::PointVector points; // Vertices of wires and polygons.
+         };
+         
+         class Iterator
+         {
+            public:
+               explicit Iterator ( void );
+               
+               const Primitive& operator* ( void ) const;
+               const Primitive* operator-> ( void ) const;
+               Iterator& operator++ ( void );
+               bool operator== ( const Iterator& other ) const;
+               bool operator!= ( const Iterator& other ) const;
+               
+            private:
+               friend class CompressedGeometry;
+               void decode ( void ); // Decodes the primitive at the current position, or moves to the next block.
+               
+            private:
+               const CompressedGeometry* iterator_geometry;
+               unsigned long int iterator_block;
+               unsigned long int iterator_offset; // Byte of the block where the next primitive starts.
+               OpenCIF::Point iterator_reference; // Last coordinate decoded in the block.
+               Primitive iterator_primitive;
+         };
+         
+      public:
+         explicit CompressedGeometry ( void );
+         virtual ~CompressedGeometry ( void );
+         
+         void build ( const std::vector< OpenCIF::Command* >& commands , const unsigned long int& block_size = 1024 );
+         void clear ( void );
+         
+         Iterator begin ( void ) const;
+         Iterator end ( void ) const;
+         
+         unsigned long int getBlockAmount ( void ) const;
+         void decodeBlock ( const unsigned long int& block , std::vector< Primitive >& primitives ) const; // Appends them.
+         unsigned long int getPrimitiveAmount ( void ) const;
+         unsigned long int getMemoryUsage ( void ) const; // Bytes of the blocks.
+         const OpenCIF::LayerRegistry& getLayers ( void ) const;
+         
+      private:
+         void encode ( OpenCIF::Command* command , const unsigned int& layer );
+         void encodePoint ( const OpenCIF::Point& point );
+         
+      private:
+         std::vector< std::string > geometry_blocks;
+         std::vector< unsigned long int > geometry_block_sizes; // Primitives in every block.
+         OpenCIF::LayerRegistry geometry_layers;
+         OpenCIF::Point geometry_reference; // Last coordinate encoded in the current block.
+         unsigned long int geometry_primitives;
+   };
+}
+
+// FILE: labelindex.h
+
+
+namespace OpenCIF
+{
+   /*
+    * This class indexes the labels of a layout (decoded from "94", "4N" and "4X" extensions)
+    * by symbol and layer, to find the labels inside a window or the label nearest to a point
+    * in logarithmic time. The positions are the ones of the extensions, in the frame of the
+    * symbol that holds them (calls are not expanded), so every symbol has its own trees; the
+    * labels outside symbols go to the symbol 0. The labels of every symbol and layer are
+    * stored as an implicit k-d tree: the label in the middle of a range splits it by X (or Y,
+    * alternating with the depth), and the halves are the ranges at its sides. Labels without
+    * layer ("4N", "4X") go to the layer "".
+    */
+   class LabelIndex
+   {
+      public:
+         struct Label
+         {
+            std::string name;
+            OpenCIF::Point position;
+            unsigned int layer;         // Id in the LayerRegistry of the index.
+            int type;                   // Type of the ExtensionRecord.
+            unsigned long int symbol;   // ID of the symbol that holds the label (0 outside symbols).
+            unsigned long int command;  // Index of the extension in the commands.
+         };
+         
+      public:
+         explicit LabelIndex ( void );
+         virtual ~LabelIndex ( void );
+         
+         void build ( const std::vector< OpenCIF::ExtensionRecord >& records ); // Like File::getExtensions.
+         void build ( const std::vector< OpenCIF::Command* >& commands , const OpenCIF::ExtensionRegistry& registry );
+         void clear ( void );
+         
+         void findInWindow ( const unsigned long int& symbol , const unsigned int& layer ,
+                             const OpenCIF::Point& lower , const OpenCIF::Point& upper ,
+                             std::vector< const Label* >& found ) const; // Appends them, borders included.
+         const Label* findNearest ( const unsigned long int& symbol , const unsigned int& layer ,
+                                    const OpenCIF::Point& point ) const; // Null if there are no labels.
+         
+         const std::vector< Label >& getLabels ( void ) const; // Grouped by symbol and layer, in tree order.
+         unsigned long int getLabelAmount ( void ) const;
+         const OpenCIF::LayerRegistry& getLayers ( void ) const;
+         
+      private:
+         void arrange ( const unsigned long int& begin , const unsigned long int& end , const bool& by_x );
+         void searchWindow ( const unsigned long int& begin , const unsigned long int& end , const bool& by_x ,
+                             const OpenCIF::Point& lower , const OpenCIF::Point& upper ,
+                             std::vector< const Label* >& found ) const;
+         void searchNearest ( const unsigned long int& begin , const unsigned long int& end , const bool& by_x ,
+                              const OpenCIF::Point& point , const Label*& nearest , double& distance ) const;
+         
+      private:
+         std::vector< Label > index_labels;
+         std::map< std::pair< unsigned long int , unsigned int > , std::pair< unsigned long int , unsigned long int > > index_trees; // Range of labels of every symbol and layer.
+         OpenCIF::LayerRegistry index_layers;
+   };
+}
+
+// FILE: scale.h
+
+
+namespace OpenCIF
+{
+   /*
+    * The A/B scale of a symbol definition, applied with integer arithmetic. The fraction is
+    * reduced when it is set, and its kind chooses the kernel used: nothing is done for 1/1,
+    * A/1 only multiplies, and A/10^k (up to 10^6) divides by a constant the compiler turns
+    * into a multiplication. Any other fraction divides at run time. A value that can't be
+    * scaled exactly is rounded to the nearest integer (halves away from zero), and the
+    * functions return false. The products must fit a long int.
+    */
+   class Scale
+   {
+      public:
+         enum ScaleKind
+         {
+            Identity = 0 ,   // 1/1
+            Multiplication , // A/1
+            PowerOfTen ,     // A/10^k, with k from 1 to 6
+            Rational         // Any other A/B
+         };
+         
+      public:
+         explicit Scale ( void );
+         explicit Scale ( const OpenCIF::Fraction& ab );
+         explicit Scale ( const unsigned long int& numerator , const unsigned long int& denominator );
+         virtual ~Scale ( void );
+         
+         void set ( const unsigned long int& numerator , const unsigned long int& denominator ); // B = 0 is taken as 1/1.
+         ScaleKind getKind ( void ) const;
+         unsigned long int getNumerator ( void ) const;   // Reduced.
+         unsigned long int getDenominator ( void ) const; // Reduced.
+         
+         bool apply ( long int& value ) const;
+         bool apply ( OpenCIF::Point& point ) const;
+         bool apply ( OpenCIF::Point* points , const unsigned long int& amount ) const;
+         bool applyLength ( unsigned long int& length ) const;
+         
+      private:
+         unsigned long int scale_numerator;
+         unsigned long int scale_denominator;
+         unsigned int scale_power; // k of PowerOfTen.
+         ScaleKind scale_kind;
+   };
+}
+
+// FILE: flattener.h
+
+
+namespace OpenCIF
+{
+   /*
+    * This class expands the calls of a list of commands (like File::getCommands) into a
+    * flat list of primitives, in the coordinates of the top level. The A/B of a symbol
+    * scales the numbers written inside its definition: the geometry of the symbol, and
+    * the translations of the calls it makes (not the geometry of the symbols called).
+    * The points are then moved by the placements of the calls, level by level, with
+    * integer arithmetic. The values that had to be rounded (A/B not dividing them, or
+    * rotations out of the axes) are counted as precision losses.
+    * 
+    * The output has the primitives, copied, and the layer commands needed to keep their
+    * layers; the caller owns them. A symbol starts with the layer of its caller, and the
+    * layer of the caller is restored when the call ends.
+    */
+   class Flattener
+   {
+      public:
+         explicit Flattener ( void );
+         virtual ~Flattener ( void );
+         
+         bool flatten ( const std::vector< OpenCIF::Command* >& commands , std::vector< OpenCIF::Command* >& primitives ); // Appends them. False on errors.
+         bool hasPrecisionLoss ( void ) const;
+         unsigned long int getPrecisionLosses ( void ) const; // Primitives rounded by the last flatten.
+         const std::vector< std::string >& getMessages ( void ) const;
+         
+      private:
+         struct Symbol
+         {
+            unsigned long int begin; // First command inside the definition.
+            unsigned long int end;   // Its "DF" command.
+            OpenCIF::Scale scale;
+         };
+         
+         struct Level
+         {
+            const OpenCIF::Scale* scale;         // A/B of the symbol called.
+            OpenCIF::Placement placement;
+            OpenCIF::Point correction;           // Added to the offset of the placement, to scale it by the A/B of the caller.
+            bool exact;                          // False if the scaled offset was rounded.
+         };
+         
+         void process ( OpenCIF::Command* command );
+         void expand ( const OpenCIF::CallCommand* call );
+         bool place ( OpenCIF::Point* points , const unsigned long int& amount ) const;
+         bool placeLength ( unsigned long int& length ) const;
+         void placeDirection ( OpenCIF::Point& direction ) const;
+         void emit ( OpenCIF::Command* primitive );
+         
+      private:
+         const std::vector< OpenCIF::Command* >* flattener_commands;
+         std::vector< OpenCIF::Command* >* flattener_output;
+         std::map< unsigned long int , Symbol > flattener_symbols;
+         std::vector< Level > flattener_levels; // From the top level to the symbol being expanded.
+         std::set< unsigned long int > flattener_active; // Symbols being expanded, to find recursive calls.
+         std::string flattener_layer;
+         std::string flattener_output_layer;
+         bool flattener_has_output_layer;
+         bool flattener_errors;
+         unsigned long int flattener_losses;
+         std::vector< std::string > flattener_messages;
+   };
+}
+
+// FILE: library.h
+
+
+namespace OpenCIF
+{
+   /*
+    * This class loads many CIF files (for example, a library of standard cells) using
+    * many threads. The layers of every file are interned in a single registry, and the
+    * symbols of every file can be found by name in a single namespace: the name given
+    * by the first "9 name" extension of the definition (decoded like File::findSymbol
+    * does) or, if there is none, the path of the file and the symbol number ("path:number").
+    */
+   class Library
+   {
+      public:
+         struct SymbolReference
+         {
+            unsigned long int file; // Index of the file in the library.
+            unsigned long int id;   // Number of the symbol in such file.
+         };
+         
+      public:
+         explicit Library ( void );
+         virtual ~Library ( void );
+         
+         void addFile ( const std::string& path );
+         unsigned long int addDirectory ( const std::string& directory , const std::string& extension = ".cif" ); // Returns the files added.
+         void clear ( void );
+         
+         void setThreadAmount ( const unsigned int& thread_amount );
+         unsigned int getThreadAmount ( void ) const;
+         
+         unsigned long int load ( const OpenCIF::File::LoadMethod& load_method = OpenCIF::File::StopOnError ); // Returns the files loaded without errors.
+         
+         unsigned long int getFileAmount ( void ) const;
+         std::string getPath ( const unsigned long int& file ) const;
+         OpenCIF::File* getFile ( const unsigned long int& file ) const; // Owned by the library.
+         OpenCIF::File::LoadStatus getStatus ( const unsigned long int& file ) const;
+         std::vector< unsigned int > getFileLayers ( const unsigned long int& file ) const; // Ids of the layers used by the file.
+         
+         const OpenCIF::LayerRegistry& getLayers ( void ) const;
+         bool findSymbol ( const std::string& name , SymbolReference& reference ) const;
+         const std::map< std::string , SymbolReference >& getSymbols ( void ) const;
+         
+         double getLoadSeconds ( void ) const;    // Wall time of the last load.
+         double getFilesPerSecond ( void ) const;
+         
+         const std::vector< std::string >& getMessages ( void ) const;
+         
+      private:
+         void indexFile ( const unsigned long int& file , std::vector< std::string >& duplicates );
+         
+      private:
+         std::vector< std::string > library_paths;
+         std::vector< OpenCIF::File* > library_files;
+         std::vector< OpenCIF::File::LoadStatus > library_statuses;
+         std::vector< std::vector< unsigned int > > library_file_layers;
+         std::map< std::string , SymbolReference > library_symbols;
+         OpenCIF::LayerRegistry library_layers;
+         OpenCIF::ExtensionRegistry library_registry;
+         unsigned int library_thread_amount;
+         double library_seconds;
+         std::vector< std::string > library_messages;
+   };
+}
+
+// FILE: sharedmodel.h
+
+
+namespace OpenCIF
+{
+   /*
+    * This class stores the geometry and the symbols of a list of commands as a single
+    * block of memory, without pointers (every reference is an offset or an index), so
+    * it can be saved to a file and mapped by many processes at once. Attaching to the
+    * file costs a system call, and the contents are never copied nor parsed.
+    * 
+    * With a path in a memory file system (like "/dev/shm/model.shm" in GNU/Linux) the
+    * model lives in shared memory. Only processes of the same system can share a file:
+    * the values are stored as "long int", in the native byte order.
+    * 
+    * In systems without "mmap", attaching reads the file into memory.
+    */
+   class SharedModel
+   {
+      public:
+         enum ElementType
+         {
+            Box = 0 ,    // Point: center. Values: width, height, rotation x, rotation y.
+            Polygon ,    // Points: vertexes.
+            Wire ,       // Points: path. Values: width.
+            RoundFlash , // Point: center. Values: diameter.
+            Call         // Transformations. Values: symbol id.
+         };
+         
+         struct String
+         {
+            unsigned long int offset; // In the strings block.
+            unsigned long int length;
+         };
+         
+         struct Coordinate
+         {
+            long int x;
+            long int y;
+         };
+         
+         struct Transformation
+         {
+            unsigned long int type; // An OpenCIF::Transformation::TransformationType.
+            long int x;             // Displacement or rotation direction. Unused by mirrorings.
+            long int y;
+         };
+         
+         struct Element
+         {
+            unsigned long int type;  // An ElementType.
+            unsigned long int layer; // Index in the layer table. Unused by calls.
+            unsigned long int first; // First point (or transformation, for calls).
+            unsigned long int count; // Amount of points (or transformations).
+            long int values[ 4 ];
+         };
+         
+         struct Symbol
+         {
+            unsigned long int id;
+            unsigned long int numerator;   // The A/B scale of the definition.
+            unsigned long int denominator;
+            unsigned long int first_element;
+            unsigned long int element_count;
+            String name;                   // From the "9 name" extension (empty if there is none).
+         };
+         
+         struct Header
+         {
+            char magic[ 8 ];
+            unsigned long int version;
+            unsigned long int long_size;        // sizeof ( long int ) of the system that saved the model.
+            unsigned long int total_size;
+            unsigned long int layers_offset;    // String[ layer_count ]
+            unsigned long int layer_count;
+            unsigned long int symbols_offset;   // Symbol[ symbol_count ], sorted by id.
+            unsigned long int symbol_count;
+            unsigned long int elements_offset;  // Element[ element_count ]
+            unsigned long int element_count;
+            unsigned long int points_offset;    // Coordinate[ point_count ]
+            unsigned long int point_count;
+            unsigned long int transformations_offset; // Transformation[ transformation_count ]
+            unsigned long int transformation_count;
+            unsigned long int strings_offset;   // char[ strings_size ]
+            unsigned long int strings_size;
+            unsigned long int top_first_element; // Elements outside the definitions.
+            unsigned long int top_element_count;
+         };
+         
+      public:
+         explicit SharedModel ( void );
+         virtual ~SharedModel ( void );
+         
+         bool save ( const std::vector< OpenCIF::Command* >& commands , const std::string& path );
+         bool attach ( const std::string& path );
+         void detach ( void );
+         bool isAttached ( void ) const;
+         
+         const Header* getHeader ( void ) const;
+         const String* getLayers ( void ) const;
+         const Symbol* getSymbols ( void ) const;
+         const Symbol* findSymbol ( const unsigned long int& id ) const; // Null if there is no such symbol.
+         const Element* getElements ( void ) const;
+         const Coordinate* getPoints ( void ) const;
+         const Transformation* getTransformations ( void ) const;
+         std::string getString ( const String& string ) const;
+         
+         const std::vector< std::string >& getMessages ( void ) const;
+         
+      private:
+         const char* model_data;
+         unsigned long int model_size;
+         bool model_mapped;   // Mapped with mmap, or read into memory.
+         std::vector< std::string > model_messages;
+   };
+}
+
+// FILE: validator.h
+
+
+namespace OpenCIF
+{
+   /*
+    * This class validates individual commands. The FSM is built once, when the
+    * instance is created, and reused (reset) for every command, so a single
+    * instance can validate any amount of commands without building it again.
+    */
+   class Validator
+   {
+      public:
+         // Result of the validation of a single command.
+         struct Result
+         {
+            bool valid;
+            long int error_offset; // Index of the first invalid char, or -1 if there is none.
+         };
+         
+      public:
+         explicit Validator ( void );
+         virtual ~Validator ( void );
+         
+         void reset ( void );
+         
+         bool isCommandValid ( const std::string& command );
+         Result validate ( const std::string& command );
+         void validate ( const std::string* commands , const unsigned long int& amount , std::vector< Result >& results );
+         std::vector< Result > validate ( const std::vector< std::string >& commands );
+         
+      private:
+         OpenCIF::CIFFSM validator_fsm;
+   };
+}
+
+// FILE: writer.h
+
+
+namespace OpenCIF
+{
+   /*
+    * This class writes commands as CIF text. The text is formatted by hand into
+    * a large buffer (instead of using the stream operators of every command),
+    * and the buffer is sent to the output stream only when it is full.
+    * 
+    * The annotations loaded with SpanAnnotations have no content: their text is
+    * copied from the file they were loaded from, given with setSpanSource. Without
+    * it, the lists that hold them are not written at all (nothing is lost silently).
+    */
+   class Writer
+   {
+      public:
+         enum WriteMode
+         {
+            Canonical = 0 , // Same text as the stream operators, one command per line.
+            Compact         // Only the separators required by the FSM.
+         };
+         
+      public:
+         explicit Writer ( std::ostream& output_stream , const WriteMode& write_mode = Canonical );
+         virtual ~Writer ( void ); // Flushes the pending contents.
+         
+         void setMode ( const WriteMode& new_mode );
+         WriteMode getMode ( void ) const;
+         
+         void setBufferSize ( const unsigned long int& new_size );
+         unsigned long int getBufferSize ( void ) const;
+         
+         void setSpanSource ( const std::string& new_path ); // The file loaded with SpanAnnotations.
+         std::string getSpanSource ( void ) const;
+         
+         bool write ( OpenCIF::Command* command ); // False if it can't be written (see setSpanSource).
+         bool write ( const std::vector< OpenCIF::Command* >& commands );
+         bool writeParallel ( const std::vector< OpenCIF::Command* >& commands , const unsigned int& thread_amount ); // Same output as write
+         void flush ( void );
+         
+         const std::vector< std::string >& getMessages ( void ) const;
+         
+         static void format ( std::string& buffer , OpenCIF::Command* command , const WriteMode& write_mode ,
+                              std::istream* span_source = 0 ); // Spans are skipped without a source.
+         
+      private:
+         static void appendUnsigned ( std::string& buffer , unsigned long int value );
+         static void appendSigned ( std::string& buffer , const long int& value );
+         static void appendPoint ( std::string& buffer , const OpenCIF::Point& point );
+         void writeOne ( OpenCIF::Command* command );
+         bool checkSpans ( const std::vector< OpenCIF::Command* >& commands );
+         bool refuseSpans ( void );
+         static bool hasSpan ( OpenCIF::Command* command );
+         
+      private:
+         std::ostream& writer_output;
+         std::string writer_buffer;
+         WriteMode writer_mode;
+         unsigned long int writer_buffer_size;
+         std::string writer_span_path;
+         std::ifstream writer_span_input;
+         std::vector< std::string > writer_messages;
+   };
+}
+
+// FILE: gdswriter.h
+
+
+namespace OpenCIF
+{
+   /*
+    * This class exports a list of commands as a GDSII stream.
+    * 
+    * Every definition turns into a structure named "S<ID>", every call into a
+    * structure reference (SREF), boxes, polygons and round flashes into
+    * boundaries, and wires into paths. The commands outside of any definition
+    * are collected in a top structure. The layer names are mapped to GDSII layer
+    * numbers using a user table, the primitives on layers not in the table are skipped.
+    * 
+    * The records are generated into a buffer that is sent to the output stream
+    * when it is full. The top structure is written by a second pass over the
+    * commands, so the export requires almost no more memory than the commands.
+    */
+   class GDSWriter
+   {
+      public:
+         explicit GDSWriter ( std::ostream& output_stream );
+         virtual ~GDSWriter ( void );
+         
+         void setLayerMap ( const std::map< std::string , int >& new_layer_map );
+         std::map< std::string , int > getLayerMap ( void ) const;
+         
+         void setLibraryName ( const std::string& new_name );
+         std::string getLibraryName ( void ) const;
+         
+         void setTopName ( const std::string& new_name ); // Name of the structure with the commands outside of definitions.
+         std::string getTopName ( void ) const;
+         
+         void setCircleSegments ( const unsigned int& new_segments ); // Amount of vertices to approximate a round flash.
+         unsigned int getCircleSegments ( void ) const;
+         
+         bool write ( const std::vector< OpenCIF::Command* >& commands );
+         
+         const std::vector< std::string >& getMessages ( void ) const;
+         
+      private:
+         void writeCommand ( OpenCIF::Command* command );
+         void writeBoundary ( const std::vector< double >& coordinates );
+         void writePath ( OpenCIF::WireCommand* wire );
+         void writeReference ( OpenCIF::CallCommand* call );
+         void writeDate ( const int& record_type );
+         
+         void beginRecord ( const int& record_type , const int& data_type , const unsigned long int& data_length );
+         void appendInt16 ( const int& value );
+         void appendInt32 ( const long int& value );
+         void appendReal8 ( double value );
+         void appendString ( const std::string& value );
+         void appendRecord ( const int& record_type , const int& data_type , const int& value );
+         void appendRecord ( const int& record_type , const std::string& value );
+         long int scale ( const double& value );
+         
+      private:
+         std::ostream& gds_output;
+         std::string gds_buffer;
+         std::map< std::string , int > gds_layer_map;
+         std::set< std::string > gds_unmapped_layers;
+         std::string gds_library_name;
+         std::string gds_top_name;
+         unsigned int gds_circle_segments;
+         int gds_layer;
+         double gds_scale;
+         unsigned long int gds_overflows; // Coordinates out of the GDSII range in the last export.
+         std::vector< std::string > gds_messages;
+   };
+}
+
+// FILE: gdsreader.h
+
+
+namespace OpenCIF
+{
+   /*
+    * This class reads a GDSII stream and turns it into the same commands generated
+    * when loading a CIF file, so they can be used with File::setCommands.
+    * 
+    * Every structure turns into a definition (followed by a "9 name" user extension
+    * with the structure name), rectangles into boxes, other boundaries into polygons,
+    * paths into wires, and structure references (and every element of the arrays of
+    * references) into calls. The texts turn into "94 text x y layer" user extensions.
+    * The structures never referenced are called at the end of the file.
+    * 
+    * The GDSII layer numbers are converted into layer names using a user table. The
+    * layers not in the table are named "G" followed by the layer number.
+    * 
+    * The input is read in big blocks and the records are decoded directly from the
+    * block, without allocating memory for every record.
+    */
+   class GDSReader
+   {
+      public:
+         explicit GDSReader ( void );
+         virtual ~GDSReader ( void ); // Deletes the commands not dropped.
+         
+         void setPath ( const std::string& new_path );
+         std::string getPath ( void ) const;
+         
+         void setLayerMap ( const std::map< int , std::string >& new_layer_map );
+         std::map< int , std::string > getLayerMap ( void ) const;
+         
+         OpenCIF::File::LoadStatus read ( void );
+         
+         const std::vector< OpenCIF::Command* >& getCommands ( void ) const;
+         void dropCommands ( void ); // Forget the commands (without deleting them), once given to a File.
+         
+         const std::vector< std::string >& getMessages ( void ) const;
+         
+      private:
+         bool nextRecord ( void );
+         long int recordInt ( const unsigned long int& index ); // Zero (and record_short set) past the end of the record.
+         double recordReal ( const unsigned long int& index );
+         std::string recordString ( void ) const;
+         
+         unsigned long int structureID ( const std::string& name );
+         void addLayer ( const int& layer );
+         void addBoundary ( void );
+         void addPath ( void );
+         void addCalls ( void );
+         void addText ( void );
+         
+      private:
+         std::string reader_path;
+         std::ifstream reader_input;
+         std::vector< char > reader_buffer;
+         unsigned long int reader_start;
+         unsigned long int reader_end;
+         
+         // Current record.
+         int record_type;
+         int record_data_type;
+         const unsigned char* record_data;
+         unsigned long int record_length;
+         bool record_short; // A value was read past the end of a record.
+         
+         // Current element.
+         int element_type;
+         int element_layer;
+         int element_path_type;
+         long int element_width;
+         bool element_reflection;
+         double element_angle;
+         double element_magnification;
+         long int element_columns;
+         long int element_rows;
+         std::string element_name;
+         std::vector< OpenCIF::Point > element_points;
+         
+         int current_layer;
+         OpenCIF::Fraction reader_scale;
+         std::map< int , std::string > reader_layer_map;
+         std::map< std::string , unsigned long int > reader_structures;
+         std::set< unsigned long int > reader_referenced;
+         std::vector< OpenCIF::Command* > reader_commands;
+         std::vector< std::string > reader_messages;
    };
 }
 
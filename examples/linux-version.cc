@@ -75,6 +75,10 @@ int main ()
       case OpenCIF::File::IncorrectInputFile:
          cout << "Incorrect input file" << endl;
          break;
+         
+      case OpenCIF::File::LoadCancelled:
+         cout << "Load cancelled" << endl;
+         break;
    }
    
    if ( all_ok )
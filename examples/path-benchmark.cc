@@ -0,0 +1,216 @@
+/*
+ * LibOpenCIF, a library to read the contents of a CIF (Caltech Intermediate
+ * Form) file. The library also includes a finite state machine to validate
+ * the contents, acording to the specifications found in the technical
+ * report 2686, from february 11, 1980.
+ * 
+ * Copyright (C) 2014, Moises Chavez Martinez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// This file is an example of how to build commands and write them to a CIF file, and it also
+// measures the cost of loading wires and polygons. The Alliance files have only boxes, so every
+// box is turned into polygons and wires with the same outline, "scale" times.
+
+// To compile, use these commands:
+
+// $ g++ -O2 libopencif.cc -c                   <- This will generate a "libopencif.o" file.
+// $ g++ -O2 path-benchmark.cc libopencif.o     <- This will generate a binary file (or an EXE file)
+
+// To use, run: ./a.out [CIF file] [scale] [repetitions]
+// By default, the program scales "adder4_a2m_sin.cif" 20 times, and loads it 10 times.
+
+# include <iostream>
+# include <fstream>
+# include <vector>
+# include <string>
+# include <cstdlib>
+# include <ctime>
+# include <new>
+
+// Import directly the library file.
+# include "libopencif.hh"
+
+using namespace std;
+
+// Every call to "new" goes through here, so the counters see all the allocations. The size
+// of every block is kept in front of it, to know the bytes still in use.
+static unsigned long int allocations = 0;
+static unsigned long int bytes_in_use = 0;
+static const size_t header_size = 16; // Keeps the alignment of the blocks returned by malloc.
+
+void* operator new ( size_t size )
+{
+   allocations++;
+   bytes_in_use += size;
+   
+   char* memory = static_cast< char* > ( malloc ( size + header_size ) );
+   
+   if ( memory == 0 )
+   {
+      throw bad_alloc ();
+   }
+   
+   *reinterpret_cast< size_t* > ( memory ) = size;
+   
+   return ( memory + header_size );
+}
+
+void operator delete ( void* memory ) throw ()
+{
+   if ( memory != 0 )
+   {
+      char* block = static_cast< char* > ( memory ) - header_size;
+      
+      bytes_in_use -= *reinterpret_cast< size_t* > ( block );
+      free ( block );
+   }
+}
+
+# if __cplusplus >= 201402L
+void operator delete ( void* memory , size_t ) throw ()
+{
+   operator delete ( memory );
+}
+# endif
+
+// Adds a polygon (four vertices), a wire with two points and a wire with three points
+// for the box, moved "shift" units to the right.
+void addPaths ( vector< OpenCIF::Command* >& commands , OpenCIF::BoxCommand* box , const long int& shift )
+{
+   long int x = box->getPosition ().getX () + shift;
+   long int y = box->getPosition ().getY ();
+   long int half_width = box->getSize ().getWidth () / 2;
+   long int half_height = box->getSize ().getHeight () / 2;
+   
+   OpenCIF::PolygonCommand* polygon = new OpenCIF::PolygonCommand ();
+   vector< OpenCIF::Point > corners;
+   corners.push_back ( OpenCIF::Point ( x - half_width , y - half_height ) );
+   corners.push_back ( OpenCIF::Point ( x + half_width , y - half_height ) );
+   corners.push_back ( OpenCIF::Point ( x + half_width , y + half_height ) );
+   corners.push_back ( OpenCIF::Point ( x - half_width , y + half_height ) );
+   polygon->setPoints ( corners );
+   commands.push_back ( polygon );
+   
+   OpenCIF::WireCommand* wire = new OpenCIF::WireCommand ();
+   vector< OpenCIF::Point > line;
+   line.push_back ( OpenCIF::Point ( x - half_width , y ) );
+   line.push_back ( OpenCIF::Point ( x + half_width , y ) );
+   wire->setWidth ( 2 * half_height );
+   wire->setPoints ( line );
+   commands.push_back ( wire );
+   
+   OpenCIF::WireCommand* bent = new OpenCIF::WireCommand ();
+   line.push_back ( OpenCIF::Point ( x + half_width , y + half_height ) );
+   bent->setWidth ( 2 );
+   bent->setPoints ( line );
+   commands.push_back ( bent );
+}
+
+int main ( int argc , char* argv[] )
+{
+   string cif_path = ( argc > 1 ) ? argv[ 1 ] : "adder4_a2m_sin.cif";
+   int scale = ( argc > 2 ) ? atoi ( argv[ 2 ] ) : 20;
+   int repetitions = ( argc > 3 ) ? atoi ( argv[ 3 ] ) : 10;
+   string paths_path = cif_path + ".paths.cif";
+   
+   OpenCIF::File file;
+   file.setPath ( cif_path );
+   
+   if ( file.loadFile () != OpenCIF::File::AllOk )
+   {
+      cout << "Can't load " << cif_path << endl;
+      return ( 1 );
+   }
+   
+   // Build the scaled layout, and write it.
+   const vector< OpenCIF::Command* >& commands = file.getCommands ();
+   vector< OpenCIF::Command* > scaled;
+   unsigned long int paths = 0;
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      if ( commands[ i ]->type () == OpenCIF::Command::Box )
+      {
+         for ( int j = 0; j < scale; j++ )
+         {
+            addPaths ( scaled , static_cast< OpenCIF::BoxCommand* > ( commands[ i ] ) , j * 10000L );
+            paths += 3;
+         }
+      }
+   }
+   
+   ofstream output ( paths_path.c_str () , ios::out | ios::binary );
+   OpenCIF::Writer writer ( output );
+   
+   for ( unsigned long int i = 0 , j = 0; i < commands.size (); i++ )
+   {
+      if ( commands[ i ]->type () == OpenCIF::Command::Box )
+      {
+         for ( int k = 0; k < 3 * scale; k++ , j++ )
+         {
+            writer.write ( scaled[ j ] );
+         }
+      }
+      else
+      {
+         writer.write ( commands[ i ] );
+      }
+   }
+   
+   writer.flush ();
+   output.close ();
+   
+   for ( unsigned long int i = 0; i < scaled.size (); i++ )
+   {
+      delete scaled[ i ];
+   }
+   
+   // Load the scaled layout, counting the allocations, the memory held by the commands and the time.
+   unsigned long int load_allocations = 0;
+   unsigned long int load_bytes = 0;
+   unsigned long int loaded = 0;
+   clock_t start = clock ();
+   
+   for ( int i = 0; i < repetitions; i++ )
+   {
+      OpenCIF::File paths_file;
+      paths_file.setPath ( paths_path );
+      
+      unsigned long int before = allocations;
+      unsigned long int bytes_before = bytes_in_use;
+      
+      if ( paths_file.loadFile () != OpenCIF::File::AllOk )
+      {
+         cout << "Can't load " << paths_path << endl;
+         return ( 1 );
+      }
+      
+      load_allocations = allocations - before;
+      load_bytes = bytes_in_use - bytes_before;
+      loaded = paths_file.getCommands ().size ();
+   }
+   
+   double seconds = (double)( clock () - start ) / CLOCKS_PER_SEC;
+   
+   cout << paths_path << ": " << loaded << " commands, " << paths << " wires and polygons" << endl;
+   cout << "Load: " << load_allocations << " allocations, " << ( seconds * 1000.0 / repetitions ) << " ms" << endl;
+   cout << "Memory held by the loaded file: " << load_bytes << " bytes (sizeof: PolygonCommand "
+        << sizeof ( OpenCIF::PolygonCommand ) << ", WireCommand " << sizeof ( OpenCIF::WireCommand )
+        << ", PointVector " << sizeof ( OpenCIF::PointVector ) << ")" << endl;
+   
+   return ( 0 );
+}
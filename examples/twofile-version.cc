@@ -31,6 +31,9 @@
 // To use, in non-Windows systems, just run: ./a.out
 // To use, in Windows systems, just run: a.exe
 
+// NOTE: When compiled as C++11 (or newer), some features of the library (like Writer::writeParallel) use
+// threads. In some systems, that requires to add the "-pthread" option to both commands.
+
 // NOTE: Is important for Windows users that you use a more advanced terminal than the default CMD
 // provided with the system, specially for the window size.
 
@@ -80,6 +83,10 @@ int main ()
       case OpenCIF::File::IncorrectInputFile:
          cout << "Incorrect input file" << endl;
          break;
+         
+      case OpenCIF::File::LoadCancelled:
+         cout << "Load cancelled" << endl;
+         break;
    }
    
    if ( all_ok )
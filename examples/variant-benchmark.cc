@@ -0,0 +1,184 @@
+/*
+ * LibOpenCIF, a library to read the contents of a CIF (Caltech Intermediate
+ * Form) file. The library also includes a finite state machine to validate
+ * the contents, acording to the specifications found in the technical
+ * report 2686, from february 11, 1980.
+ * 
+ * Copyright (C) 2014, Moises Chavez Martinez
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// This file is an example of how to use the variant representation of the commands, and it
+// compares the time needed to traverse it with the time needed to traverse the pointers.
+
+// To compile, use these commands (the variant representation needs C++17):
+
+// $ g++ -std=c++17 -O2 libopencif.cc -c                      <- This will generate a "libopencif.o" file.
+// $ g++ -std=c++17 -O2 variant-benchmark.cc libopencif.o     <- This will generate a binary file (or an EXE file)
+
+// To use, run: ./a.out [CIF file] [repetitions]
+// By default, the program traverses "adder4_a2m_sin.cif" 10000 times.
+
+# include <iostream>
+# include <vector>
+# include <string>
+# include <map>
+# include <cstdlib>
+# include <chrono>
+
+// Import directly the library file.
+# include "libopencif.hh"
+
+using namespace std;
+
+// Sums the coordinates of every primitive, following the pointers and switching on the type.
+long int traversePointers ( const vector< OpenCIF::Command* >& commands )
+{
+   long int total = 0;
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      switch ( commands[ i ]->type () )
+      {
+         case OpenCIF::Command::Polygon:
+         case OpenCIF::Command::Wire:
+            {
+               const OpenCIF::PointVector& points = static_cast< OpenCIF::PathBasedCommand* > ( commands[ i ] )->getPoints ();
+               
+               for ( unsigned long int j = 0; j < points.size (); j++ )
+               {
+                  total += points[ j ].getX () + points[ j ].getY ();
+               }
+            }
+            break;
+            
+         case OpenCIF::Command::Box:
+         case OpenCIF::Command::RoundFlash:
+            {
+               OpenCIF::Point position = static_cast< OpenCIF::PositionBasedCommand* > ( commands[ i ] )->getPosition ();
+               total += position.getX () + position.getY ();
+            }
+            break;
+            
+         default:
+            break;
+      }
+   }
+   
+   return ( total );
+}
+
+// The same sum, visiting the variants stored by value.
+long int traverseVariants ( const OpenCIF::CommandVariantVector& commands )
+{
+   long int total = 0;
+   
+   auto visitor = OpenCIF::Overloaded
+   {
+      [ &total ] ( const OpenCIF::PathBasedCommand& path )
+      {
+         const OpenCIF::PointVector& points = path.getPoints ();
+         
+         for ( unsigned long int j = 0; j < points.size (); j++ )
+         {
+            total += points[ j ].getX () + points[ j ].getY ();
+         }
+      } ,
+      [ &total ] ( const OpenCIF::PositionBasedCommand& primitive )
+      {
+         OpenCIF::Point position = primitive.getPosition ();
+         total += position.getX () + position.getY ();
+      } ,
+      [] ( const OpenCIF::Command& ) {}
+   };
+   
+   for ( unsigned long int i = 0; i < commands.size (); i++ )
+   {
+      visit ( visitor , commands[ i ] );
+   }
+   
+   return ( total );
+}
+
+// Returns the time elapsed since "start", in milliseconds.
+double elapsed ( const chrono::steady_clock::time_point& start )
+{
+   return ( chrono::duration< double , milli > ( chrono::steady_clock::now () - start ).count () );
+}
+
+int main ( int argc , char* argv[] )
+{
+   string cif_path = ( argc > 1 ) ? argv[ 1 ] : "adder4_a2m_sin.cif";
+   int repetitions = ( argc > 2 ) ? atoi ( argv[ 2 ] ) : 10000;
+   
+   OpenCIF::File file;
+   file.setPath ( cif_path );
+   
+   if ( file.loadFile () != OpenCIF::File::AllOk )
+   {
+      cout << "Can't load " << cif_path << endl;
+      return ( 1 );
+   }
+   
+   const vector< OpenCIF::Command* >& commands = file.getCommands ();
+   
+   // Convert once, and time it.
+   chrono::steady_clock::time_point start = chrono::steady_clock::now ();
+   OpenCIF::CommandVariantVector variants = OpenCIF::toVariants ( commands );
+   double conversion_ms = elapsed ( start );
+   
+   long int pointer_total = 0;
+   long int variant_total = 0;
+   
+   start = chrono::steady_clock::now ();
+   
+   for ( int i = 0; i < repetitions; i++ )
+   {
+      pointer_total += traversePointers ( commands );
+   }
+   
+   double pointer_ms = elapsed ( start );
+   start = chrono::steady_clock::now ();
+   
+   for ( int i = 0; i < repetitions; i++ )
+   {
+      variant_total += traverseVariants ( variants );
+   }
+   
+   double variant_ms = elapsed ( start );
+   
+   cout << commands.size () << " commands, converted in " << conversion_ms << " ms" << endl;
+   cout << "Pointers: " << ( pointer_ms * 1000.0 / repetitions ) << " us per traversal" << endl;
+   cout << "Variants: " << ( variant_ms * 1000.0 / repetitions ) << " us per traversal" << endl;
+   
+   // A couple of the algorithms provided by the library.
+   OpenCIF::Extent extent = OpenCIF::computeExtent ( variants );
+   
+   if ( !extent.empty )
+   {
+      cout << "Extent: (" << extent.min_x << ", " << extent.min_y << ") - (" << extent.max_x << ", " << extent.max_y << ")" << endl;
+   }
+   
+   map< string , unsigned long int > layers = OpenCIF::countPrimitivesPerLayer ( variants );
+   
+   for ( map< string , unsigned long int >::const_iterator layer = layers.begin (); layer != layers.end (); ++layer )
+   {
+      cout << "   " << layer->first << ": " << layer->second << " primitives" << endl;
+   }
+   
+   // Both representations hold the same commands.
+   return ( pointer_total == variant_total ? 0 : 1 );
+}